@@ -0,0 +1,123 @@
+#include "BsPatch.h"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#ifdef USE_BZIP2
+#include <bzlib.h>
+#endif
+
+namespace {
+
+[[noreturn]] void fail(const QString& why)
+{
+    throw std::runtime_error(("bspatch: " + why).toStdString());
+}
+
+// Целое bsdiff: 8 байт little-endian, знак в старшем бите (sign-magnitude, не дополнительный код)
+qint64 offtin(const char* p)
+{
+    const uchar* b = reinterpret_cast<const uchar*>(p);
+    quint64 y = b[7] & 0x7f;
+    for (int i = 6; i >= 0; --i) y = (y << 8) | b[i];
+    if (y > quint64(std::numeric_limits<qint64>::max())) fail("bad integer");
+    return (b[7] & 0x80) ? -qint64(y) : qint64(y);
+}
+
+#ifdef USE_BZIP2
+// Разжать bzip2-блок целиком; limit — больше этого блок быть не может (защита от бомб)
+QByteArray bunzip(const char* data, qint64 size, qint64 limit)
+{
+    if (size < 0 || size > std::numeric_limits<unsigned>::max()) fail("bad block size");
+    bz_stream bz{};
+    if (BZ2_bzDecompressInit(&bz, 0, 0) != BZ_OK) fail("BZ2_bzDecompressInit failed");
+
+    QByteArray out;
+    bz.next_in  = const_cast<char*>(data);
+    bz.avail_in = unsigned(size);
+    int rc = BZ_OK;
+    while (rc == BZ_OK) {
+        const qint64 have = out.size();
+        const qint64 grow = qBound<qint64>(64 * 1024, have, 16 << 20);
+        if (have >= limit + 1) { BZ2_bzDecompressEnd(&bz); fail("block larger than declared"); }
+        out.resize(qsizetype(qMin(have + grow, limit + 1)));
+        bz.next_out  = out.data() + have;
+        bz.avail_out = unsigned(out.size() - have);
+        rc = BZ2_bzDecompress(&bz);
+        out.resize(qsizetype(out.size() - bz.avail_out));
+        if (rc == BZ_OK && bz.avail_in == 0 && bz.avail_out != 0) break; // поток оборван
+    }
+    BZ2_bzDecompressEnd(&bz);
+    if (rc != BZ_STREAM_END) fail("corrupt bzip2 block");
+    if (out.size() > limit) fail("block larger than declared");
+    return out;
+}
+#endif
+
+} // namespace
+
+bool BsPatch::supported()
+{
+#ifdef USE_BZIP2
+    return true;
+#else
+    return false;
+#endif
+}
+
+QByteArray BsPatch::apply(const QByteArray& oldData, const QByteArray& patch)
+{
+#ifndef USE_BZIP2
+    Q_UNUSED(oldData);
+    Q_UNUSED(patch);
+    fail("built without bzip2 support");
+#else
+    if (patch.size() < 32 || memcmp(patch.constData(), "BSDIFF40", 8) != 0) fail("not a BSDIFF40 patch");
+    const qint64 ctrlLen = offtin(patch.constData() + 8);
+    const qint64 diffLen = offtin(patch.constData() + 16);
+    const qint64 newSize = offtin(patch.constData() + 24);
+    if (ctrlLen < 0 || diffLen < 0 || newSize < 0
+        || newSize > std::numeric_limits<int>::max()
+        || 32 + ctrlLen + diffLen > patch.size())
+        fail("bad header");
+
+    const char* p = patch.constData() + 32;
+    // управляющих троек не больше, чем байт в новом файле (+1 на пустой хвост)
+    const QByteArray ctrl  = bunzip(p, ctrlLen, (newSize + 1) * 24);
+    const QByteArray diff  = bunzip(p + ctrlLen, diffLen, newSize);
+    const QByteArray extra = bunzip(p + ctrlLen + diffLen, patch.size() - 32 - ctrlLen - diffLen, newSize);
+
+    QByteArray out(qsizetype(newSize), Qt::Uninitialized);
+    char*       dst   = out.data();
+    const char* old   = oldData.constData();
+    const qint64 oldSize = oldData.size();
+
+    qint64 newPos = 0, oldPos = 0, ci = 0, di = 0, ei = 0;
+    while (newPos < newSize) {
+        if (ci + 24 > ctrl.size()) fail("control block truncated");
+        const qint64 x = offtin(ctrl.constData() + ci);       // байт «старый + разница»
+        const qint64 y = offtin(ctrl.constData() + ci + 8);   // новых байт из extra
+        const qint64 z = offtin(ctrl.constData() + ci + 16);  // сдвиг по старому файлу
+        ci += 24;
+
+        if (x < 0 || y < 0 || newPos + x > newSize || di + x > diff.size()) fail("bad diff length");
+        for (qint64 i = 0; i < x; ++i) {
+            char c = diff[qsizetype(di + i)];
+            const qint64 o = oldPos + i;
+            if (o >= 0 && o < oldSize) c = char(c + old[o]);
+            dst[newPos + i] = c;
+        }
+        newPos += x;
+        oldPos += x;
+        di     += x;
+
+        if (newPos + y > newSize || ei + y > extra.size()) fail("bad extra length");
+        memcpy(dst + newPos, extra.constData() + ei, size_t(y));
+        newPos += y;
+        ei     += y;
+
+        if (z > oldSize + newSize || z < -(oldSize + newSize)) fail("bad seek");
+        oldPos += z;
+    }
+    return out;
+#endif
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <QtCore>
+
+// Применение бинарного патча в формате bsdiff 4.x (заголовок "BSDIFF40", три bzip2-блока:
+// управляющие тройки, разница к старому файлу, новые байты). Нужен для дельт client.jar:
+// при переходе на соседнюю версию качается патч на сотни КБ вместо всего jar.
+// Без libbz2 (сборка с USE_BZIP2=OFF) дельты не поддерживаются — supported() == false.
+class BsPatch {
+public:
+    static bool supported();
+
+    // Новый файл из старого и патча. Ошибки (битый патч, не тот формат) — std::runtime_error
+    static QByteArray apply(const QByteArray& oldData, const QByteArray& patch);
+};
@@ -0,0 +1,88 @@
+#include "CacheLock.h"
+#include "CachePaths.h"
+#include <QCryptographicHash>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+static QString locksDir(const QString& cacheRoot)
+{
+    // mkpath — раз на корень кэша, а не на каждый объект; пропавший каталог пересоздаст конструктор
+    static QMutex mx;
+    static QSet<QString> made;
+    const QString dir = QDir(cacheRoot).filePath(".locks");
+    QMutexLocker lk(&mx);
+    if (!made.contains(dir)) {
+        QDir().mkpath(dir);
+        made.insert(dir);
+    }
+    return dir;
+}
+
+QString CacheLock::wholeFile(const QString& cacheRoot)
+{
+    return QDir(locksDir(cacheRoot)).filePath("cache.lock");
+}
+
+QString CacheLock::namedFile(const QString& cacheRoot, const QString& name)
+{
+    return QDir(locksDir(cacheRoot)).filePath(name + ".lock");
+}
+
+QString CacheLock::shardFile(const QString& cacheRoot, const QString& key)
+{
+    static const QRegularExpression hex("^[0-9a-f]{2}");
+    QString shard = key.left(2).toLower();
+    if (!hex.match(shard).hasMatch())
+        shard = QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex().left(2));
+    return QDir(locksDir(cacheRoot)).filePath(shard + ".lock");
+}
+
+#ifdef Q_OS_UNIX
+
+CacheLock::CacheLock(const QString& lockFile, Mode mode, bool wait)
+{
+    fd_ = ::open(QFile::encodeName(lockFile).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd_ < 0 && errno == ENOENT && QDir().mkpath(QFileInfo(lockFile).path()))
+        fd_ = ::open(QFile::encodeName(lockFile).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd_ < 0) {
+        // каталог кэша только для чтения — координировать некого, работаем без блокировки
+        qWarning() << "cache lock: cannot open" << lockFile << strerror(errno);
+        held_ = true;
+        return;
+    }
+    const int op = (mode == Mode::Shared ? LOCK_SH : LOCK_EX) | (wait ? 0 : LOCK_NB);
+    int rc;
+    do { rc = ::flock(fd_, op); } while (rc < 0 && errno == EINTR);
+    held_ = (rc == 0);
+}
+
+CacheLock::~CacheLock()
+{
+    if (fd_ >= 0) ::close(fd_); // закрытие снимает flock
+}
+
+#else
+
+CacheLock::CacheLock(const QString&, Mode, bool) { held_ = true; }
+CacheLock::~CacheLock() = default;
+
+#endif
+
+CacheRootsLock::CacheRootsLock(const QString& cacheRoot, CacheLock::Mode mode, bool wait)
+{
+    const QString root = cacheRoot.isEmpty() ? CachePaths::root() : cacheRoot;
+    cache_ = std::make_unique<CacheLock>(CacheLock::wholeFile(root), mode, wait);
+    if (!cache_->held()) return;
+    const QString exec = CachePaths::execRoot(root);
+    if (QDir(exec).absolutePath() != QDir(root).absolutePath()) {
+        exec_ = std::make_unique<CacheLock>(CacheLock::wholeFile(exec), mode, wait);
+        if (!exec_->held()) return;
+    }
+    held_ = true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <QtCore>
+#include <memory>
+
+// Межпроцессная блокировка общего кэша (flock на файле в <cache>/.locks).
+// Нужна, когда на одном TESUTO_CACHE_DIR работают несколько лаунчеров (или GUI и CLI):
+//  - весь кэш: установки держат Shared и друг другу не мешают, сборщик мусора берёт Exclusive;
+//  - шард объекта (256 файлов по первым двум hex-символам): Exclusive держится только на перепроверке
+//    и записи (или удалении) объекта, не на время загрузки — соседи по шарду не ждут чужую сеть.
+//    Второй процесс, скачавший тот же объект параллельно, под локом находит его в кэше и не пишет.
+// Сами файлы в кэш пишутся через временный файл и rename — читатель никогда не видит недописанный объект.
+// Блокировка привязана к открытому файлу, поэтому между потоками одного процесса тоже работает.
+class CacheLock {
+public:
+    enum class Mode { Shared, Exclusive };
+
+    // wait=false — не ждать: если занято, held() == false
+    CacheLock(const QString& lockFile, Mode mode, bool wait = true);
+    ~CacheLock();
+    CacheLock(const CacheLock&) = delete;
+    CacheLock& operator=(const CacheLock&) = delete;
+
+    bool held() const { return held_; }
+
+    // <cache>/.locks/cache.lock
+    static QString wholeFile(const QString& cacheRoot);
+    // <cache>/.locks/<name>.lock — отдельные фоновые задачи (например, scrub)
+    static QString namedFile(const QString& cacheRoot, const QString& name);
+    // <cache>/.locks/<xx>.lock; key — hex-хэш (sha1 объекта), иначе шард берётся от sha1 ключа
+    static QString shardFile(const QString& cacheRoot, const QString& key);
+
+private:
+    int  fd_   = -1;
+    bool held_ = false;
+};
+
+// Блокировка всего кэша вместе с корнем исполняемого (CachePaths::execRoot): в режиме общего кэша
+// natives и рантаймы лежат в личном кэше, и их координирует его собственный cache.lock.
+// Берётся в порядке «кэш, затем execRoot» (если это другой каталог) — взаимоблокировок нет
+class CacheRootsLock {
+public:
+    CacheRootsLock(const QString& cacheRoot, CacheLock::Mode mode, bool wait = true);
+
+    bool held() const { return held_; }
+
+private:
+    std::unique_ptr<CacheLock> cache_;
+    std::unique_ptr<CacheLock> exec_;
+    bool held_ = false;
+};
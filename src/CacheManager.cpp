@@ -0,0 +1,227 @@
+#include "CacheManager.h"
+#include "CacheLock.h"
+#include "IdlePriority.h"
+#include "CachePaths.h"
+#include "InstallManifest.h"
+#include "InstanceStore.h"
+#include "Util.h"
+#include <QDirIterator>
+#include <QSettings>
+#include <QtConcurrent>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+// Число жёстких ссылок (> 1 — файл разложен в какой-то инстанс хардлинком)
+quint64 linkCount(const QString& path)
+{
+#ifdef Q_OS_LINUX
+    struct stat st {};
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0) return quint64(st.st_nlink);
+#else
+    Q_UNUSED(path);
+#endif
+    return 1;
+}
+
+qint64 lastUseOf(const QFileInfo& fi)
+{
+    return qMax(fi.lastRead().toMSecsSinceEpoch(), fi.lastModified().toMSecsSinceEpoch());
+}
+
+qint64 dirSize(const QString& dir, qint64* lastUse)
+{
+    qint64 total = 0;
+    QDirIterator it(dir, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        total += fi.size();
+        if (lastUse) *lastUse = qMax(*lastUse, lastUseOf(fi));
+    }
+    return total;
+}
+
+} // namespace
+
+CacheManager::CacheManager(QString gameRoot, QString cacheRoot)
+    : gameRoot_(std::move(gameRoot))
+    , cacheRoot_(cacheRoot.isEmpty() ? CachePaths::root() : std::move(cacheRoot))
+{
+}
+
+qint64 CacheManager::budgetBytes()
+{
+    QSettings s;
+    return s.value("cache/budgetMiB", 0).toLongLong() * 1024 * 1024;
+}
+
+QString CacheManager::formatBytes(qint64 bytes)
+{
+    if (bytes >= (qint64(1) << 30)) return QString("%1 GiB").arg(bytes / double(qint64(1) << 30), 0, 'f', 2);
+    if (bytes >= (qint64(1) << 20)) return QString("%1 MiB").arg(bytes / double(qint64(1) << 20), 0, 'f', 1);
+    return QString("%1 KiB").arg(bytes / 1024);
+}
+
+QVector<CacheManager::Item> CacheManager::gather() const
+{
+    // ссылки: пути из манифестов инстансов совпадают с относительными путями внутри кэша
+    // (assets/objects/xx/<sha>, assets/indexes/<id>.json, libraries/<maven>, versions/<id>/<id>.jar)
+    QSet<QString> refs;
+    QSet<QString> versionIds;
+    QVector<QPair<QString, QString>> instances; // (каталог, текущая версия)
+    const InstanceStore store(gameRoot_);
+    for (const Instance& inst : store.list()) {
+        const QString dir = store.pathFor(inst);
+        const InstallManifest m = InstallManifest::load(dir);
+        for (auto it = m.files.cbegin(); it != m.files.cend(); ++it) refs.insert(it.key());
+        // библиотеки модлоадера лежат в том же <cache>/libraries
+        const InstallManifest lm = InstallManifest::load(dir, InstallManifest::Part::Loader);
+        for (auto it = lm.files.cbegin(); it != lm.files.cend(); ++it) refs.insert(it.key());
+        const QString ver = m.versionId.isEmpty() ? inst.versionId : m.versionId;
+        versionIds.insert(ver);
+        instances.push_back({dir, ver});
+    }
+
+    QVector<Item> items;
+    auto addFile = [&](const QFileInfo& fi, bool referenced) {
+        items.push_back(Item{fi.absoluteFilePath(), fi.size(), lastUseOf(fi), false, referenced});
+    };
+
+    // файлы кэша, на которые ссылаются по относительному пути
+    for (const QString& sub : {QString("assets/objects"), QString("assets/indexes"), QString("libraries"),
+                               QString("versions")}) {
+        const QString base = joinPath(cacheRoot_, sub);
+        QDirIterator it(base, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            const QFileInfo fi = it.fileInfo();
+            const QString rel = sub + "/" + QDir(base).relativeFilePath(fi.absoluteFilePath());
+            addFile(fi, refs.contains(rel) || linkCount(fi.absoluteFilePath()) > 1);
+        }
+    }
+
+    // объекты рантаймов Mojang: живы, пока на них смотрит хоть один каталог рантайма
+    {
+        QDirIterator it(joinPath(CachePaths::execRoot(cacheRoot_), "runtimes/objects"), QDir::Files | QDir::NoDotAndDotDot,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            addFile(it.fileInfo(), linkCount(it.filePath()) > 1);
+        }
+    }
+
+    // natives: каталог <версия>-<arch>-<key> нужен, пока эта версия стоит хоть в одном инстансе.
+    // Они всегда в личном кэше (execRoot), поэтому чужие инстансы на них не ссылаются
+    {
+        const QDir nat(joinPath(CachePaths::execRoot(cacheRoot_), "natives"));
+        for (const QString& d : nat.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            bool used = false;
+            for (const QString& ver : versionIds)
+                if (!ver.isEmpty() && d.startsWith(ver + "-")) { used = true; break; }
+            Item item{nat.filePath(d), 0, 0, true, used};
+            item.size = dirSize(item.path, &item.lastUse);
+            items.push_back(item);
+        }
+    }
+
+    // архивы JRE от старой схемы установки — больше не читаются
+    for (const QFileInfo& fi : QDir(cacheRoot_).entryInfoList({"temurin-jre-*.tar.gz"}, QDir::Files))
+        addFile(fi, false);
+
+    // versions/<id> в инстансах, кроме текущей версии
+    for (const auto& inst : instances) {
+        const QDir vers(joinPath(inst.first, "versions"));
+        for (const QString& d : vers.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            if (d == inst.second) continue;
+            Item item{vers.filePath(d), 0, 0, true, false};
+            item.size = dirSize(item.path, &item.lastUse);
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+CacheManager::Report CacheManager::scan() const
+{
+    Report r;
+    for (const Item& it : gather()) {
+        r.totalBytes += it.size;
+        if (it.referenced) {
+            r.referencedBytes += it.size;
+        } else {
+            r.reclaimableBytes += it.size;
+            ++r.reclaimableItems;
+        }
+    }
+    return r;
+}
+
+CacheManager::Report CacheManager::collect(qint64 budget) const
+{
+    QElapsedTimer timer; timer.start();
+
+    // кэш занят установкой (в этом или другом процессе) — ничего не удаляем, сборка будет в следующий раз.
+    // natives и runtimes/objects лежат в execRoot — его лок тоже (общий кэш: это личный кэш пользователя)
+    CacheRootsLock exclusive(cacheRoot_, CacheLock::Mode::Exclusive, /*wait*/ false);
+    if (!exclusive.held()) {
+        qInfo() << "cache gc: cache is in use by an install, skipped";
+        Report busy = scan();
+        busy.busy = true;
+        return busy;
+    }
+    QVector<Item> items = gather();
+
+    Report r;
+    QVector<Item> victims;
+    for (const Item& it : items) {
+        r.totalBytes += it.size;
+        if (it.referenced) {
+            r.referencedBytes += it.size;
+        } else {
+            r.reclaimableBytes += it.size;
+            ++r.reclaimableItems;
+            victims.push_back(it);
+        }
+    }
+    if (budget <= 0 || r.totalBytes <= budget) return r;
+
+    // LRU: дольше всего не использованное уходит первым
+    std::sort(victims.begin(), victims.end(), [](const Item& a, const Item& b) { return a.lastUse < b.lastUse; });
+    qint64 total = r.totalBytes;
+    for (const Item& v : victims) {
+        if (total <= budget) break;
+        const bool ok = v.dir ? QDir(v.path).removeRecursively() : QFile::remove(v.path);
+        if (!ok) continue;
+        total -= v.size;
+        r.evictedBytes += v.size;
+        ++r.evictedItems;
+    }
+    r.reclaimableBytes -= r.evictedBytes;
+    r.reclaimableItems -= r.evictedItems;
+    r.totalBytes = total;
+    qInfo().noquote() << QString("cache gc: evicted %1 item(s), %2; now %3 of budget %4 (%5 ms)")
+                             .arg(r.evictedItems).arg(formatBytes(r.evictedBytes))
+                             .arg(formatBytes(total)).arg(formatBytes(budget)).arg(timer.elapsed());
+    return r;
+}
+
+void CacheManager::collectInBackground(const QString& gameRoot)
+{
+    const qint64 budget = budgetBytes();
+    if (budget <= 0) return;
+    auto fut = QtConcurrent::run([gameRoot, budget] {
+        IdleIoPriority idle;
+        Q_UNUSED(idle);
+        try {
+            CacheManager(gameRoot).collect(budget);
+        } catch (const std::exception& e) {
+            qWarning() << "cache gc failed:" << e.what();
+        }
+    });
+    Q_UNUSED(fut);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <QtCore>
+
+// Учёт и сборка мусора в общем кэше (assets, libraries, индексы, natives, объекты рантаймов,
+// старые архивы JRE) и в устаревших versions/<id> инстансов.
+// Ссылки берутся из манифестов инстансов (.tesuto_manifest.json) и счётчика хардлинков:
+// объект, разложенный в инстанс линком, имеет nlink > 1. Неиспользуемое вытесняется по LRU
+// (время последнего доступа — max(atime, mtime)), пока кэш не уложится в бюджет.
+class CacheManager {
+public:
+    struct Report {
+        qint64 totalBytes       = 0; // всё, что учтено (кэш + устаревшие versions/ в инстансах)
+        qint64 referencedBytes  = 0;
+        qint64 reclaimableBytes = 0; // неиспользуемое — можно удалить без вреда
+        int    reclaimableItems = 0;
+        qint64 evictedBytes     = 0; // collect(): сколько реально удалено
+        int    evictedItems     = 0;
+        bool   busy             = false; // collect(): кэш занят установкой, ничего не удалено
+    };
+
+    // gameRoot — корень каталогов игры (где instances.json и каталоги инстансов)
+    explicit CacheManager(QString gameRoot, QString cacheRoot = QString());
+
+    // Бюджет из настроек (cache/budgetMiB); 0 — без ограничения
+    static qint64 budgetBytes();
+
+    // Только посчитать
+    Report scan() const;
+    // Вытеснить неиспользуемое (старое первым), пока total > budget; budget 0 — ничего не удалять
+    Report collect(qint64 budget) const;
+
+    // collect(budgetBytes()) в пуле потоков с idle-приоритетом ввода-вывода
+    static void collectInBackground(const QString& gameRoot);
+
+    static QString formatBytes(qint64 bytes);
+
+private:
+    struct Item {
+        QString path;
+        qint64  size       = 0;
+        qint64  lastUse    = 0;
+        bool    dir        = false;
+        bool    referenced = false;
+    };
+    QVector<Item> gather() const;
+
+    QString gameRoot_;
+    QString cacheRoot_;
+};
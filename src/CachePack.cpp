@@ -0,0 +1,559 @@
+#include "CachePack.h"
+#include "CacheLock.h"
+#include "CachePaths.h"
+#include "InstallManifest.h"
+#include "InstanceStore.h"
+#include "TarGzExtractor.h"
+#include "Util.h"
+#include <QDirIterator>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* kPackManifest = "tesuto-pack.json";
+
+[[noreturn]] void fail(const QString& why)
+{
+    throw std::runtime_error(("cache pack: " + why).toStdString());
+}
+
+// Потоковая запись .tar.gz: заголовки ustar, длинные имена — GNU L/K (их понимает TarGzExtractor)
+class TarGzWriter {
+public:
+    explicit TarGzWriter(const QString& path)
+        : out_(path)
+    {
+        if (!out_.open(QIODevice::WriteOnly)) fail("cannot create " + path + ": " + out_.errorString());
+        // assets — уже сжатые png/ogg: быстрый уровень почти не уступает максимальному
+        if (deflateInit2(&zs_, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            fail("deflateInit failed");
+        buf_.resize(256 * 1024);
+    }
+    ~TarGzWriter() { deflateEnd(&zs_); }
+
+    void addData(const QString& name, const QByteArray& data, qint64 mtime)
+    {
+        header(name, data.size(), 0644, mtime, '0', QString());
+        write(data.constData(), data.size());
+        pad(data.size());
+    }
+
+    // Файл с диска кусками, без чтения целиком в память
+    void addFile(const QString& name, const QString& src, quint32 mode, qint64 mtime)
+    {
+        QFile f(src);
+        if (!f.open(QIODevice::ReadOnly)) fail("cannot read " + src + ": " + f.errorString());
+        const qint64 size = f.size();
+        header(name, size, mode, mtime, '0', QString());
+        qint64 left = size;
+        QByteArray chunk;
+        while (left > 0) {
+            chunk = f.read(qMin<qint64>(left, 1 << 20));
+            if (chunk.isEmpty()) fail("short read: " + src);
+            write(chunk.constData(), chunk.size());
+            left -= chunk.size();
+        }
+        pad(size);
+    }
+
+    // type '1' — хардлинк на ранее записанное имя, '2' — симлинк
+    void addLink(const QString& name, const QString& target, char type, qint64 mtime)
+    {
+        header(name, 0, type == '2' ? 0777 : 0644, mtime, type, target);
+    }
+
+    void finish()
+    {
+        static const char zeros[2 * 512] = {};
+        write(zeros, sizeof(zeros));
+        deflateChunk(Z_FINISH);
+        if (!out_.commit()) fail("cannot commit " + out_.fileName() + ": " + out_.errorString());
+    }
+
+private:
+    static void octal(char* p, int n, quint64 v)
+    {
+        // n-1 цифр и NUL
+        std::memset(p, '0', size_t(n - 1));
+        p[n - 1] = '\0';
+        for (int i = n - 2; i >= 0 && v; --i, v >>= 3) p[i] = char('0' + (v & 7));
+    }
+
+    void longName(char type, const QByteArray& name)
+    {
+        // GNU: запись ././@LongLink, данные — имя с завершающим NUL
+        const QByteArray data = name + '\0';
+        char h[512] = {};
+        std::memcpy(h, "././@LongLink", 13);
+        rawHeader(h, data.size(), 0644, 0, type, QByteArray());
+        write(data.constData(), data.size());
+        pad(data.size());
+    }
+
+    void header(const QString& name, qint64 size, quint32 mode, qint64 mtime, char type, const QString& link)
+    {
+        const QByteArray n = name.toUtf8();
+        const QByteArray l = link.toUtf8();
+        if (l.size() > 100) longName('K', l);
+        if (n.size() > 100) longName('L', n);
+        char h[512] = {};
+        std::memcpy(h, n.constData(), size_t(qMin(n.size(), qsizetype(100))));
+        rawHeader(h, size, mode, mtime, type, l.left(100));
+    }
+
+    void rawHeader(char* h, qint64 size, quint32 mode, qint64 mtime, char type, const QByteArray& link)
+    {
+        octal(h + 100, 8, mode & 07777);
+        octal(h + 108, 8, 0);
+        octal(h + 116, 8, 0);
+        octal(h + 124, 12, quint64(size));
+        octal(h + 136, 12, quint64(qMax<qint64>(0, mtime)));
+        h[156] = type;
+        std::memcpy(h + 157, link.constData(), size_t(link.size()));
+        std::memcpy(h + 257, "ustar\0" "00", 8);
+        std::memset(h + 148, ' ', 8);
+        quint32 sum = 0;
+        for (int i = 0; i < 512; ++i) sum += uchar(h[i]);
+        octal(h + 148, 7, sum);
+        h[155] = ' ';
+        write(h, 512);
+    }
+
+    void pad(qint64 size)
+    {
+        static const char zeros[512] = {};
+        const qint64 rem = size % 512;
+        if (rem) write(zeros, 512 - rem);
+    }
+
+    void write(const char* p, qint64 n)
+    {
+        zs_.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(p));
+        zs_.avail_in = uInt(n);
+        deflateChunk(Z_NO_FLUSH);
+    }
+
+    void deflateChunk(int flush)
+    {
+        int rc;
+        do {
+            zs_.next_out  = reinterpret_cast<Bytef*>(buf_.data());
+            zs_.avail_out = uInt(buf_.size());
+            rc = deflate(&zs_, flush);
+            if (rc == Z_STREAM_ERROR) fail("deflate failed");
+            const qint64 have = buf_.size() - zs_.avail_out;
+            if (have && out_.write(buf_.constData(), have) != have)
+                fail("write failed: " + out_.errorString());
+        } while (zs_.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+    }
+
+    QSaveFile  out_;
+    z_stream   zs_{};
+    QByteArray buf_;
+};
+
+struct PackEntry {
+    QString name; // путь в архиве = путь в кэше
+    QString src;  // откуда читать
+};
+
+// Все файлы (и симлинки) под dir, пути относительно base
+void addTree(const QString& base, const QString& dir, QVector<PackEntry>& out)
+{
+    QDirIterator it(dir, QDir::Files | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        out.push_back({QDir(base).relativeFilePath(it.filePath()), it.filePath()});
+    }
+}
+
+// version.json версии: из кэша, иначе из инстанса
+QJsonObject versionJson(const QString& cacheRoot, const QStringList& instanceDirs, const QString& id)
+{
+    QStringList candidates{ joinPath(cacheRoot, "versions/" + id + "/" + id + ".json") };
+    for (const QString& d : instanceDirs) candidates << joinPath(d, "versions/" + id + "/" + id + ".json");
+    for (const QString& p : candidates) {
+        QFile f(p);
+        if (f.open(QIODevice::ReadOnly)) {
+            const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+            if (doc.isObject()) return doc.object();
+        }
+    }
+    return {};
+}
+
+bool isContentAddressed(const QString& rel)
+{
+    return rel.startsWith("assets/objects/") || rel.startsWith("runtimes/objects/");
+}
+
+// natives и рантаймы лежат в CachePaths::execRoot (для общего кэша — в личном кэше пользователя)
+bool isExecutablePart(const QString& rel)
+{
+    return rel.startsWith("natives/") || rel.startsWith("runtimes/");
+}
+
+// Перенос файла в кэш: переименованием, а между ФС (личный кэш при общем) — копией
+bool moveFile(const QString& from, const QString& to)
+{
+    if (QFile::rename(from, to)) return true;
+    if (!QFile::copy(from, to)) return false;
+    QFile::remove(from);
+    return true;
+}
+
+// Цель симлинка как записана (относительная остаётся относительной); пусто — не симлинк
+QString rawLinkTarget(const QString& path)
+{
+#ifdef Q_OS_UNIX
+    char buf[4096];
+    const ssize_t n = ::readlink(QFile::encodeName(path).constData(), buf, sizeof(buf) - 1);
+    if (n > 0) return QFile::decodeName(QByteArray(buf, int(n)));
+#else
+    Q_UNUSED(path);
+#endif
+    return {};
+}
+
+// Симлинк из пакета допустим только внутри каталога рантайма runtimes/<d>/ (не objects)
+// и только с относительной целью, которая не выходит за этот каталог
+bool allowedLink(const QString& rel, const QString& target)
+{
+    const QStringList parts = rel.split('/');
+    if (parts.size() < 3 || parts[0] != "runtimes" || parts[1] == "objects" || parts[1].startsWith('.'))
+        return false;
+    if (target.isEmpty() || QDir::isAbsolutePath(target) || target.startsWith('/')) return false;
+    const QString dir      = parts[0] + "/" + parts[1] + "/";
+    const QString resolved = QDir::cleanPath(QFileInfo(rel).path() + "/" + target);
+    return resolved.startsWith(dir) && !resolved.startsWith("../");
+}
+
+// Копия дерева между ФС: файлы копируются, симлинки воссоздаются (хардлинки становятся копиями)
+bool copyTree(const QString& from, const QString& to)
+{
+    QDirIterator it(from, QDir::Files | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QString dst = joinPath(to, QDir(from).relativeFilePath(it.filePath()));
+        ensureDir(QFileInfo(dst).path());
+        const bool ok = it.fileInfo().isSymLink() ? QFile::link(rawLinkTarget(it.filePath()), dst)
+                                                  : QFile::copy(it.filePath(), dst);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+CachePack::CachePack(QString cacheRoot)
+    : cacheRoot_(cacheRoot.isEmpty() ? CachePaths::root() : std::move(cacheRoot))
+{
+}
+
+QStringList CachePack::installedVersions(const QString& gameRoot)
+{
+    QStringList ids;
+    const InstanceStore store(gameRoot);
+    for (const Instance& inst : store.list()) {
+        const InstallManifest m = InstallManifest::load(store.pathFor(inst));
+        if (!m.isEmpty() && !m.versionId.isEmpty() && !ids.contains(m.versionId)) ids << m.versionId;
+    }
+    ids.sort();
+    return ids;
+}
+
+CachePack::Stats CachePack::exportPack(const QString& gameRoot, const QStringList& versionIds, bool withJava,
+                                       const QString& outPath) const
+{
+    QElapsedTimer timer; timer.start();
+    QVector<PackEntry> entries;
+    QSet<QString>      names;
+    QJsonObject        sums;
+    QStringList        instanceDirs;
+
+    // файлы версий — по манифестам инстансов; путь в инстансе = путь в кэше
+    const InstanceStore store(gameRoot);
+    for (const Instance& inst : store.list()) {
+        const QString dir = store.pathFor(inst);
+        const InstallManifest m = InstallManifest::load(dir);
+        if (!versionIds.contains(m.versionId)) continue;
+        instanceDirs << dir;
+        for (auto it = m.files.cbegin(); it != m.files.cend(); ++it) {
+            const QString& rel = it.key();
+            if (names.contains(rel)) continue;
+            if (!rel.startsWith("assets/") && !rel.startsWith("libraries/") && !rel.startsWith("versions/"))
+                continue;
+            // в кэше нет (поставлено до общего кэша) — берём из инстанса
+            QString src = joinPath(cacheRoot_, rel);
+            if (!QFileInfo::exists(src)) src = joinPath(dir, rel);
+            if (!QFileInfo::exists(src)) continue;
+            names.insert(rel);
+            entries.push_back({rel, src});
+            if (!it->sha1.isEmpty()) sums.insert(rel, it->sha1);
+        }
+    }
+    if (entries.isEmpty()) fail("none of the versions is installed: " + versionIds.join(", "));
+
+    // natives — готовые каталоги из кэша
+    const QString execRoot = CachePaths::execRoot(cacheRoot_);
+    const QDir nat(joinPath(execRoot, "natives"));
+    for (const QString& d : nat.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        for (const QString& id : versionIds)
+            if (d.startsWith(id + "-") && !d.contains(".partial-")) addTree(execRoot, nat.filePath(d), entries);
+
+    // рантаймы, нужные версиям: Mojang по компоненту, Temurin по мажорной версии
+    if (withJava) {
+        QStringList prefixes;
+        for (const QString& id : versionIds) {
+            const QJsonObject jv = versionJson(cacheRoot_, instanceDirs, id).value("javaVersion").toObject();
+            const QString component = jv.value("component").toString();
+            const int     major     = jv.value("majorVersion").toInt();
+            if (!component.isEmpty()) prefixes << "mojang-" + component + "-";
+            if (major > 0)            prefixes << QString("temurin-%1-").arg(major);
+        }
+        const QDir rt(joinPath(execRoot, "runtimes"));
+        for (const QString& d : rt.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            if (d.contains(".partial-")) continue;
+            for (const QString& p : prefixes)
+                if (d.startsWith(p)) { addTree(execRoot, rt.filePath(d), entries); break; }
+        }
+    }
+
+#ifdef Q_OS_UNIX
+    // объекты выбранных рантаймов пишем первыми: файлы каталогов рантайма станут хардлинками
+    // на них, и после импорта связь «объект — каталог» сохранится. Объект выбранного рантайма —
+    // тот же inode, что и файл в его каталоге; объекты других рантаймов в пакет не идут
+    if (withJava) {
+        QSet<QPair<quint64, quint64>> inodes; // (dev, ino)
+        for (const PackEntry& e : entries) {
+            if (!e.name.startsWith("runtimes/")) continue;
+            struct stat sb {};
+            if (::lstat(QFile::encodeName(e.src).constData(), &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_nlink > 1)
+                inodes.insert({quint64(sb.st_dev), quint64(sb.st_ino)});
+        }
+        QVector<PackEntry> objects;
+        QDirIterator it(joinPath(execRoot, "runtimes/objects"), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext() && !inodes.isEmpty()) {
+            it.next();
+            struct stat sb {};
+            if (::lstat(QFile::encodeName(it.filePath()).constData(), &sb) == 0
+                && inodes.contains({quint64(sb.st_dev), quint64(sb.st_ino)}))
+                objects.push_back({QDir(execRoot).relativeFilePath(it.filePath()), it.filePath()});
+        }
+        entries = objects + entries;
+    }
+#endif
+
+    // sha1 у каждого файла пакета, включая natives и рантаймы: импорт не примет файл без него.
+    // Content-addressed — по имени, остальное без sha1 из манифеста инстанса считаем параллельно
+    struct Hash { QString name; QString src; QString sha1; };
+    QVector<Hash> toHash;
+    QJsonObject   links;
+    for (const PackEntry& e : entries) {
+        const QFileInfo fi(e.src);
+        if (fi.isSymLink()) { links.insert(e.name, rawLinkTarget(e.src)); continue; }
+        if (!fi.isFile() || sums.contains(e.name)) continue;
+        if (isContentAddressed(e.name)) sums.insert(e.name, fi.fileName());
+        else toHash.push_back({e.name, e.src, QString()});
+    }
+    QtConcurrent::blockingMap(toHash, [](Hash& h) { h.sha1 = sha1File(h.src); });
+    for (const Hash& h : toHash)
+        if (!h.sha1.isEmpty()) sums.insert(h.name, h.sha1);
+
+    QJsonObject manifest;
+    manifest.insert("format", 1);
+    manifest.insert("versions", QJsonArray::fromStringList(versionIds));
+    manifest.insert("sha1", sums);
+    manifest.insert("links", links);
+
+    Stats st;
+    TarGzWriter tar(outPath);
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    tar.addData(kPackManifest, QJsonDocument(manifest).toJson(QJsonDocument::Compact), now);
+
+#ifdef Q_OS_UNIX
+    QHash<QPair<quint64, quint64>, QString> seen; // (dev, ino) -> первое имя в архиве
+#endif
+    for (const PackEntry& e : entries) {
+#ifdef Q_OS_UNIX
+        struct stat sb {};
+        const QByteArray src = QFile::encodeName(e.src);
+        if (::lstat(src.constData(), &sb) != 0) continue;
+        if (S_ISLNK(sb.st_mode)) {
+            const QString target = rawLinkTarget(e.src);
+            if (target.isEmpty()) continue;
+            tar.addLink(e.name, target, '2', sb.st_mtime);
+            ++st.files;
+            continue;
+        }
+        if (!S_ISREG(sb.st_mode)) continue;
+        if (sb.st_nlink > 1) {
+            const QPair<quint64, quint64> key(quint64(sb.st_dev), quint64(sb.st_ino));
+            const auto prev = seen.constFind(key);
+            if (prev != seen.constEnd()) {
+                tar.addLink(e.name, *prev, '1', sb.st_mtime);
+                ++st.files;
+                continue;
+            }
+            seen.insert(key, e.name);
+        }
+        tar.addFile(e.name, e.src, quint32(sb.st_mode), sb.st_mtime);
+        st.bytes += sb.st_size;
+#else
+        const QFileInfo fi(e.src);
+        if (!fi.isFile()) continue;
+        tar.addFile(e.name, e.src, 0644, fi.lastModified().toSecsSinceEpoch());
+        st.bytes += fi.size();
+#endif
+        ++st.files;
+    }
+    tar.finish();
+
+    qInfo().noquote() << QString("cache pack: exported %1 file(s), %2 bytes for %3 -> %4 (%5 ms)")
+                             .arg(st.files).arg(st.bytes).arg(versionIds.join(", "), outPath)
+                             .arg(timer.elapsed());
+    return st;
+}
+
+CachePack::Stats CachePack::importPack(const QString& packPath) const
+{
+    QElapsedTimer timer; timer.start();
+    ensureDir(cacheRoot_);
+    // пока вливаем, сборщик мусора кэш не трогает (и execRoot — туда едут natives и рантаймы)
+    CacheRootsLock cacheInUse(cacheRoot_, CacheLock::Mode::Shared);
+
+    // распаковка рядом с кэшем (та же ФС — перенос переименованием, хардлинки сохраняются)
+    const QString staging = joinPath(cacheRoot_, QString(".import-%1").arg(QCoreApplication::applicationPid()));
+    QDir(staging).removeRecursively();
+    struct Cleanup { QString dir; ~Cleanup() { QDir(dir).removeRecursively(); } } cleanup{staging};
+    ensureDir(staging);
+    {
+        QFile in(packPath);
+        if (!in.open(QIODevice::ReadOnly)) fail("cannot open " + packPath + ": " + in.errorString());
+        TarGzExtractor tar(staging);
+        while (!in.atEnd()) {
+            const QByteArray chunk = in.read(1 << 20);
+            if (chunk.isEmpty()) fail("read failed: " + in.errorString());
+            tar.feed(chunk);
+        }
+        tar.finish();
+    }
+
+    QFile mf(joinPath(staging, kPackManifest));
+    if (!mf.open(QIODevice::ReadOnly)) fail("not a cache pack (no " + QString(kPackManifest) + ")");
+    const QJsonObject manifest = QJsonDocument::fromJson(mf.readAll()).object();
+    mf.close();
+    if (manifest.value("format").toInt() != 1) fail("unsupported pack format");
+    const QJsonObject sums  = manifest.value("sha1").toObject();
+    const QJsonObject links = manifest.value("links").toObject();
+
+    // принимается только перечисленное в манифесте пакета: файл — с совпавшим sha1 (content-addressed
+    // проверяются по имени), симлинк — с той же целью, и только внутри каталога рантайма с целью
+    // в нём же (манифест из того же недоверенного архива, сам по себе он ничего не доказывает).
+    // Остальное удаляется из staging.
+    // Каталог natives/рантайма с хоть одним отвергнутым файлом в кэш не попадает
+    std::atomic_int  rejected{0};
+    std::atomic_bool runtimeBroken{false};
+    QMutex           brokenMx;
+    QSet<QString>    brokenDirs; // natives/<d>, runtimes/<d>
+    auto reject = [&](const QString& rel, const char* why) {
+        qWarning() << "cache pack:" << why << "- dropped" << rel;
+        QFile::remove(joinPath(staging, rel));
+        rejected.fetch_add(1);
+        if (rel.startsWith("runtimes/objects/")) runtimeBroken.store(true);
+        else if (isExecutablePart(rel)) {
+            QMutexLocker lock(&brokenMx);
+            brokenDirs.insert(rel.section('/', 0, 1));
+        }
+    };
+
+    struct Check { QString rel; QString expect; };
+    QVector<Check> checks;
+    // Dirs — чтобы увидеть и симлинки на каталоги (по ним обход не идёт)
+    QDirIterator it(staging, QDir::Files | QDir::Dirs | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QString rel = QDir(staging).relativeFilePath(it.filePath());
+        if (rel == kPackManifest) continue;
+        if (it.fileInfo().isSymLink()) {
+            const QString target = rawLinkTarget(it.filePath());
+            if (!links.contains(rel) || links.value(rel).toString() != target)
+                reject(rel, "unlisted symlink");
+            else if (!allowedLink(rel, target))
+                reject(rel, "symlink outside its runtime");
+            continue;
+        }
+        if (it.fileInfo().isDir()) continue;
+        QString expect = sums.value(rel).toString();
+        if (expect.isEmpty() && isContentAddressed(rel)) expect = it.fileName();
+        if (expect.isEmpty()) reject(rel, "no checksum in the pack");
+        else checks.push_back({rel, expect});
+    }
+    QtConcurrent::blockingMap(checks, [&](const Check& c) {
+        if (sha1File(joinPath(staging, c.rel)) != c.expect) reject(c.rel, "checksum mismatch");
+    });
+
+    Stats st;
+    st.rejected = rejected.load();
+
+    // каталоги natives и рантаймов переносятся целиком и только если их ещё нет.
+    // Их корень — execRoot: для общего кэша это другая ФС, тогда копия во временный каталог и rename
+    const QString execRoot = CachePaths::execRoot(cacheRoot_);
+    auto moveDir = [&](const QString& rel) {
+        const QString from = joinPath(staging, rel), to = joinPath(execRoot, rel);
+        if (QFileInfo::exists(to)) { ++st.skipped; QDir(from).removeRecursively(); return; }
+        ensureDir(QFileInfo(to).path());
+        if (!QDir().rename(from, to)) {
+            const QString tmp = to + QString(".partial-%1").arg(QCoreApplication::applicationPid());
+            QDir(tmp).removeRecursively();
+            if (!copyTree(from, tmp) || !QDir().rename(tmp, to)) {
+                QDir(tmp).removeRecursively();
+                fail("cannot move " + rel + " into the cache");
+            }
+        }
+        ++st.files;
+    };
+    for (const QString& d : QDir(joinPath(staging, "natives")).entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        if (!brokenDirs.contains("natives/" + d)) moveDir("natives/" + d);
+    for (const QString& d : QDir(joinPath(staging, "runtimes")).entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (d == "objects" || brokenDirs.contains("runtimes/" + d)) continue;
+        // файлы рантайма — хардлинки на объекты; битый объект значит и битый рантайм
+        if (runtimeBroken.load()) { ++st.rejected; continue; }
+        moveDir("runtimes/" + d);
+    }
+
+    // остальное — по файлу; то, что уже есть в кэше, не трогаем
+    QDirIterator files(staging, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (files.hasNext()) {
+        files.next();
+        const QString rel = QDir(staging).relativeFilePath(files.filePath());
+        if (rel == kPackManifest || rel.startsWith("natives/")) continue;
+        if (rel.startsWith("runtimes/") && !rel.startsWith("runtimes/objects/")) continue;
+        const QString to = joinPath(isExecutablePart(rel) ? execRoot : cacheRoot_, rel);
+        if (QFileInfo::exists(to)) { ++st.skipped; continue; }
+        ensureDir(QFileInfo(to).path());
+        const qint64 size = files.fileInfo().size();
+        if (!moveFile(files.filePath(), to)) fail("cannot move " + rel + " into the cache");
+        ++st.files;
+        st.bytes += size;
+    }
+
+    qInfo().noquote() << QString("cache pack: imported %1 item(s), %2 bytes; %3 already present, %4 rejected (%5 ms)")
+                             .arg(st.files).arg(st.bytes).arg(st.skipped).arg(st.rejected).arg(timer.elapsed());
+    return st;
+}
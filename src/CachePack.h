@@ -0,0 +1,35 @@
+#pragma once
+#include <QtCore>
+
+// Пакет кэша для машин без сети (или с узким каналом): всё, что нужно набору версий, в одном
+// потоковом .tar.gz — индексы и объекты assets, библиотеки, client.jar и version.json,
+// natives и, по желанию, Java-рантаймы. Пути внутри архива совпадают с путями в кэше,
+// первым идёт tesuto-pack.json (версии, sha1 каждого файла и цели симлинков).
+// Импорт распаковывает пакет рядом с кэшем, параллельно проверяет sha1, отбрасывает всё, чего нет
+// в манифесте пакета, и переносит в кэш переименованием только то, чего там ещё нет: новая машина готовится копированием с диска,
+// без тысяч HTTP-запросов.
+class CachePack {
+public:
+    struct Stats {
+        qint64 files    = 0; // записано в пакет / перенесено в кэш
+        qint64 bytes    = 0;
+        int    skipped  = 0; // импорт: уже было в кэше
+        int    rejected = 0; // импорт: не прошло проверку sha1
+    };
+
+    explicit CachePack(QString cacheRoot = QString());
+
+    // Версии, установленные в инстансы под gameRoot (по их манифестам)
+    static QStringList installedVersions(const QString& gameRoot);
+
+    // Собрать пакет для versionIds в outPath. withJava — положить и рантаймы, нужные этим версиям.
+    // Ошибки — std::runtime_error
+    Stats exportPack(const QString& gameRoot, const QStringList& versionIds, bool withJava,
+                     const QString& outPath) const;
+
+    // Влить пакет в кэш. Ошибки — std::runtime_error
+    Stats importPack(const QString& packPath) const;
+
+private:
+    QString cacheRoot_;
+};
@@ -0,0 +1,102 @@
+#include "CachePaths.h"
+#include "MojangAPI.h"
+#include "Util.h"
+#include <QSettings>
+#include <QStandardPaths>
+#include <cstdlib>
+#include <mutex>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CachePaths {
+
+static bool sharedUsable(const QString& dir)
+{
+    const QFileInfo fi(dir);
+    return fi.isDir() && fi.isWritable();
+}
+
+QString root()
+{
+    // 1) env override
+    if (const char* env = std::getenv("TESUTO_CACHE_DIR")) {
+        const QString s = QString::fromUtf8(env);
+        if (!s.isEmpty()) return s;
+    }
+    // 2) общий кэш машины
+    if (sharedEnabled()) {
+        const QString dir = sharedRoot();
+        if (sharedUsable(dir)) return dir;
+        static std::once_flag warned;
+        std::call_once(warned, [&] {
+            qWarning() << "shared cache" << dir << "is not writable, falling back to the per-user cache";
+        });
+    }
+    // 3) XDG
+    return userRoot();
+}
+
+QString userRoot()
+{
+    QString loc = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (loc.isEmpty()) loc = QDir::homePath() + "/.cache/tesuto-launcher";
+    return loc;
+}
+
+QString execRoot(const QString& cacheRoot)
+{
+    const QString base = cacheRoot.isEmpty() ? root() : cacheRoot;
+    const QString shared = QFileInfo(sharedRoot()).canonicalFilePath();
+    if (!shared.isEmpty() && QFileInfo(base).canonicalFilePath() == shared) return userRoot();
+    return base;
+}
+
+bool sharedEnabled()
+{
+    const QByteArray env = qgetenv("TESUTO_SHARED_CACHE").trimmed();
+    if (!env.isEmpty()) return env != "0";
+    return QSettings().value("cache/shared", false).toBool();
+}
+
+QString sharedRoot()
+{
+    return QSettings().value("cache/sharedDir", "/var/cache/tesuto").toString();
+}
+
+void prepareShared()
+{
+#ifdef Q_OS_UNIX
+    if (!sharedEnabled() || qEnvironmentVariableIsSet("TESUTO_CACHE_DIR")) return;
+    const QString dir = sharedRoot();
+    if (!sharedUsable(dir)) return;
+
+    // umask процесса: снимаем только запрет записи группе, остальное оставляем как настроил пользователь
+    const mode_t old = ::umask(0);
+    ::umask(old & ~mode_t(S_IWGRP));
+
+    // setgid на корне: подкаталоги наследуют группу и сам бит
+    struct stat st {};
+    const QByteArray path = QFile::encodeName(dir);
+    if (::stat(path.constData(), &st) == 0 && st.st_uid == ::geteuid()
+        && (st.st_mode & 02070) != 02070)
+        ::chmod(path.constData(), (st.st_mode & 07777) | 02070);
+#endif
+}
+
+QString nativesDirFor(const VersionResolved& v, const QString& cacheRoot)
+{
+    QStringList ids;
+    for (const auto& lib : v.libraries)
+        if (lib.isNative) ids << (lib.sha1.isEmpty() ? lib.path : lib.sha1);
+    ids.sort();
+    const QString key = QCryptographicHash::hash(ids.join('\n').toUtf8(), QCryptographicHash::Sha1)
+                            .toHex().left(16);
+
+    return joinPath(execRoot(cacheRoot), QString("natives/%1-%2-%3")
+                              .arg(v.id, QSysInfo::currentCpuArchitecture(), key));
+}
+
+} // namespace CachePaths
@@ -0,0 +1,42 @@
+#pragma once
+#include <QtCore>
+
+struct VersionResolved;
+
+// Пути внутри общего кэша лаунчера (общие для Installer и Launcher)
+namespace CachePaths {
+
+// Корень кэша: $TESUTO_CACHE_DIR, иначе общий системный кэш (если включён и доступен на запись),
+// иначе XDG cache (~/.cache/...)
+QString root();
+
+// Личный кэш пользователя (XDG) — для того, что нельзя делить между пользователями (реестр Java)
+QString userRoot();
+
+// Общий кэш на машину: один download на всех пользователей вместо одного на каждого.
+// Включается настройкой cache/shared или TESUTO_SHARED_CACHE=1; каталог — cache/sharedDir
+// (по умолчанию /var/cache/tesuto). Каталог готовит администратор: группа пользователей лаунчера
+// и setgid, например `install -d -m 2775 -g tesuto /var/cache/tesuto`.
+bool    sharedEnabled();
+QString sharedRoot();
+
+// Корень для исполняемого — natives и рантаймов Java (включая их runtimes/objects).
+// В общем кэше туда может писать любой из группы, а подложенный .so или bin/java запустили бы
+// другие пользователи, поэтому для общего кэша это личный кэш пользователя (userRoot()),
+// иначе — сам cacheRoot (пусто — root())
+QString execRoot(const QString& cacheRoot = QString());
+
+// Вызывается один раз при старте: в режиме общего кэша файлы и каталоги создаются
+// с правом записи для группы (umask без g+w), корень получает setgid, если мы его владелец.
+// Без права записи группе ядро (fs.protected_hardlinks) не даст другим пользователям
+// делать хардлинки на объекты кэша, и раскладка откатится на копирование.
+void prepareShared();
+
+// Общий каталог natives версии: <cache>/natives/<id>-<arch>-<key>,
+// key — из sha1 natives-jar'ов (другой набор jar'ов — другой каталог)
+QString nativesDirFor(const VersionResolved& v, const QString& cacheRoot = QString());
+
+// Маркер «natives распакованы полностью» внутри каталога natives
+inline QString nativesCompleteMarker(const QString& nativesDir) { return QDir(nativesDir).filePath(".complete"); }
+
+} // namespace CachePaths
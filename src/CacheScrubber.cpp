@@ -0,0 +1,314 @@
+#include "CacheScrubber.h"
+#include "CacheLock.h"
+#include "CachePaths.h"
+#include "IdlePriority.h"
+#include "InstallJournal.h"
+#include "InstallManifest.h"
+#include "InstanceStore.h"
+#include "Util.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSettings>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+constexpr int    kStartDelayMs = 60 * 1000;
+constexpr qint64 kChunk        = 1 << 20;
+constexpr qint64 kSaveEveryMs  = 5000;
+
+QString statePath(const QString& cacheRoot)
+{
+    return QDir(cacheRoot).filePath(".tesuto_scrub.json");
+}
+
+QJsonObject loadState(const QString& cacheRoot)
+{
+    QFile f(statePath(cacheRoot));
+    if (!f.open(QIODevice::ReadOnly)) return {};
+    return QJsonDocument::fromJson(f.readAll()).object();
+}
+
+void saveState(const QString& cacheRoot, const QJsonObject& st)
+{
+    QSaveFile f(statePath(cacheRoot));
+    if (!f.open(QIODevice::WriteOnly)) return;
+    f.write(QJsonDocument(st).toJson(QJsonDocument::Compact));
+    f.commit();
+}
+
+// Один и тот же inode (хардлинк файла инстанса на копию в кэше)
+bool sameFile(const QString& a, const QString& b)
+{
+#ifdef Q_OS_UNIX
+    struct stat sa {}, sb {};
+    if (::stat(QFile::encodeName(a).constData(), &sa) != 0) return false;
+    if (::stat(QFile::encodeName(b).constData(), &sb) != 0) return false;
+    return sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+#else
+    Q_UNUSED(a); Q_UNUSED(b);
+    return false;
+#endif
+}
+
+// sha1 с ограничением скорости: read — сколько прочитано с начала прохода, clock — его часы.
+// Пусто — файла нет или запрошена остановка (*stopped)
+QString throttledSha1(const QString& path, const std::atomic_bool& stop, qint64 rate,
+                      qint64* read, const QElapsedTimer& clock, bool* stopped)
+{
+    *stopped = false;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return {};
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    while (!f.atEnd()) {
+        if (stop.load()) { *stopped = true; return {}; }
+        const QByteArray chunk = f.read(kChunk);
+        if (chunk.isEmpty()) break;
+        h.addData(chunk);
+        *read += chunk.size();
+        // обгоняем лимит — спим, пока не окажемся в графике (мелкими шагами, чтобы слышать stop)
+        if (rate > 0) {
+            qint64 ahead = *read * 1000 / rate - clock.elapsed();
+            while (ahead > 0 && !stop.load()) {
+                QThread::msleep(ulong(qMin<qint64>(ahead, 200)));
+                ahead = *read * 1000 / rate - clock.elapsed();
+            }
+        }
+    }
+    return h.result().toHex();
+}
+
+} // namespace
+
+CacheScrubber::CacheScrubber(QString gameRoot, QString cacheRoot)
+    : gameRoot_(std::move(gameRoot))
+    , cacheRoot_(cacheRoot.isEmpty() ? CachePaths::root() : std::move(cacheRoot))
+{
+}
+
+QVector<CacheScrubber::Target> CacheScrubber::plan() const
+{
+    QVector<Target> out;
+
+    // манифесты инстансов: ожидаемые sha1 библиотек кэша (своего хэша у них нет) и файлы инстансов
+    // (библиотеки модлоадера — из его отдельного манифеста)
+    struct Loaded { QString dir; InstallManifest::Part part; InstallManifest m; };
+    QHash<QString, QString> libSha;
+    QVector<Loaded> manifests;
+    const InstanceStore store(gameRoot_);
+    for (const Instance& inst : store.list()) {
+        const QString dir = store.pathFor(inst);
+        for (const auto part : {InstallManifest::Part::Game, InstallManifest::Part::Loader}) {
+            InstallManifest m = InstallManifest::load(dir, part);
+            if (m.isEmpty()) continue;
+            for (const auto& f : m.files)
+                if (f.path.startsWith("libraries/")) libSha.insert(f.path, f.sha1);
+            manifests.push_back({dir, part, std::move(m)});
+        }
+    }
+
+    // кэш: content-addressed объекты (имя файла — sha1)
+    for (const QString& sub : {QString("assets/objects"), QString("runtimes/objects")}) {
+        const QString base = joinPath(sub.startsWith("runtimes/") ? CachePaths::execRoot(cacheRoot_) : cacheRoot_, sub);
+        QDirIterator it(base, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            const QString sha = it.fileName();
+            if (sha.size() != 40) continue;
+            // ключ шард-лока — как у писателя (RuntimeStore::ensureMojang берёт "runtimes/<sha1>")
+            out.push_back({"c/" + sub + "/" + QDir(base).relativeFilePath(it.filePath()), it.filePath(), sha,
+                           QString(), sub.startsWith("runtimes/") ? "runtimes/" + sha : sha});
+        }
+    }
+    // библиотеки
+    {
+        const QString base = joinPath(cacheRoot_, "libraries");
+        QDirIterator it(base, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            const QString rel = "libraries/" + QDir(base).relativeFilePath(it.filePath());
+            const QString sha = libSha.value(rel);
+            if (!sha.isEmpty()) out.push_back({"c/" + rel, it.filePath(), sha, QString(), rel});
+        }
+    }
+    // client.jar: sha1 из version.json рядом
+    {
+        const QDir vd(joinPath(cacheRoot_, "versions"));
+        for (const QString& id : vd.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            const QString jar = vd.filePath(id + "/" + id + ".jar");
+            QFile jf(vd.filePath(id + "/" + id + ".json"));
+            if (!QFileInfo::exists(jar) || !jf.open(QIODevice::ReadOnly)) continue;
+            const QString sha = QJsonDocument::fromJson(jf.readAll()).object()
+                .value("downloads").toObject().value("client").toObject().value("sha1").toString();
+            if (sha.size() == 40)
+                out.push_back({"c/versions/" + id + "/" + id + ".jar", jar, sha, QString(), "versions/" + id});
+        }
+    }
+
+    // инстансы: только то, чему установка верит по stat. Идущую или прерванную установку не трогаем
+    for (const auto& im : manifests) {
+        const QString& dir = im.dir;
+        if (InstallJournal::pending(dir)) continue;
+        const QString id = QDir(gameRoot_).relativeFilePath(dir);
+        const QHash<QString, QString> valid = im.m.validOnDisk(dir);
+        for (auto it = valid.cbegin(); it != valid.cend(); ++it) {
+            const QString path = joinPath(dir, it.key());
+            // хардлинк на копию в кэше проверяется вместе с кэшем (пути внутри совпадают)
+            if (sameFile(path, joinPath(cacheRoot_, it.key()))) continue;
+            out.push_back({"i/" + id + "/" + it.key(), path, it.value(), dir, QString(), im.part});
+        }
+    }
+
+    std::sort(out.begin(), out.end(), [](const Target& a, const Target& b) { return a.key < b.key; });
+    return out;
+}
+
+// Хардлинки объекта в инстансах — тот же inode: stat у них не изменился, и манифест продолжил бы им
+// верить. Удаляем их вместе с объектом и выбрасываем из манифеста — установка перед запуском докачает
+void CacheScrubber::dropInstanceLinks(const QString& cachePath) const
+{
+    const QString rel = QDir(cacheRoot_).relativeFilePath(cachePath);
+    const InstanceStore store(gameRoot_);
+    for (const Instance& inst : store.list()) {
+        const QString dir = store.pathFor(inst);
+        for (const auto part : {InstallManifest::Part::Game, InstallManifest::Part::Loader}) {
+            InstallManifest m = InstallManifest::load(dir, part);
+            if (!m.files.contains(rel)) continue;
+            const QString path = joinPath(dir, rel);
+            if (!sameFile(path, cachePath)) continue;
+            const bool removed = QFile::remove(path);
+            m.files.remove(rel);
+            m.save(dir, part);
+            qWarning().noquote() << QString("scrub: %1 shares the corrupt cache object, %2")
+                                        .arg(path, removed ? "removed" : "cannot remove");
+        }
+    }
+}
+
+bool CacheScrubber::quarantine(const Target& t) const
+{
+    bool removed = false;
+    if (t.instanceDir.isEmpty()) {
+        // объект кэша может прямо сейчас раскладываться установкой — удаляем, только когда установок нет;
+        // под шард-локом перепроверяем: другой процесс мог уже положить на это место целый файл
+        CacheRootsLock exclusive(cacheRoot_, CacheLock::Mode::Exclusive, /*wait*/ false);
+        if (!exclusive.held()) {
+            qInfo() << "scrub: corrupt" << t.path << "left for the next pass, cache is in use";
+            return false;
+        }
+        // объекты рантаймов — в execRoot, и шард-лок у них тамошний
+        const QString lockRoot = t.lockKey.startsWith("runtimes/") ? CachePaths::execRoot(cacheRoot_) : cacheRoot_;
+        CacheLock shard(CacheLock::shardFile(lockRoot, t.lockKey), CacheLock::Mode::Exclusive);
+        if (sha1File(t.path) == t.sha1) return false;
+        dropInstanceLinks(t.path);
+        removed = QFile::remove(t.path);
+    } else {
+        // инстанс могли переустановить после планирования — удаляем, только если запись манифеста та же
+        const QString rel = QDir(t.instanceDir).relativeFilePath(t.path);
+        const InstallManifest m = InstallManifest::load(t.instanceDir, t.part);
+        if (m.validOnDisk(t.instanceDir).value(rel) != t.sha1) return false;
+        if (sha1File(t.path) == t.sha1) return false;
+        removed = QFile::remove(t.path);
+    }
+    qWarning().noquote() << QString("scrub: %1 does not match sha1 %2, %3")
+                                .arg(t.path, t.sha1, removed ? "removed" : "cannot remove");
+    return removed;
+}
+
+CacheScrubber::Report CacheScrubber::run(const std::atomic_bool& stop, qint64 rateBytes) const
+{
+    Report r;
+    // один проход на кэш, даже если лаунчеров несколько
+    CacheLock single(CacheLock::namedFile(cacheRoot_, "scrub"), CacheLock::Mode::Exclusive, /*wait*/ false);
+    if (!single.held()) {
+        qInfo() << "scrub: already running in another process";
+        return r;
+    }
+
+    QJsonObject st = loadState(cacheRoot_);
+    const QString cursor = st.value("cursor").toString();
+    const QVector<Target> targets = plan();
+    auto it = std::upper_bound(targets.cbegin(), targets.cend(), cursor,
+                               [](const QString& c, const Target& t) { return c < t.key; });
+    if (cursor.isEmpty()) st.insert("passStarted", QDateTime::currentMSecsSinceEpoch());
+    qInfo().noquote() << QString("scrub: %1 file(s) to verify%2")
+                             .arg(targets.cend() - it)
+                             .arg(cursor.isEmpty() ? QString() : QString(", resuming after %1").arg(cursor));
+
+    QElapsedTimer clock; clock.start();
+    QElapsedTimer sinceSave; sinceSave.start();
+    qint64 read = 0;
+    for (; it != targets.cend(); ++it) {
+        bool stopped = false;
+        const QString sha = throttledSha1(it->path, stop, rateBytes, &read, clock, &stopped);
+        if (stopped) break;
+        // пропавший файл — не порча (его мог убрать сборщик мусора или переустановка)
+        if (!sha.isEmpty() && sha != it->sha1 && quarantine(*it)) ++r.corrupt;
+        ++r.files;
+        st.insert("cursor", it->key);
+        if (sinceSave.elapsed() >= kSaveEveryMs) {
+            saveState(cacheRoot_, st);
+            sinceSave.restart();
+        }
+    }
+    r.bytes    = read;
+    r.finished = (it == targets.cend());
+    if (r.finished) {
+        st.insert("cursor", QString());
+        st.insert("lastFullPass", QDateTime::currentMSecsSinceEpoch());
+    }
+    st.insert("corrupt", st.value("corrupt").toInt() + r.corrupt);
+    saveState(cacheRoot_, st);
+
+    qInfo().noquote() << QString("scrub: %1 file(s), %2 MiB verified, %3 corrupt removed%4 (%5 s)")
+                             .arg(r.files).arg(r.bytes >> 20).arg(r.corrupt)
+                             .arg(r.finished ? QString(", pass complete") : QString(", paused"))
+                             .arg(clock.elapsed() / 1000);
+    return r;
+}
+
+void CacheScrubber::runInBackground(const QString& gameRoot)
+{
+    QSettings s;
+    if (!s.value("scrub/enabled", true).toBool()) return;
+    const QString root = CachePaths::root();
+
+    // начатый проход продолжаем всегда; законченный повторяем не чаще раза в intervalDays
+    const QJsonObject st = loadState(root);
+    const qint64 interval = qint64(qMax(1, s.value("scrub/intervalDays", 7).toInt())) * 24 * 3600 * 1000;
+    const qint64 last = qint64(st.value("lastFullPass").toDouble());
+    if (st.value("cursor").toString().isEmpty() && QDateTime::currentMSecsSinceEpoch() - last < interval)
+        return;
+
+    const int envRate = qEnvironmentVariableIntValue("TESUTO_SCRUB_RATE_MIB");
+    const qint64 rate = qint64(envRate > 0 ? envRate : s.value("scrub/rateMiB", 16).toInt()) << 20;
+
+    QTimer::singleShot(kStartDelayMs, qApp, [gameRoot, root, rate] {
+        static std::atomic_bool stop{false};
+        QThread* t = QThread::create([gameRoot, root, rate] {
+            IdleIoPriority idle;
+            Q_UNUSED(idle);
+            try {
+                CacheScrubber(gameRoot, root).run(stop, rate);
+            } catch (const std::exception& e) {
+                qWarning() << "scrub failed:" << e.what();
+            }
+        });
+        QObject::connect(t, &QThread::finished, t, &QObject::deleteLater);
+        // при выходе прерываем: курсор сохранится, проход продолжится при следующем запуске
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, t, [t] {
+            stop.store(true);
+            t->wait();
+        });
+        t->start(QThread::IdlePriority);
+    });
+}
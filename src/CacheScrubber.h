@@ -0,0 +1,48 @@
+#pragma once
+#include "InstallManifest.h"
+#include <QtCore>
+#include <atomic>
+
+// Фоновая проверка целостности кэша и инстансов: перехэширование с idle-приоритетом CPU и диска
+// и ограничением скорости чтения. Ищет тихую порчу — файлы, целые по stat (размер+mtime), но с другим
+// sha1: установка доверяет stat'у и сама их не заметит.
+// Битое удаляется: объект кэша перекачает следующая установка, файл инстанса — установка перед
+// запуском (манифест больше не сходится с диском) или «Проверить и починить» в редакторе сборки.
+// Вместе с объектом кэша удаляются его хардлинки в инстансах и их записи в манифестах.
+// Обход идёт в фиксированном порядке, курсор лежит в <cache>/.tesuto_scrub.json —
+// после перезапуска лаунчера проверка продолжается с того же места.
+class CacheScrubber {
+public:
+    struct Report {
+        qint64 files    = 0;
+        qint64 bytes    = 0;
+        int    corrupt  = 0;     // найдено и удалено
+        bool   finished = false; // проход дошёл до конца (иначе продолжится в следующий раз)
+    };
+
+    explicit CacheScrubber(QString gameRoot, QString cacheRoot = QString());
+
+    // Проход или продолжение прерванного. stop — запрос остановки (курсор сохраняется);
+    // rateBytes — лимит чтения в секунду, 0 — без ограничения
+    Report run(const std::atomic_bool& stop, qint64 rateBytes) const;
+
+    // Настройки scrub/enabled (вкл.), scrub/intervalDays (7), scrub/rateMiB (16; $TESUTO_SCRUB_RATE_MIB).
+    // Отдельный поток с idle-приоритетом, стартует через минуту после запуска, останавливается при выходе
+    static void runInBackground(const QString& gameRoot);
+
+private:
+    struct Target {
+        QString key;         // порядок обхода и курсор
+        QString path;
+        QString sha1;
+        QString instanceDir; // пусто — файл кэша
+        QString lockKey;     // ключ шард-лока (файл кэша)
+        InstallManifest::Part part = InstallManifest::Part::Game; // манифест файла инстанса
+    };
+    QVector<Target> plan() const;
+    bool quarantine(const Target& t) const;
+    void dropInstanceLinks(const QString& cachePath) const;
+
+    QString gameRoot_;
+    QString cacheRoot_;
+};
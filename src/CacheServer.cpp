@@ -0,0 +1,222 @@
+#include "CacheServer.h"
+#include "CachePaths.h"
+#include <QSettings>
+#include <QTcpSocket>
+#include <QTimer>
+#include <memory>
+
+namespace {
+
+constexpr qint64 kMaxHeader = 16 * 1024;  // длиннее — не наш клиент
+constexpr qint64 kChunk     = 64 * 1024;
+constexpr qint64 kHighWater = 256 * 1024; // сколько держим в буфере сокета
+constexpr int    kIdleMs    = 30 * 1000;  // соединение без чтения и записи столько — закрываем
+constexpr int    kMaxConns  = 64;         // одновременных соединений; лишние сразу закрываются
+
+struct Conn {
+    QTcpSocket* sock = nullptr;
+    QByteArray  in;
+    QFile       file;
+    qint64      left      = 0;
+    bool        keepAlive = true;
+};
+
+QByteArray statusLine(int code)
+{
+    switch (code) {
+    case 200: return "HTTP/1.1 200 OK\r\n";
+    case 400: return "HTTP/1.1 400 Bad Request\r\n";
+    case 404: return "HTTP/1.1 404 Not Found\r\n";
+    case 405: return "HTTP/1.1 405 Method Not Allowed\r\n";
+    case 431: return "HTTP/1.1 431 Request Header Fields Too Large\r\n";
+    default:  return "HTTP/1.1 500 Internal Server Error\r\n";
+    }
+}
+
+void sendHead(Conn& c, int code, qint64 length, const QByteArray& type = "application/octet-stream")
+{
+    QByteArray h = statusLine(code);
+    h += "Server: tesuto-cache\r\n";
+    h += "Content-Type: " + type + "\r\n";
+    h += "Content-Length: " + QByteArray::number(length) + "\r\n";
+    h += c.keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    h += "\r\n";
+    c.sock->write(h);
+}
+
+void sendEmpty(Conn& c, int code)
+{
+    sendHead(c, code, 0, "text/plain");
+}
+
+} // namespace
+
+CacheServer::CacheServer(QString cacheRoot, QObject* parent)
+    : QObject(parent)
+    , cacheRoot_(cacheRoot.isEmpty() ? CachePaths::root() : std::move(cacheRoot))
+{
+    connect(&server_, &QTcpServer::newConnection, this, &CacheServer::onNewConnection);
+}
+
+bool CacheServer::listen(quint16 port, const QHostAddress& address)
+{
+    if (!server_.listen(address, port)) return false;
+    qInfo().noquote() << QString("lan cache: serving %1 on port %2").arg(cacheRoot_).arg(server_.serverPort());
+    return true;
+}
+
+CacheServer* CacheServer::startFromSettings(QObject* parent)
+{
+    QSettings s;
+    if (!s.value("lan/serve", false).toBool()) return nullptr;
+    auto* srv = new CacheServer(QString(), parent);
+    const quint16 port = quint16(s.value("lan/port", kDefaultPort).toUInt());
+    if (!srv->listen(port)) {
+        qWarning() << "lan cache: cannot listen on port" << port << srv->errorString();
+        delete srv;
+        return nullptr;
+    }
+    return srv;
+}
+
+QString CacheServer::resolve(const QString& target) const
+{
+    QString path = target.section('?', 0, 0);
+    path = QUrl::fromPercentEncoding(path.toUtf8());
+    if (path.contains('\\') || path.contains(QChar(0))) return QString();
+
+    QString base, rel;
+    static const QString kResources = "/resources/", kRuntimes = "/runtimes/", kLibraries = "/libraries/";
+    static const QRegularExpression obj("^([0-9a-f]{2})/([0-9a-f]{40})$");
+    if (path.startsWith(kResources) || path.startsWith(kRuntimes)) {
+        const bool runtime = path.startsWith(kRuntimes);
+        rel = path.mid(runtime ? kRuntimes.size() : kResources.size());
+        const auto m = obj.match(rel);
+        if (!m.hasMatch() || m.captured(2).left(2) != m.captured(1)) return QString();
+        base = runtime ? QDir(CachePaths::execRoot(cacheRoot_)).filePath("runtimes/objects")
+                       : QDir(cacheRoot_).filePath("assets/objects");
+    } else if (path.startsWith(kLibraries)) {
+        rel = path.mid(kLibraries.size());
+        // ни пустых сегментов, ни «.», «..» и скрытых файлов (временные файлы записи)
+        for (const QString& seg : rel.split('/'))
+            if (seg.isEmpty() || seg.startsWith('.')) return QString();
+        base = QDir(cacheRoot_).filePath("libraries");
+    } else {
+        return QString();
+    }
+
+    const QFileInfo fi(QDir(base).filePath(rel));
+    if (!fi.isFile()) return QString();
+    // симлинк наружу каталога не отдаём
+    const QString canonBase = QFileInfo(base).canonicalFilePath();
+    if (canonBase.isEmpty() || !fi.canonicalFilePath().startsWith(canonBase + "/")) return QString();
+    return fi.absoluteFilePath();
+}
+
+void CacheServer::onNewConnection()
+{
+    while (QTcpSocket* sock = server_.nextPendingConnection()) {
+        if (connections_ >= kMaxConns) {
+            sock->abort();
+            sock->deleteLater();
+            continue;
+        }
+        ++connections_;
+        connect(sock, &QObject::destroyed, this, [this] { --connections_; });
+
+        auto c = std::make_shared<Conn>();
+        c->sock = sock;
+        // входной буфер Qt ограничен: пока отдаём файл, запросы не читаем — клиента держит TCP
+        sock->setReadBufferSize(kMaxHeader);
+
+        // молчащее соединение (ни запросов, ни чтения ответа) не держим вечно
+        auto* idle = new QTimer(sock);
+        idle->setSingleShot(true);
+        idle->setInterval(kIdleMs);
+        connect(idle, &QTimer::timeout, sock, &QTcpSocket::abort);
+        idle->start();
+
+        // отдать следующий кусок файла, пока буфер сокета не заполнился
+        auto pump = [c] {
+            while (c->left > 0 && c->sock->bytesToWrite() < kHighWater) {
+                const QByteArray chunk = c->file.read(qMin(kChunk, c->left));
+                if (chunk.isEmpty()) { c->sock->abort(); c->left = 0; break; } // файл пропал на ходу
+                c->sock->write(chunk);
+                c->left -= chunk.size();
+            }
+            if (c->left == 0 && c->file.isOpen()) c->file.close();
+        };
+
+        // разобрать и обслужить запросы, уже лежащие во входном буфере
+        auto serve = [this, c, pump] {
+            while (!c->file.isOpen()) {
+                // не больше заголовка (+1 байт, чтобы заметить превышение): c->in не растёт без границ
+                c->in += c->sock->read(qMax<qint64>(0, kMaxHeader + 1 - c->in.size()));
+                const int end = c->in.indexOf("\r\n\r\n");
+                if (end < 0) {
+                    if (c->in.size() > kMaxHeader) {
+                        c->keepAlive = false;
+                        sendEmpty(*c, 431);
+                        c->sock->disconnectFromHost();
+                    }
+                    return;
+                }
+                const QList<QByteArray> lines = c->in.left(end).split('\n');
+                c->in.remove(0, end + 4);
+
+                const QList<QByteArray> req = lines.value(0).trimmed().split(' ');
+                if (req.size() != 3 || !req[2].startsWith("HTTP/1.")) {
+                    c->keepAlive = false;
+                    sendEmpty(*c, 400);
+                    c->sock->disconnectFromHost();
+                    return;
+                }
+                c->keepAlive = (req[2] == "HTTP/1.1");
+                for (int i = 1; i < lines.size(); ++i) {
+                    const QByteArray l = lines[i].trimmed().toLower();
+                    if (l.startsWith("connection:"))
+                        c->keepAlive = !l.contains("close") && (c->keepAlive || l.contains("keep-alive"));
+                }
+
+                const QByteArray method = req[0];
+                const bool head = (method == "HEAD");
+                if (method != "GET" && !head) {
+                    sendEmpty(*c, 405);
+                } else if (req[1] == "/ping") {
+                    const QByteArray body = "tesuto-cache\n";
+                    sendHead(*c, 200, body.size(), "text/plain");
+                    if (!head) c->sock->write(body);
+                } else {
+                    const QString path = resolve(QString::fromUtf8(req[1]));
+                    c->file.setFileName(path);
+                    if (path.isEmpty() || !c->file.open(QIODevice::ReadOnly)) {
+                        sendEmpty(*c, 404);
+                    } else {
+                        sendHead(*c, 200, c->file.size());
+                        c->left = head ? 0 : c->file.size();
+                        pump();
+                    }
+                }
+                if (!c->keepAlive && !c->file.isOpen()) {
+                    c->sock->disconnectFromHost();
+                    return;
+                }
+            }
+        };
+
+        connect(sock, &QTcpSocket::readyRead, this, [idle, serve] {
+            idle->start();
+            serve();
+        });
+        connect(sock, &QTcpSocket::bytesWritten, this, [c, idle, pump, serve] {
+            idle->start();
+            if (!c->file.isOpen()) return;
+            pump();
+            if (c->file.isOpen()) return;
+            // ответ отдан целиком — следующий запрос из буфера (pipelining) или закрытие
+            if (!c->keepAlive) c->sock->disconnectFromHost();
+            else serve();
+        });
+        connect(sock, &QTcpSocket::disconnected, sock, &QObject::deleteLater);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <QtCore>
+#include <QTcpServer>
+
+// Раздача общего кэша по HTTP в локальной сети: один лаунчер качает из интернета,
+// остальные ставят его первым зеркалом (lan/mirror) и берут файлы у него.
+// Пути повторяют раскладку официальных серверов:
+//   /resources/xx/<sha1>   — как resources.download.minecraft.net (assets/objects кэша)
+//   /runtimes/xx/<sha1>    — объекты Java-рантаймов Mojang (runtimes/objects)
+//   /libraries/<maven>     — как libraries.minecraft.net (libraries кэша)
+//   /ping                  — проверка живости для клиентов
+// Только GET/HEAD и только обычные файлы внутри этих каталогов; целостность проверяет клиент (sha1).
+class CacheServer : public QObject {
+    Q_OBJECT
+public:
+    explicit CacheServer(QString cacheRoot = QString(), QObject* parent = nullptr);
+
+    bool    listen(quint16 port, const QHostAddress& address = QHostAddress::Any);
+    quint16 port() const { return server_.serverPort(); }
+    QString errorString() const { return server_.errorString(); }
+
+    // Порт по умолчанию (lan/port)
+    static constexpr quint16 kDefaultPort = 8627;
+
+    // По настройкам lan/serve, lan/port; nullptr — раздача выключена или порт занят
+    static CacheServer* startFromSettings(QObject* parent);
+
+    // Сопоставить путь запроса файлу кэша; пусто — такого нет или путь недопустим
+    QString resolve(const QString& target) const;
+
+private:
+    void onNewConnection();
+
+    int        connections_ = 0; // до server_: сокеты, удаляемые вместе с ним, ещё уменьшают счётчик
+    QTcpServer server_;
+    QString    cacheRoot_;
+};
@@ -0,0 +1,45 @@
+#include "CancelToken.h"
+#include <QNetworkReply>
+
+void CancelToken::cancel()
+{
+    QMutexLocker lk(&mx_);
+    if (cancelled_.exchange(true)) return;
+    // под мьютексом: после unsubscribe() подписчик уже точно не будет вызван
+    for (const auto& fn : std::as_const(subs_)) fn();
+}
+
+int CancelToken::subscribe(std::function<void()> fn)
+{
+    QMutexLocker lk(&mx_);
+    if (cancelled_.load()) {
+        fn();
+        return -1;
+    }
+    const int id = nextId_++;
+    subs_.insert(id, std::move(fn));
+    return id;
+}
+
+void CancelToken::unsubscribe(int id)
+{
+    if (id < 0) return;
+    QMutexLocker lk(&mx_);
+    subs_.remove(id);
+}
+
+CancelToken::Watch::Watch(const std::shared_ptr<CancelToken>& token, QNetworkReply* reply)
+    : token_(token)
+{
+    if (!token_ || !reply) return;
+    // reply живёт в потоке запроса (его QEventLoop сейчас крутится) — abort отправляем туда.
+    // Если reply удалят раньше, Qt выбросит и это событие
+    id_ = token_->subscribe([reply] {
+        QMetaObject::invokeMethod(reply, [reply] { reply->abort(); }, Qt::QueuedConnection);
+    });
+}
+
+CancelToken::Watch::~Watch()
+{
+    if (token_) token_->unsubscribe(id_);
+}
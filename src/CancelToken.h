@@ -0,0 +1,44 @@
+#pragma once
+#include <QtCore>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+class QNetworkReply;
+
+// Установка отменена через CancelToken
+struct InstallCancelled : std::runtime_error {
+    InstallCancelled() : std::runtime_error("Cancelled") {}
+};
+
+// Кооперативная отмена установки. cancel() можно звать из любого потока (обычно из GUI):
+// запросы, которые сейчас ждут в Net, прерываются сразу (abort в потоке ответа),
+// рабочие задачи видят флаг на ближайшей проверке и бросают InstallCancelled.
+class CancelToken {
+public:
+    void cancel();
+    bool cancelled() const { return cancelled_.load(); }
+    void throwIfCancelled() const { if (cancelled()) throw InstallCancelled(); }
+
+    // На время жизни объекта: отмена токена прерывает reply. token может быть пустым
+    class Watch {
+    public:
+        Watch(const std::shared_ptr<CancelToken>& token, QNetworkReply* reply);
+        ~Watch();
+        Watch(const Watch&) = delete;
+        Watch& operator=(const Watch&) = delete;
+    private:
+        std::shared_ptr<CancelToken> token_;
+        int id_ = -1;
+    };
+
+private:
+    int  subscribe(std::function<void()> fn); // уже отменён — fn вызывается сразу
+    void unsubscribe(int id);
+
+    std::atomic_bool                  cancelled_{false};
+    QMutex                            mx_;
+    int                               nextId_ = 0;
+    QHash<int, std::function<void()>> subs_;
+};
@@ -1,15 +1,102 @@
 #include "Downloader.h"
+#include <QSettings>
+#include <atomic>
+
+namespace {
+
+// Состояние LAN-зеркала на процесс: /ping проверяем не чаще раза в минуту,
+// после неудачного запроса к зеркалу — не чаще раза в 10 с. Пингует один поток и без мьютекса
+struct LanState {
+    QMutex         mx;
+    QWaitCondition checked;
+    QString        mirror;
+    bool           alive     = false;
+    bool           checking  = false;
+    qint64         checkedMs = -1;
+};
+
+std::atomic<qint64> g_fetched{0};
+
+LanState& lanState()
+{
+    static LanState s;
+    return s;
+}
+
+QString configuredLan()
+{
+    QString m = qEnvironmentVariable("TESUTO_LAN_MIRROR").trimmed();
+    if (m.isEmpty()) m = QSettings().value("lan/mirror").toString().trimmed();
+    while (m.endsWith('/')) m.chop(1);
+    return m;
+}
+
+int lanTimeoutMs()
+{
+    const int t = qEnvironmentVariableIntValue("TESUTO_LAN_TIMEOUT_MS");
+    return t > 0 ? t : 3000;
+}
+
+bool lanAlive(const QString& mirror, bool suspect)
+{
+    LanState& st = lanState();
+    {
+        QMutexLocker lk(&st.mx);
+        for (;;) {
+            const bool known = st.mirror == mirror && st.checkedMs >= 0;
+            const qint64 age = QDateTime::currentMSecsSinceEpoch() - st.checkedMs;
+            if (known && age < (suspect ? 10000 : 60000)) return st.alive;
+            if (!st.checking) break;
+            // пингует другой поток: прежний ответ годится, пока не пришёл новый; ответа нет — ждём его
+            if (known) return st.alive;
+            st.checked.wait(&st.mx);
+        }
+        st.checking = true;
+    }
+
+    bool alive = false;
+    try {
+        Net net;
+        alive = net.getBytes(QUrl(mirror + "/ping"), lanTimeoutMs()).startsWith("tesuto-cache");
+    } catch (...) {
+        alive = false;
+    }
+    {
+        QMutexLocker lk(&st.mx);
+        st.mirror    = mirror;
+        st.alive     = alive;
+        st.checkedMs = QDateTime::currentMSecsSinceEpoch();
+        st.checking  = false;
+    }
+    st.checked.wakeAll();
+    if (!alive) qInfo() << "lan mirror" << mirror << "is not reachable, using internet mirrors";
+    return alive;
+}
+
+} // namespace
 
 Downloader::Downloader(Net& net) : net_(net) {}
 
+QList<QUrl> Downloader::lanMirror(const QString& kind)
+{
+    const QString m = configuredLan();
+    if (m.isEmpty() || !lanAlive(m, false)) return {};
+    return { QUrl(m + "/" + kind) };
+}
+
 QByteArray Downloader::getWithMirrors(const QList<QUrl>& bases, const QString& rel) {
     const int to = qEnvironmentVariableIntValue("TESUTO_NET_TIMEOUT_MS") > 0
                    ? qgetenv("TESUTO_NET_TIMEOUT_MS").toInt()
                    : 12000;
     Net::HeaderList h = { {"Accept-Encoding", "identity"} };
+    const QString lan = configuredLan();
 
     for (const auto& base : bases) {
-        for (int attempt = 0; attempt < 2; ++attempt) {
+        // LAN-зеркало: одна короткая попытка; промах (404) — обычное дело, идём в интернет
+        const bool isLan = !lan.isEmpty() && base.toString().startsWith(lan + "/");
+        if (isLan && !lanAlive(lan, false)) continue;
+
+        for (int attempt = 0; attempt < (isLan ? 1 : 2); ++attempt) {
             try {
                 QUrl u = base;
                 if (!rel.isEmpty()) {
@@ -17,13 +104,39 @@ QByteArray Downloader::getWithMirrors(const QList<QUrl>& bases, const QString& r
                     if (b.endsWith('/')) b.chop(1);
                     u = QUrl(b + "/" + rel);
                 }
-                return net_.getBytes(u, to, h);
+                const QByteArray data = net_.getBytes(u, isLan ? lanTimeoutMs() : to, h);
+                g_fetched.fetch_add(data.size());
+                return data;
+            } catch (const InstallCancelled&) {
+                throw; // отмену не маскируем перебором зеркал
             } catch (const std::exception&) {
                 // пробуем ещё/следующий
             } catch (...) {
                 // на всякий случай: не даём неизвестным исключениям пробить установку без текста
             }
         }
+        // зеркало могло пропасть посреди установки — перепроверим, чтобы не ждать таймаут на каждом файле
+        if (isLan) lanAlive(lan, true);
     }
     throw std::runtime_error("All mirrors failed");
 }
+
+qint64 Downloader::bytesFetched()
+{
+    return g_fetched.load();
+}
+
+void Downloader::recordThroughput(qint64 bytes, qint64 ms)
+{
+    // мелкие установки (всё из кэша) о скорости сети ничего не говорят
+    if (bytes < (qint64(4) << 20) || ms < 1000) return;
+    const qint64 bps = bytes * 1000 / ms;
+    QSettings s;
+    const qint64 old = s.value("net/throughputBps", 0).toLongLong();
+    s.setValue("net/throughputBps", old > 0 ? (old * 2 + bps) / 3 : bps);
+}
+
+qint64 Downloader::throughput()
+{
+    return QSettings().value("net/throughputBps", 0).toLongLong();
+}
@@ -9,6 +9,20 @@ public:
     // Если rel пустая — base считается полным URL файла.
     QByteArray getWithMirrors(const QList<QUrl>& bases, const QString& rel);
 
+    // Одиночный запрос без повторов и зеркал — для необязательных проб (например, индекс дельт)
+    Net& net() { return net_; }
+
+    // LAN-зеркало (lan/mirror или $TESUTO_LAN_MIRROR, см. CacheServer): { <mirror>/<kind> },
+    // если оно настроено и отвечает на /ping, иначе пусто. kind — "resources" или "libraries".
+    // Ставится первым в список зеркал; промах по нему стоит одного быстрого 404.
+    static QList<QUrl> lanMirror(const QString& kind);
+
+    // Скорость сети для оценки времени установки: байт скачано процессом, сглаженная скорость
+    // прошлых установок (net/throughputBps, байт/с; 0 — ещё не измерена)
+    static qint64 bytesFetched();
+    static void   recordThroughput(qint64 bytes, qint64 ms);
+    static qint64 throughput();
+
 private:
     Net& net_;
 };
@@ -0,0 +1,301 @@
+#include "FilePlacer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QCoreApplication>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#else
+#include <filesystem>
+#endif
+
+// -------------------- кэш стратегий по паре ФС --------------------
+
+namespace {
+
+using FsKey = QPair<quint64, quint64>; // (st_dev источника, st_dev каталога назначения)
+
+QMutex              g_strategyMx;
+QHash<FsKey, int>   g_firstStrategy;   // с какой стратегии начинать для пары ФС
+
+int cachedStart(const FsKey& k)
+{
+    QMutexLocker lk(&g_strategyMx);
+    return g_firstStrategy.value(k, int(FilePlacer::Strategy::Hardlink));
+}
+
+void rememberStart(const FsKey& k, int s)
+{
+    QMutexLocker lk(&g_strategyMx);
+    g_firstStrategy.insert(k, s);
+}
+
+#ifdef Q_OS_LINUX
+// Имя временного файла рядом с dst: создаём под ним и подменяем через rename.
+// pid — кэш может быть общим у нескольких процессов, id потоков у них совпадают (как в IoBatch)
+QByteArray tmpNameFor(const QByteArray& name)
+{
+    return name + ".tesuto-tmp-" + QByteArray::number(QCoreApplication::applicationPid())
+                + "-" + QByteArray::number(quintptr(QThread::currentThreadId()), 16);
+}
+
+// Ошибки, которые говорят «эта стратегия не работает для данной пары ФС вообще»,
+// а не «не получилось с конкретным файлом» (EMLINK, EACCES, EPERM — например,
+// fs.protected_hardlinks на чужом файле общего кэша — и т.п.)
+bool isStructuralError(int err)
+{
+    return err == EXDEV || err == EOPNOTSUPP || err == ENOTSUP || err == ENOSYS
+        || err == EINVAL || err == ENOTTY;
+}
+
+struct Fd {
+    int fd = -1;
+    explicit Fd(int f) : fd(f) {}
+    ~Fd() { if (fd >= 0) ::close(fd); }
+    Fd(const Fd&) = delete;
+    Fd& operator=(const Fd&) = delete;
+};
+
+// Открыть пару дескрипторов для копирующих стратегий. dst создаётся с правами src.
+bool openPair(int sdir, const char* s, int ddir, const char* d, int& sfd, int& dfd, struct stat& st)
+{
+    sfd = ::openat(sdir, s, O_RDONLY | O_CLOEXEC);
+    if (sfd < 0) return false;
+    if (::fstat(sfd, &st) != 0) { const int e = errno; ::close(sfd); sfd = -1; errno = e; return false; }
+    dfd = ::openat(ddir, d, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 0777);
+    if (dfd < 0) { const int e = errno; ::close(sfd); sfd = -1; errno = e; return false; }
+    return true;
+}
+
+bool tryReflink(int sdir, const char* s, int ddir, const char* d, int* err)
+{
+    int sfd = -1, dfd = -1; struct stat st{};
+    if (!openPair(sdir, s, ddir, d, sfd, dfd, st)) { *err = errno; return false; }
+    Fd a(sfd), b(dfd);
+    if (::ioctl(dfd, FICLONE, sfd) == 0) return true;
+    *err = errno;
+    ::unlinkat(ddir, d, 0);
+    return false;
+}
+
+// copy_file_range (ядро копирует само, без прохода через userspace); если ядро/ФС не умеют — sendfile
+bool tryCopyRange(int sdir, const char* s, int ddir, const char* d, int* err)
+{
+    int sfd = -1, dfd = -1; struct stat st{};
+    if (!openPair(sdir, s, ddir, d, sfd, dfd, st)) { *err = errno; return false; }
+    Fd a(sfd), b(dfd);
+
+    off_t left = st.st_size;
+    bool useSendfile = false;
+    while (left > 0) {
+        ssize_t n = -1;
+        if (!useSendfile) {
+            n = ::copy_file_range(sfd, nullptr, dfd, nullptr, size_t(left), 0);
+            if (n < 0 && left == st.st_size
+                && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useSendfile = true;
+                continue;
+            }
+        } else {
+            n = ::sendfile(dfd, sfd, nullptr, size_t(left));
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            *err = (n < 0) ? errno : EIO;
+            ::unlinkat(ddir, d, 0);
+            return false;
+        }
+        left -= n;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+// -------------------- ShardedDir --------------------
+
+FilePlacer::ShardedDir::ShardedDir(QString base)
+    : base_(QDir::cleanPath(std::move(base)))
+{
+    QDir().mkpath(base_);
+#ifdef Q_OS_LINUX
+    fd_ = ::open(QFile::encodeName(base_).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd_ < 0) return;
+    struct stat st{};
+    if (::fstat(fd_, &st) == 0) dev_ = quint64(st.st_dev);
+    // 256 шардов разом: дальше ни одного mkpath на объект
+    char name[3] = {0, 0, 0};
+    static const char hex[] = "0123456789abcdef";
+    for (int i = 0; i < 256; ++i) {
+        name[0] = hex[i >> 4];
+        name[1] = hex[i & 15];
+        ::mkdirat(fd_, name, 0777); // права режет umask (общий кэш — с g+w); EEXIST — нормально
+    }
+#else
+    for (int i = 0; i < 256; ++i)
+        QDir().mkpath(base_ + "/" + QString("%1").arg(i, 2, 16, QChar('0')));
+#endif
+}
+
+FilePlacer::ShardedDir::~ShardedDir()
+{
+#ifdef Q_OS_LINUX
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+// -------------------- FilePlacer --------------------
+
+const char* FilePlacer::name(Strategy s)
+{
+    switch (s) {
+    case Strategy::Hardlink:  return "hardlink";
+    case Strategy::Reflink:   return "reflink";
+    case Strategy::CopyRange: return "copy_range";
+    case Strategy::Buffered:  return "buffered";
+    default:                  return "?";
+    }
+}
+
+FilePlacer::Strategy FilePlacer::startFor(const ShardedDir& src, const ShardedDir& dst)
+{
+#ifdef Q_OS_LINUX
+    return Strategy(cachedStart(FsKey(src.dev(), dst.dev())));
+#else
+    Q_UNUSED(src); Q_UNUSED(dst);
+    return Strategy(cachedStart(FsKey(0, 0)));
+#endif
+}
+
+void FilePlacer::resetCounters()
+{
+    for (auto& c : counters_) c.store(0);
+}
+
+QString FilePlacer::summary() const
+{
+    QStringList parts;
+    for (int i = 0; i < int(Strategy::Count); ++i)
+        parts << QString("%1=%2").arg(name(Strategy(i))).arg(counters_[i].load());
+    return parts.join(' ');
+}
+
+bool FilePlacer::place(const QString& src, const QString& dst)
+{
+    // гарантируем директорию
+    const QString dstDir = QFileInfo(dst).dir().absolutePath();
+    QDir().mkpath(dstDir);
+
+#ifdef Q_OS_LINUX
+    struct stat sst{}, dst_st{};
+    if (::stat(QFile::encodeName(src).constData(), &sst) != 0) return false;
+    const bool haveDstDir = (::stat(QFile::encodeName(dstDir).constData(), &dst_st) == 0);
+    const FsKey key(quint64(sst.st_dev), haveDstDir ? quint64(dst_st.st_dev) : quint64(-1));
+
+    return placeAt(AT_FDCWD, QFile::encodeName(src), src,
+                   AT_FDCWD, QFile::encodeName(dst), dst, key, /*dstMayExist*/ true);
+#else
+    const FsKey key(0, 0);
+    if (QFileInfo::exists(dst)) QFile::remove(dst);
+
+    if (cachedStart(key) == int(Strategy::Hardlink)) {
+        std::error_code ec;
+        std::filesystem::create_hard_link(src.toStdWString(), dst.toStdWString(), ec);
+        if (!ec) { counters_[int(Strategy::Hardlink)].fetch_add(1); return true; }
+        if (ec == std::errc::cross_device_link || ec == std::errc::operation_not_supported)
+            rememberStart(key, int(Strategy::Buffered));
+    }
+    if (QFile::copy(src, dst)) { counters_[int(Strategy::Buffered)].fetch_add(1); return true; }
+    return false;
+#endif
+}
+
+bool FilePlacer::placeObject(const ShardedDir& src, const ShardedDir& dst, const QString& sha, bool dstMayExist)
+{
+#ifdef Q_OS_LINUX
+    if (src.fd() < 0 || dst.fd() < 0)
+        return place(src.pathFor(sha), dst.pathFor(sha));
+    const QByteArray rel = ShardedDir::relFor(sha);
+    return placeAt(src.fd(), rel, src.pathFor(sha),
+                   dst.fd(), rel, dst.pathFor(sha),
+                   FsKey(src.dev(), dst.dev()), dstMayExist);
+#else
+    Q_UNUSED(dstMayExist);
+    return place(src.pathFor(sha), dst.pathFor(sha));
+#endif
+}
+
+bool FilePlacer::placeAt(int sdir, const QByteArray& sname, const QString& srcPath,
+                         int ddir, const QByteArray& dname, const QString& dstPath,
+                         const FsKey& key, bool dstMayExist)
+{
+#ifdef Q_OS_LINUX
+    // dst может существовать — создаём рядом под временным именем и подменяем одним renameat;
+    // иначе пишем прямо в dst (один linkat на объект)
+    const QByteArray target = dstMayExist ? tmpNameFor(dname) : dname;
+    const QString targetPath = dstMayExist ? dstPath + QString::fromLatin1(target.mid(dname.size())) : dstPath;
+    bool staleTmpRemoved = false;
+
+    const int start = cachedStart(key);
+    for (int i = start; i < int(Strategy::Count); ++i) {
+        int err = 0;
+        bool ok = false;
+        switch (Strategy(i)) {
+        case Strategy::Hardlink:
+            ok = (::linkat(sdir, sname.constData(), ddir, target.constData(), 0) == 0);
+            if (!ok) err = errno;
+            break;
+        case Strategy::Reflink:
+            ok = tryReflink(sdir, sname.constData(), ddir, target.constData(), &err);
+            break;
+        case Strategy::CopyRange:
+            ok = tryCopyRange(sdir, sname.constData(), ddir, target.constData(), &err);
+            break;
+        case Strategy::Buffered:
+            ok = QFile::copy(srcPath, targetPath);
+            if (!ok) err = QFileInfo::exists(targetPath) ? EEXIST : EIO;
+            break;
+        default:
+            break;
+        }
+        if (ok) {
+            if (dstMayExist && ::renameat(ddir, target.constData(), ddir, dname.constData()) != 0) {
+                ::unlinkat(ddir, target.constData(), 0);
+                return false;
+            }
+            counters_[i].fetch_add(1);
+            return true;
+        }
+        // планировщик считал, что dst нет, а он есть (старый файл/гонка) — повторяем с подменой
+        if (err == EEXIST && !dstMayExist)
+            return placeAt(sdir, sname, srcPath, ddir, dname, dstPath, key, true);
+        // временное имя занято хвостом прерванной попытки: оно с нашим pid, чужой живой процесс
+        // им не владеет — удаляем и пробуем ту же стратегию ещё раз
+        if (err == EEXIST && !staleTmpRemoved) {
+            staleTmpRemoved = true;
+            ::unlinkat(ddir, target.constData(), 0);
+            --i;
+            continue;
+        }
+        // стратегия в принципе не работает для этой пары ФС — больше с неё не начинаем
+        if (i == start && isStructuralError(err))
+            rememberStart(key, i + 1);
+    }
+    return false;
+#else
+    Q_UNUSED(sdir); Q_UNUSED(sname); Q_UNUSED(ddir); Q_UNUSED(dname);
+    Q_UNUSED(key); Q_UNUSED(dstMayExist);
+    return place(srcPath, dstPath);
+#endif
+}
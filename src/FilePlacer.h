@@ -0,0 +1,60 @@
+#pragma once
+#include <QtCore>
+#include <atomic>
+
+// Раскладка файлов из общего кэша в инстанс.
+// Цепочка стратегий: хардлинк -> reflink (FICLONE, btrfs/XFS) -> copy_file_range/sendfile -> обычное копирование.
+// Первая сработавшая стратегия запоминается для пары файловых систем (src, dst) на весь процесс,
+// чтобы на следующих файлах не перебирать заведомо неработающие варианты.
+class FilePlacer {
+public:
+    enum class Strategy : int { Hardlink = 0, Reflink, CopyRange, Buffered, Count };
+
+    // Каталог объектов вида <base>/xx/<sha>: 256 шардов создаются один раз при открытии,
+    // дальше операции идут относительно открытого дескриптора base (без mkpath/stat на каждый объект).
+    class ShardedDir {
+    public:
+        explicit ShardedDir(QString base);
+        ~ShardedDir();
+        ShardedDir(const ShardedDir&) = delete;
+        ShardedDir& operator=(const ShardedDir&) = delete;
+
+        const QString& base() const { return base_; }
+        QString pathFor(const QString& sha) const { return base_ + "/" + sha.left(2) + "/" + sha; }
+        static QByteArray relFor(const QString& sha) { return (sha.left(2) + "/" + sha).toLatin1(); }
+
+        int     fd()  const { return fd_; }
+        quint64 dev() const { return dev_; }
+
+    private:
+        QString base_;
+        int     fd_  = -1;
+        quint64 dev_ = 0;
+    };
+
+    // Кладёт src в dst (существующий dst атомарно заменяется). false — ни одна стратегия не сработала.
+    bool place(const QString& src, const QString& dst);
+
+    // То же для content-addressed объекта между двумя шардированными каталогами.
+    // dstMayExist=false — вызывающий уже знает, что в dst объекта нет (проверка при планировании),
+    // тогда это ровно один linkat без удаления/проверок существования.
+    bool placeObject(const ShardedDir& src, const ShardedDir& dst, const QString& sha, bool dstMayExist);
+
+    // С какой стратегии начнётся раскладка между этими каталогами (кэш стратегий по паре ФС)
+    static Strategy startFor(const ShardedDir& src, const ShardedDir& dst);
+
+    // Счётчики по стратегиям (сколько объектов разложено каждой) — для логов установки
+    quint64 count(Strategy s) const { return counters_[int(s)].load(); }
+    void    addCount(Strategy s, quint64 n) { counters_[int(s)].fetch_add(n); }
+    void    resetCounters();
+    QString summary() const;
+
+    static const char* name(Strategy s);
+
+private:
+    bool placeAt(int sdir, const QByteArray& sname, const QString& srcPath,
+                 int ddir, const QByteArray& dname, const QString& dstPath,
+                 const QPair<quint64, quint64>& fsKey, bool dstMayExist);
+
+    std::atomic<quint64> counters_[int(Strategy::Count)] {};
+};
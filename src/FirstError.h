@@ -0,0 +1,42 @@
+#pragma once
+#include <QtCore>
+#include <atomic>
+#include <stdexcept>
+
+// Первая ошибка параллельного прохода (QtConcurrent::blockingMap).
+// Исключения из задач QtConcurrent не выпускаем: на некоторых сборках Qt они превращаются
+// в голое std::exception без текста, а иногда роняют процесс. Задача оборачивает тело в guard(),
+// остальные по failed() пропускают работу, после прохода throwIfFailed() бросает текст первой ошибки.
+class FirstError {
+public:
+    bool failed() const { return failed_.load(); }
+
+    void record(const QString& msg) {
+        failed_.store(true);
+        QMutexLocker lk(&mx_);
+        if (msg_.isEmpty()) msg_ = msg;
+    }
+
+    template <class F>
+    void guard(F&& f) {
+        try {
+            f();
+        } catch (const std::exception& e) {
+            record(QString::fromUtf8(e.what()));
+        } catch (...) {
+            record(QStringLiteral("Unknown non-std exception"));
+        }
+    }
+
+    // std::runtime_error(prefix + текст первой ошибки), если ошибка была
+    void throwIfFailed(const QString& prefix = QString()) const {
+        if (!failed()) return;
+        QMutexLocker lk(&mx_);
+        throw std::runtime_error((prefix + msg_).toStdString());
+    }
+
+private:
+    std::atomic_bool failed_{false};
+    mutable QMutex   mx_;
+    QString          msg_;
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <QtCore>
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Фоновые задачи над кэшем (сборка мусора, scrub): idle-приоритет диска для текущего потока
+// на время жизни объекта
+#ifdef Q_OS_LINUX
+// ioprio_set(2): класса IDLE — диск получаем только когда он никому больше не нужен
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassShift = 13;
+constexpr int kIoprioClassIdle  = 3;
+
+struct IdleIoPriority {
+    int saved = -1;
+    IdleIoPriority()
+    {
+        saved = int(::syscall(SYS_ioprio_get, kIoprioWhoProcess, 0));
+        ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+    }
+    ~IdleIoPriority()
+    {
+        // поток из пула вернётся к обычным задачам — возвращаем прежний приоритет
+        if (saved >= 0) ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, saved);
+    }
+};
+#else
+struct IdleIoPriority {};
+#endif
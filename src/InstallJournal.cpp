@@ -0,0 +1,109 @@
+#include "InstallJournal.h"
+#include "Util.h"
+
+namespace {
+const QByteArray kMagic = "tesuto-install-journal 1";
+constexpr int kFlushEvery = 256; // записей в буфере до сброса на диск
+}
+
+QString InstallJournal::pathFor(const QString& instanceDir)
+{
+    return joinPath(instanceDir, ".tesuto_install.journal");
+}
+
+bool InstallJournal::pending(const QString& instanceDir)
+{
+    return QFileInfo::exists(pathFor(instanceDir));
+}
+
+InstallJournal::InstallJournal(const QString& instanceDir, const QString& versionId)
+    : file_(pathFor(instanceDir))
+{
+    const QByteArray header = kMagic + " " + versionId.toUtf8();
+
+    // продолжаем только журнал той же версии; оборванную последнюю строку просто не учитываем
+    if (file_.open(QIODevice::ReadOnly)) {
+        const QByteArray all = file_.readAll();
+        file_.close();
+        const QList<QByteArray> lines = all.split('\n');
+        if (!lines.isEmpty() && lines.first() == header) {
+            const int complete = all.endsWith('\n') ? lines.size() : lines.size() - 1;
+            for (int i = 1; i < complete; ++i)
+                if (!lines[i].isEmpty()) done_.insert(lines[i]);
+            resumed_ = true;
+        }
+    }
+
+    if (resumed_) {
+        if (!file_.open(QIODevice::WriteOnly | QIODevice::Append))
+            throw std::runtime_error(("Cannot open install journal " + file_.fileName()).toStdString());
+        // недописанный хвост (если был) отделяем переводом строки
+        file_.write("\n");
+    } else {
+        if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            throw std::runtime_error(("Cannot create install journal " + file_.fileName()).toStdString());
+        file_.write(header + "\n");
+    }
+    file_.flush();
+}
+
+InstallJournal::~InstallJournal()
+{
+    QMutexLocker lk(&mx_);
+    if (file_.isOpen()) flushLocked();
+}
+
+bool InstallJournal::stageDone(const QString& stage) const
+{
+    QMutexLocker lk(&mx_);
+    return done_.contains("stage " + stage.toUtf8());
+}
+
+void InstallJournal::markStage(const QString& stage)
+{
+    QMutexLocker lk(&mx_);
+    const QByteArray line = "stage " + stage.toUtf8();
+    done_.insert(line);
+    buf_ += line + "\n";
+    flushLocked();
+}
+
+bool InstallJournal::has(char kind, const QString& key) const
+{
+    QMutexLocker lk(&mx_);
+    return done_.contains(QByteArray(1, kind) + " " + key.toUtf8());
+}
+
+void InstallJournal::record(char kind, const QString& key)
+{
+    const QByteArray line = QByteArray(1, kind) + " " + key.toUtf8();
+    QMutexLocker lk(&mx_);
+    done_.insert(line);
+    buf_ += line + "\n";
+    if (++buffered_ >= kFlushEvery) flushLocked();
+}
+
+void InstallJournal::flush()
+{
+    QMutexLocker lk(&mx_);
+    flushLocked();
+}
+
+void InstallJournal::flushLocked()
+{
+    if (!buf_.isEmpty() && file_.isOpen()) {
+        file_.write(buf_);
+        file_.flush();
+    }
+    buf_.clear();
+    buffered_ = 0;
+}
+
+void InstallJournal::commit()
+{
+    QMutexLocker lk(&mx_);
+    buf_.clear();
+    buffered_ = 0;
+    file_.close();
+    file_.remove();
+}
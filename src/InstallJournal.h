@@ -0,0 +1,42 @@
+#pragma once
+#include <QtCore>
+
+// Журнал установки версии в инстанс: <instance>/.tesuto_install.journal.
+// Пока установка идёт, в него дописываются завершённые этапы и разложенные объекты
+// (ассеты по sha1, библиотеки по пути). Прерванная установка той же версии продолжается
+// с журнала: сделанное не перепроверяется заново. commit() удаляет журнал — установка завершена.
+class InstallJournal {
+public:
+    InstallJournal(const QString& instanceDir, const QString& versionId);
+    ~InstallJournal();
+    InstallJournal(const InstallJournal&) = delete;
+    InstallJournal& operator=(const InstallJournal&) = delete;
+
+    // Журнал той же версии найден и прочитан — продолжаем прерванную установку
+    bool resumed() const { return resumed_; }
+
+    bool stageDone(const QString& stage) const;
+    void markStage(const QString& stage);          // сразу на диск
+
+    // Единица работы внутри этапа ('a' — ассет, 'l' — библиотека). Потокобезопасно, с буфером.
+    bool has(char kind, const QString& key) const;
+    void record(char kind, const QString& key);
+    void flush();
+
+    // Установка завершена: журнал больше не нужен
+    void commit();
+
+    // В инстансе есть незавершённая установка
+    static bool pending(const QString& instanceDir);
+    static QString pathFor(const QString& instanceDir);
+
+private:
+    void flushLocked();
+
+    QFile            file_;
+    mutable QMutex   mx_;
+    QSet<QByteArray> done_;     // "a <sha>", "l <path>", "stage <name>"
+    QByteArray       buf_;
+    int              buffered_ = 0;
+    bool             resumed_  = false;
+};
@@ -0,0 +1,119 @@
+#include "InstallManifest.h"
+#include "Util.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <algorithm>
+
+QString InstallManifest::pathFor(const QString& instanceDir, Part part)
+{
+    return joinPath(instanceDir, part == Part::Loader ? ".tesuto_loader_manifest.json" : ".tesuto_manifest.json");
+}
+
+InstallManifest InstallManifest::load(const QString& instanceDir, Part part)
+{
+    InstallManifest m;
+    QFile f(pathFor(instanceDir, part));
+    if (!f.open(QIODevice::ReadOnly)) return m;
+    const QJsonObject o = QJsonDocument::fromJson(f.readAll()).object();
+    m.versionId = o.value("versionId").toString();
+    for (const auto& v : o.value("files").toArray()) {
+        const QJsonObject e = v.toObject();
+        File fe;
+        fe.path  = e.value("p").toString();
+        fe.size  = qint64(e.value("s").toDouble());
+        fe.mtime = qint64(e.value("m").toDouble());
+        fe.sha1  = e.value("h").toString();
+        fe.url   = e.value("u").toString();
+        if (!fe.path.isEmpty()) m.files.insert(fe.path, fe);
+    }
+    // манифест, не сходящийся со своим дайджестом, считаем отсутствующим
+    if (o.value("root").toString() != m.rootDigest()) {
+        qWarning() << "install manifest digest mismatch, ignoring:" << f.fileName();
+        return InstallManifest();
+    }
+    return m;
+}
+
+void InstallManifest::save(const QString& instanceDir, Part part) const
+{
+    QStringList paths = files.keys();
+    paths.sort();
+    QJsonArray arr;
+    for (const QString& p : paths) {
+        const File& fe = files[p];
+        QJsonObject e{{"p", fe.path}, {"s", double(fe.size)}, {"m", double(fe.mtime)}, {"h", fe.sha1}};
+        if (!fe.url.isEmpty()) e.insert("u", fe.url);
+        arr.append(e);
+    }
+    const QJsonObject o{
+        {"versionId", versionId},
+        {"root", rootDigest()},
+        {"files", arr},
+    };
+    QSaveFile f(pathFor(instanceDir, part));
+    if (!f.open(QIODevice::WriteOnly)
+        || f.write(QJsonDocument(o).toJson(QJsonDocument::Compact)) < 0 || !f.commit())
+        throw std::runtime_error(("Cannot write install manifest " + pathFor(instanceDir, part)).toStdString());
+}
+
+QString InstallManifest::rootDigest() const
+{
+    QStringList paths = files.keys();
+    paths.sort();
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    for (const QString& p : paths) {
+        const File& fe = files[p];
+        h.addData(fe.path.toUtf8());
+        h.addData(QByteArray(1, '\0'));
+        h.addData(QByteArray::number(fe.size));
+        h.addData(QByteArray(1, '\0'));
+        h.addData(fe.sha1.toLatin1());
+        h.addData(QByteArray(1, '\n'));
+    }
+    return QString::fromLatin1(h.result().toHex());
+}
+
+bool InstallManifest::add(const QString& instanceDir, const QString& relPath, const QString& sha1)
+{
+    const QFileInfo fi(joinPath(instanceDir, relPath));
+    if (!fi.isFile()) return false;
+    const QString url = files.value(relPath).url;
+    files.insert(relPath, File{relPath, fi.size(), fi.lastModified().toMSecsSinceEpoch(), sha1, url});
+    return true;
+}
+
+QHash<QString, QString> InstallManifest::validOnDisk(const QString& instanceDir) const
+{
+    QHash<QString, QString> ok;
+    ok.reserve(files.size());
+    for (const File& fe : files) {
+        const QFileInfo fi(joinPath(instanceDir, fe.path));
+        if (fi.isFile() && fi.size() == fe.size && fi.lastModified().toMSecsSinceEpoch() == fe.mtime)
+            ok.insert(fe.path, fe.sha1);
+    }
+    return ok;
+}
+
+QStringList InstallManifest::changedOnDisk(const QString& instanceDir) const
+{
+    QStringList out;
+    const auto ok = validOnDisk(instanceDir);
+    for (const File& fe : files)
+        if (!ok.contains(fe.path)) out << fe.path;
+    return out;
+}
+
+InstallManifest::Diff InstallManifest::diff(const InstallManifest& have, const InstallManifest& want)
+{
+    Diff d;
+    for (const File& w : want.files) {
+        const auto it = have.files.constFind(w.path);
+        if (it == have.files.constEnd() || it->sha1 != w.sha1) d.fetch << w.path;
+    }
+    for (const File& h : have.files)
+        if (!want.files.contains(h.path)) d.remove << h.path;
+    d.fetch.sort();
+    d.remove.sort();
+    return d;
+}
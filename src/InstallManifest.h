@@ -0,0 +1,47 @@
+#pragma once
+#include <QtCore>
+
+// Манифест установленных файлов инстанса: <instance>/.tesuto_manifest.json (ванильная версия)
+// и <instance>/.tesuto_loader_manifest.json (библиотеки модлоадера — их ставит ModloaderInstaller).
+// Для каждого файла — относительный путь, размер, mtime и sha1; плюс корневой дайджест по всему набору.
+// Неизменённый инстанс проверяется одним stat на файл (размер+mtime), без чтения содержимого;
+// смена версии даёт точный diff: что докачать и что удалить.
+class InstallManifest {
+public:
+    struct File {
+        QString path;      // относительно каталога инстанса, '/' как разделитель
+        qint64  size  = 0;
+        qint64  mtime = 0; // мс с эпохи
+        QString sha1;
+        QString url;       // откуда качать заново (библиотеки лоадера); в дайджест не входит
+    };
+
+    enum class Part { Game, Loader };
+
+    struct Diff {
+        QStringList fetch;  // нужны в want, а в have нет или с другим хэшем
+        QStringList remove; // были в have, в want их нет
+    };
+
+    QString              versionId;
+    QHash<QString, File> files;
+
+    bool isEmpty() const { return files.isEmpty(); }
+
+    static QString pathFor(const QString& instanceDir, Part part = Part::Game);
+    static InstallManifest load(const QString& instanceDir, Part part = Part::Game);
+    void save(const QString& instanceDir, Part part = Part::Game) const;
+
+    // sha1 по отсортированным (path, size, sha1) — mtime в дайджест не входит
+    QString rootDigest() const;
+
+    // Добавить файл, сняв размер/mtime с диска (url прежней записи сохраняется). false — файла нет
+    bool add(const QString& instanceDir, const QString& relPath, const QString& sha1);
+
+    // Быстрая проверка: записи, у которых на диске совпали размер и mtime (path -> sha1)
+    QHash<QString, QString> validOnDisk(const QString& instanceDir) const;
+    // Пути, которые на диске отсутствуют или изменились
+    QStringList changedOnDisk(const QString& instanceDir) const;
+
+    static Diff diff(const InstallManifest& have, const InstallManifest& want);
+};
@@ -0,0 +1,45 @@
+#include "InstallObserver.h"
+
+ProgressMeter::ProgressMeter(InstallObserver* obs, QString phase, int total, qint64 bytesTotal)
+    : obs_(obs)
+{
+    p_.phase      = std::move(phase);
+    p_.total      = total;
+    p_.bytesTotal = bytesTotal;
+    clock_.start();
+    QMutexLocker lk(&mx_);
+    reportLocked(true);
+}
+
+ProgressMeter::~ProgressMeter()
+{
+    QMutexLocker lk(&mx_);
+    reportLocked(true);
+}
+
+void ProgressMeter::add(int objects, qint64 bytes)
+{
+    QMutexLocker lk(&mx_);
+    p_.done      += objects;
+    p_.bytesDone += bytes;
+    reportLocked(p_.done >= p_.total);
+}
+
+void ProgressMeter::reportLocked(bool force)
+{
+    if (!obs_) return;
+    const qint64 ms = clock_.elapsed();
+    if (!force && lastMs_ >= 0 && ms - lastMs_ < 100) return;
+    lastMs_ = ms;
+
+    if (ms >= 500 && p_.bytesDone > 0) {
+        p_.bytesPerSec = p_.bytesDone * 1000 / ms;
+        if (p_.bytesTotal > p_.bytesDone)
+            p_.etaSeconds = (p_.bytesTotal - p_.bytesDone) / qMax<qint64>(1, p_.bytesPerSec);
+        else if (p_.total > p_.done && p_.done > 0)
+            p_.etaSeconds = qint64(p_.total - p_.done) * ms / p_.done / 1000; // по объектам
+        else
+            p_.etaSeconds = 0;
+    }
+    obs_->onProgress(p_);
+}
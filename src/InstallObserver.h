@@ -0,0 +1,42 @@
+#pragma once
+#include <QtCore>
+
+// Ход установки для UI: этап, объекты и байты (сделано/всего), скорость и оценка оставшегося времени
+struct InstallProgress {
+    QString phase;              // "assets", "libraries", "client", "loader"
+    int     done        = 0;
+    int     total       = 0;
+    qint64  bytesDone   = 0;
+    qint64  bytesTotal  = 0;    // 0 — размеры неизвестны (например, библиотеки лоадера)
+    qint64  bytesPerSec = 0;
+    qint64  etaSeconds  = -1;   // -1 — пока неизвестно
+};
+
+// Наблюдатель установки (Installer, ModloaderInstaller). Вызывается из рабочих потоков —
+// реализация сама переносит данные в GUI-поток
+class InstallObserver {
+public:
+    virtual ~InstallObserver() = default;
+    virtual void onProgress(const InstallProgress& p) = 0;
+};
+
+// Счётчик одного этапа: потокобезопасно копит сделанное и отдаёт наблюдателю не чаще раза в 100 мс
+// (первый и последний отчёт — всегда). Скорость — по байтам с начала этапа
+class ProgressMeter {
+public:
+    ProgressMeter(InstallObserver* obs, QString phase, int total, qint64 bytesTotal);
+    ~ProgressMeter();
+    ProgressMeter(const ProgressMeter&) = delete;
+    ProgressMeter& operator=(const ProgressMeter&) = delete;
+
+    void add(int objects, qint64 bytes);
+
+private:
+    void reportLocked(bool force);
+
+    InstallObserver* obs_;
+    QMutex           mx_;
+    InstallProgress  p_;
+    QElapsedTimer    clock_;
+    qint64           lastMs_ = -1;
+};
@@ -3,41 +3,334 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QJsonDocument>
-#include <QStandardPaths>
-#include <QProcess>
 #include <QtConcurrent>
 #include <QThreadPool>
-#include <cstdlib>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QSettings>
+#include "IoBatch.h"
+#include "ZipReader.h"
+#include "CachePaths.h"
+#include "RuntimeStore.h"
+#include "InstallJournal.h"
+#include "SingleFlight.h"
+#include "CacheLock.h"
+#include "BsPatch.h"
+#include "FirstError.h"
+#ifdef Q_OS_LINUX
+#include <atomic>
+#include <sys/resource.h>
+#endif
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#else
+#include <QStorageInfo>
+#endif
 
 // -------------------- helpers --------------------
 
 QString Installer::defaultCacheDir()
 {
-    // 1) env override
-    if (const char* env = std::getenv("TESUTO_CACHE_DIR")) {
-        const QString s = QString::fromUtf8(env);
-        if (!s.isEmpty()) return s;
-    }
-    // 2) XDG
-    QString loc = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
-    if (loc.isEmpty()) loc = QDir::homePath() + "/.cache/tesuto-launcher";
-    return loc;
+    return CachePaths::root();
 }
 
 bool Installer::linkOrCopy(const QString& src, const QString& dst)
 {
-    // гарантируем директорию
-    QDir().mkpath(QFileInfo(dst).dir().absolutePath());
-    // если уже есть — удалим
-    if (QFileInfo::exists(dst)) QFile::remove(dst);
-    // пробуем сделать хардлинк (или симлинк, если платформа так делает)
-    if (QFile::link(src, dst)) return true;
-    // не вышло — просто копируем
-    return QFile::copy(src, dst);
+    // хардлинк -> reflink -> copy_file_range/sendfile -> копия (см. FilePlacer)
+    return placer_.place(src, dst);
+}
+
+// Системное время процесса (для оценки, сколько установка тратит на syscalls); -1 — недоступно
+static qint64 processSystemTimeMs()
+{
+#ifdef Q_OS_LINUX
+    struct rusage ru{};
+    if (::getrusage(RUSAGE_SELF, &ru) == 0)
+        return qint64(ru.ru_stime.tv_sec) * 1000 + ru.ru_stime.tv_usec / 1000;
+#endif
+    return -1;
+}
+
+namespace {
+
+// Время дисковой фазы (раскладка в инстанс, запись в кэш), суммируется по всем потокам.
+// Планирование с sha1 и сеть в него не входят — по нему сравниваются бэкенды ввода-вывода
+struct IoPhaseTimer {
+    std::atomic<qint64>& ns;
+    QElapsedTimer        t;
+    explicit IoPhaseTimer(std::atomic<qint64>& acc) : ns(acc) { t.start(); }
+    ~IoPhaseTimer() { ns.fetch_add(t.nsecsElapsed()); }
+};
+
+} // namespace
+
+// Запись целиком через временный файл + rename: по пути path либо старое содержимое, либо новое
+static void writeFileOrThrow(const QString& path, const QByteArray& data)
+{
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        throw std::runtime_error(("write failed: " + path).toStdString());
+    if (f.write(data) != data.size())
+        throw std::runtime_error(("write short: " + path).toStdString());
+    if (!f.commit())
+        throw std::runtime_error(("write commit failed: " + path).toStdString());
+}
+
+// Объект assets по sha1: LAN-зеркало (если есть), затем интернет; байты проверены по sha1.
+// Битую копию могло отдать LAN-зеркало — тогда ещё раз только из интернета
+static QByteArray fetchAssetObject(Downloader& dl, const QList<QUrl>& lan, const QString& sha)
+{
+    static const QList<QUrl> internet = {
+        QUrl("https://resources.fastmcmirror.org"),
+        QUrl("https://resources.download.minecraft.net")
+    };
+    const QString rel = sha.left(2) + "/" + sha;
+    QByteArray data = dl.getWithMirrors(lan + internet, rel);
+    auto sha1Ok = [&] { return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() == sha.toLatin1(); };
+    if (!sha1Ok() && !lan.isEmpty())
+        data = dl.getWithMirrors(internet, rel);
+    if (!sha1Ok())
+        throw std::runtime_error(("Checksum mismatch for asset " + rel).toStdString());
+    return data;
+}
+
+// Библиотека: LAN-зеркало, прямой URL, зеркала maven; байты проверены по sha1 (если он известен)
+static QByteArray fetchLibrary(Downloader& dl, const LibEntry& lib)
+{
+    QByteArray data;
+
+    // LAN-зеркало никак не аутентифицировано: без sha1 его ответ нечем проверить — только интернет
+    const QList<QUrl> lan = lib.sha1.isEmpty() ? QList<QUrl>() : Downloader::lanMirror("libraries");
+    bool got = false;
+    if (!lan.isEmpty()) {
+        try {
+            data = dl.getWithMirrors(lan, lib.path);
+            // битая копия у соседа — не повод падать, берём из интернета
+            got = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() == lib.sha1.toLatin1();
+        } catch (...) {}
+    }
+    if (!got) try { data = dl.getWithMirrors({ lib.url }, ""); }
+    catch (...) {
+        const QString rel = lib.path; // стандартный maven layout
+        data = dl.getWithMirrors(
+            { QUrl("https://libraries.fastmcmirror.org"),
+              QUrl("https://libraries.minecraft.net") },
+            rel);
+    }
+
+    // проверяем буфер до записи: в кэш попадает только целый и верный файл
+    if (!lib.sha1.isEmpty()
+        && QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() != lib.sha1.toLatin1())
+        throw std::runtime_error(("Checksum mismatch for lib " + lib.path).toStdString());
+    return data;
+}
+
+// Источник дельт client.jar (delta/source или $TESUTO_DELTA_SOURCE) — обычный статический HTTP-каталог:
+//   <source>/client/<sha1 нового jar>/index.json        {"patches":[{"from":"<sha1 старого>","size":N}]}
+//   <source>/client/<sha1 нового jar>/<sha1 старого>.bsdiff
+static QString deltaSource()
+{
+    QString s = qEnvironmentVariable("TESUTO_DELTA_SOURCE").trimmed();
+    if (s.isEmpty()) s = QSettings().value("delta/source").toString().trimmed();
+    while (s.endsWith('/')) s.chop(1);
+    return s;
+}
+
+// client.jar патчем от jar другой версии, уже лежащего в кэше. Пусто — дельты нет или она не сошлась
+// по sha1; тогда качаем целиком. Ошибки источника дельт установку не роняют
+static QByteArray fetchClientJarDelta(Downloader& dl, const QString& cacheVersionsDir, const QString& expectedSha)
+{
+    const QString src = deltaSource();
+    if (src.isEmpty() || expectedSha.size() != 40 || !BsPatch::supported()) return {};
+
+    // какие jar у нас есть: sha1 — из version.json рядом, без хэширования десятков МБ
+    QHash<QString, QString> have; // sha1 -> путь
+    const QDir vd(cacheVersionsDir);
+    for (const QString& id : vd.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const QString jar = vd.filePath(id + "/" + id + ".jar");
+        QFile jf(vd.filePath(id + "/" + id + ".json"));
+        if (!QFileInfo::exists(jar) || !jf.open(QIODevice::ReadOnly)) continue;
+        const QString sha = QJsonDocument::fromJson(jf.readAll()).object()
+            .value("downloads").toObject().value("client").toObject().value("sha1").toString();
+        if (sha.size() == 40 && sha != expectedSha) have.insert(sha, jar);
+    }
+    if (have.isEmpty()) return {};
+
+    const QString base = src + "/client/" + expectedSha;
+    try {
+        // дельта необязательна: индекс — один запрос с коротким таймаутом, без повторов,
+        // иначе недоступный источник задержал бы полную загрузку на десятки секунд
+        const QJsonArray patches = QJsonDocument::fromJson(
+            dl.net().getBytes(QUrl(base + "/index.json"), 3000)).object().value("patches").toArray();
+        // самый маленький патч от того, что есть
+        QString from;
+        qint64 best = -1;
+        for (const auto& pv : patches) {
+            const QJsonObject po = pv.toObject();
+            const QString f = po.value("from").toString();
+            const qint64 size = qint64(po.value("size").toDouble());
+            if (have.contains(f) && (best < 0 || size < best)) { from = f; best = size; }
+        }
+        if (from.isEmpty()) return {};
+
+        QFile old(have.value(from));
+        if (!old.open(QIODevice::ReadOnly)) return {};
+        const QByteArray oldData = old.readAll();
+        if (QCryptographicHash::hash(oldData, QCryptographicHash::Sha1).toHex() != from.toLatin1()) {
+            qWarning() << "client.jar delta: cached" << old.fileName() << "is corrupt, full download";
+            return {};
+        }
+
+        const QByteArray patch = dl.getWithMirrors({ QUrl(base + "/" + from + ".bsdiff") }, QString());
+        QByteArray data = BsPatch::apply(oldData, patch);
+        if (QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() != expectedSha.toLatin1()) {
+            qWarning() << "client.jar delta: result sha1 mismatch, full download";
+            return {};
+        }
+        qInfo().noquote() << QString("client.jar: applied delta from %1 (%2 bytes instead of %3)")
+                                 .arg(QFileInfo(old.fileName()).fileName()).arg(patch.size()).arg(data.size());
+        return data;
+    } catch (const std::exception& e) {
+        qInfo() << "client.jar delta unavailable:" << e.what();
+        return {};
+    }
+}
+
+// client.jar версии: дельта от jar из кэша (если есть источник дельт), иначе URL из version.json,
+// piston-data по sha1, BMCL; проверен по sha1 (если он дан)
+static QByteArray fetchClientJar(Downloader& dl, const VersionResolved& v, const QString& cacheVersionsDir)
+{
+    const QString expectedSha =
+        v.raw.value("downloads").toObject().value("client").toObject().value("sha1").toString();
+    QByteArray data = fetchClientJarDelta(dl, cacheVersionsDir, expectedSha);
+    if (!data.isEmpty()) return data;
+    bool ok = false;
+
+    try { data = dl.getWithMirrors({ v.clientJarUrl }, QString()); ok = true; }
+    catch (...) {}
+
+    if (!ok && expectedSha.size() == 40) {
+        const QString rel = "v1/objects/" + expectedSha + "/client.jar";
+        try { data = dl.getWithMirrors({ QUrl("https://piston-data.mojang.com") }, rel); ok = true; }
+        catch (...) {}
+    }
+    if (!ok) {
+        const QUrl bmcl(QString("https://bmclapi2.bangbang93.com/version/%1/client").arg(v.id));
+        try { data = dl.getWithMirrors({ bmcl }, QString()); ok = true; }
+        catch (...) {}
+    }
+    if (!ok) throw std::runtime_error("Cannot download client.jar from all mirrors");
+
+    if (!expectedSha.isEmpty()
+        && QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() != expectedSha.toLatin1())
+        throw std::runtime_error("Checksum mismatch for client.jar");
+    return data;
+}
+
+void Installer::placeObjects(const FilePlacer::ShardedDir& from, const FilePlacer::ShardedDir& to,
+                             const QVector<PlacedObject>& objs, bool useUring, InstallJournal* journal)
+{
+    QVector<PlacedObject> rest;
+    if (useUring && from.fd() >= 0 && to.fd() >= 0
+        && FilePlacer::startFor(from, to) == FilePlacer::Strategy::Hardlink) {
+        // одна пачка linkat (+renameat для заменяемых) вместо тысяч отдельных вызовов из потоков
+        IoBatch io;
+        for (const auto& o : objs) {
+            const QByteArray rel = FilePlacer::ShardedDir::relFor(o.sha);
+            io.addLink(from.fd(), rel, to.fd(), rel, o.instExists);
+        }
+        if (io.run()) {
+            quint64 linked = 0;
+            for (int i = 0; i < objs.size(); ++i) {
+                if (io.ok(i)) {
+                    ++linked;
+                    if (journal) journal->record('a', objs[i].sha);
+                } else {
+                    rest.push_back(objs[i]);
+                }
+            }
+            placer_.addCount(FilePlacer::Strategy::Hardlink, linked);
+        } else {
+            rest = objs;
+        }
+    } else {
+        rest = objs;
+    }
+
+    // остаток (или всё, если io_uring нет) — обычной цепочкой стратегий
+    for (const auto& o : rest) {
+        if (!placer_.placeObject(from, to, o.sha, o.instExists))
+            throw std::runtime_error(("Cannot place asset " + o.sha).toStdString());
+        if (journal) journal->record('a', o.sha);
+    }
+}
+
+// Распаковать .so из одного natives-jar в natDir. Пропускает META-INF и файлы, у которых
+// уже совпадают размер и CRC32 с записью в архиве. Возвращает число записанных файлов.
+static int extractNativeJar(const QString& jar, const QString& natDir)
+{
+    ZipReader zip(jar);
+    if (!zip.isOpen())
+        throw std::runtime_error(("natives: " + zip.errorString()).toStdString());
+
+    int written = 0;
+    const QDir root(natDir);
+    for (const auto& e : zip.entries()) {
+        if (e.isDir() || e.name.startsWith("META-INF/") || !e.name.endsWith(".so"))
+            continue;
+        // защита от "../" и абсолютных путей внутри архива
+        const QString rel = QDir::cleanPath(e.name);
+        if (rel == ".." || rel.startsWith("../") || QDir::isAbsolutePath(rel))
+            continue;
+        const QString out = root.filePath(rel);
+
+        // уже на месте?
+        QFile cur(out);
+        if (quint64(cur.size()) == e.size && e.size > 0 && cur.open(QIODevice::ReadOnly)) {
+            bool same = false;
+            if (const uchar* m = cur.map(0, cur.size())) {
+                same = ZipReader::crc32Of(reinterpret_cast<const char*>(m), cur.size()) == e.crc32;
+                cur.unmap(const_cast<uchar*>(m));
+            }
+            cur.close();
+            if (same) continue;
+        }
+
+        QByteArray data;
+        QString err;
+        if (!zip.read(e, &data, &err))
+            throw std::runtime_error(("natives: " + jar + ": " + err).toStdString());
+
+        QDir().mkpath(QFileInfo(out).absolutePath());
+        QSaveFile f(out);
+        if (!f.open(QIODevice::WriteOnly) || f.write(data) != data.size() || !f.commit())
+            throw std::runtime_error(("natives write failed: " + out).toStdString());
+        if (e.unixMode)
+            QFile::setPermissions(out, permissionsFromMode(e.unixMode));
+        ++written;
+    }
+    return written;
+}
+
+void Installer::extractNatives(const QStringList& jars, const QString& natDir) const
+{
+    ensureDir(natDir);
+
+    std::atomic_int written{0};
+    FirstError err;
+
+    QStringList work = jars;
+    QtConcurrent::blockingMap(work, [&](QString& jar) {
+        err.guard([&] { written += extractNativeJar(jar, natDir); });
+    });
+
+    err.throwIfFailed();
+    qInfo().noquote() << QString("natives: %1 jar(s), %2 file(s) written").arg(jars.size()).arg(written.load());
 }
 
 // Читает индекс ассетов: инстанс -> кэш -> сеть; при скачивании пишет и в кэш, и в инстанс
-QJsonObject Installer::fetchAssetIndexCached(const QUrl& url) const
+QJsonObject Installer::fetchAssetIndexCached(const QUrl& url, bool store) const
 {
     // Определим id индекс-файла из имени (…/1.21.1.json -> "1.21.1")
     const QString baseName = QFileInfo(url.path()).completeBaseName();
@@ -45,8 +338,10 @@ QJsonObject Installer::fetchAssetIndexCached(const QUrl& url) const
     const QString instIdxPath  = assetsIndexesPath(gameDir_) + "/" + baseName + ".json";
     const QString cacheIdxPath = cacheAssetsIndexes()      + "/" + baseName + ".json";
 
+    const bool toInstance = !gameDir_.isEmpty(); // prefetch — только кэш
+
     // 1) из инстанса
-    {
+    if (toInstance) {
         QFile f(instIdxPath);
         if (f.exists() && f.open(QIODevice::ReadOnly)) {
             const auto doc = QJsonDocument::fromJson(f.readAll());
@@ -59,11 +354,10 @@ QJsonObject Installer::fetchAssetIndexCached(const QUrl& url) const
         if (f.exists() && f.open(QIODevice::ReadOnly)) {
             const auto doc = QJsonDocument::fromJson(f.readAll());
             if (doc.isObject()) {
+                if (!toInstance || !store) return doc.object();
                 // заодно положим в инстанс
                 QDir().mkpath(QFileInfo(instIdxPath).path());
-                QFile out(instIdxPath);
-                if (out.open(QIODevice::WriteOnly))
-                    out.write(QJsonDocument(doc.object()).toJson(QJsonDocument::Compact));
+                writeFileOrThrow(instIdxPath, QJsonDocument(doc.object()).toJson(QJsonDocument::Compact));
                 return doc.object();
             }
         }
@@ -84,12 +378,15 @@ QJsonObject Installer::fetchAssetIndexCached(const QUrl& url) const
 
     const auto doc = QJsonDocument::fromJson(body);
     if (!doc.isObject()) throw std::runtime_error("Invalid asset index JSON");
+    if (!store) return doc.object();
 
-    // сохранить и в кэш, и в инстанс
+    // сохранить и в кэш, и в инстанс (temp + rename: параллельный читатель не увидит обрезанный индекс)
+    const QByteArray compact = QJsonDocument(doc.object()).toJson(QJsonDocument::Compact);
     QDir().mkpath(QFileInfo(cacheIdxPath).path());
-    { QFile f(cacheIdxPath); if (f.open(QIODevice::WriteOnly)) f.write(QJsonDocument(doc.object()).toJson(QJsonDocument::Compact)); }
+    writeFileOrThrow(cacheIdxPath, compact);
+    if (!toInstance) return doc.object();
     QDir().mkpath(QFileInfo(instIdxPath).path());
-    { QFile f(instIdxPath);  if (f.open(QIODevice::WriteOnly)) f.write(QJsonDocument(doc.object()).toJson(QJsonDocument::Compact)); }
+    writeFileOrThrow(instIdxPath, compact);
 
     return doc.object();
 }
@@ -102,11 +399,13 @@ Installer::Installer(MojangAPI& api, QString gameDir, QString cacheDir)
     , cacheDir_(cacheDir.isEmpty() ? defaultCacheDir() : std::move(cacheDir))
 {
     // гарантируем базовые каталоги
-    ensureDir(gameDir_);
-    ensureDir(assetsObjectsPath(gameDir_));
-    ensureDir(assetsIndexesPath(gameDir_));
-    ensureDir(librariesPath(gameDir_));
-    ensureDir(versionsPath(gameDir_));
+    if (!gameDir_.isEmpty()) {
+        ensureDir(gameDir_);
+        ensureDir(assetsObjectsPath(gameDir_));
+        ensureDir(assetsIndexesPath(gameDir_));
+        ensureDir(librariesPath(gameDir_));
+        ensureDir(versionsPath(gameDir_));
+    }
 
     ensureDir(cacheDir_);
     ensureDir(cacheAssetsObjects());
@@ -114,12 +413,163 @@ Installer::Installer(MojangAPI& api, QString gameDir, QString cacheDir)
     ensureDir(cacheLibraries());
 }
 
+// -------------------- estimate --------------------
+
+// Свободное место (байт, -1 — неизвестно) и устройство ФС для path;
+// ещё не созданный путь — по ближайшему существующему предку
+static qint64 freeSpaceAt(const QString& path, quint64* dev)
+{
+    QString p = QFileInfo(path).absoluteFilePath();
+    while (!QFileInfo::exists(p)) {
+        const QString up = QFileInfo(p).path();
+        if (up == p) break;
+        p = up;
+    }
+#ifdef Q_OS_UNIX
+    const QByteArray enc = QFile::encodeName(p);
+    struct stat st {};
+    if (::stat(enc.constData(), &st) == 0) *dev = quint64(st.st_dev);
+    struct statvfs vs {};
+    if (::statvfs(enc.constData(), &vs) != 0) return -1;
+    return qint64(vs.f_bavail) * qint64(vs.f_frsize);
+#else
+    const QStorageInfo si(p);
+    *dev = qHash(si.rootPath());
+    return si.isValid() ? si.bytesAvailable() : -1;
+#endif
+}
+
+QString Installer::Estimate::shortage() const
+{
+    // natives, индексы, version.json, журнал и манифест в оценку не входят
+    constexpr qint64 kMargin = qint64(64) << 20;
+    auto mib = [](qint64 b) { return QString::number(double(b) / (1 << 20), 'f', 1) + " MiB"; };
+    auto check = [&](qint64 need, qint64 free, const QString& where) {
+        if (free < 0 || free >= need + kMargin) return QString();
+        return QString("Not enough disk space in %1: need %2, free %3").arg(where, mib(need + kMargin), mib(free));
+    };
+    if (sameFilesystem) return check(downloadBytes + instanceBytes, freeCache, cachePath);
+    QString err = check(downloadBytes, freeCache, cachePath);
+    if (err.isEmpty()) err = check(instanceBytes, freeInstance, instancePath);
+    return err;
+}
+
+Installer::Estimate Installer::estimate(const VersionResolved& v, const QString& instanceDir, bool storeIndex) const
+{
+    Estimate e;
+    e.cachePath    = cacheDir_;
+    e.instancePath = instanceDir;
+    qint64 placeBytes = 0;
+
+    auto want = [&](const QString& rel, const QString& cachePath, qint64 size) {
+        if (!QFileInfo::exists(cachePath)) {
+            e.downloadBytes += size;
+            ++e.downloadFiles;
+        }
+        if (!instanceDir.isEmpty() && !QFileInfo::exists(joinPath(instanceDir, rel)))
+            placeBytes += size;
+    };
+
+    const QJsonObject objects = fetchAssetIndexCached(v.assetIndexUrl, storeIndex).value("objects").toObject();
+    QSet<QString> seen;
+    for (auto it = objects.begin(); it != objects.end(); ++it) {
+        const QJsonObject o = it.value().toObject();
+        const QString sha = o.value("hash").toString();
+        if (sha.size() != 40 || seen.contains(sha)) continue;
+        seen.insert(sha);
+        const QString rel = sha.left(2) + "/" + sha;
+        want("assets/objects/" + rel, joinPath(cacheAssetsObjects(), rel), qint64(o.value("size").toDouble()));
+    }
+    for (const auto& lib : v.libraries)
+        want("libraries/" + lib.path, joinPath(cacheLibraries(), lib.path), lib.size);
+    const QString jarRel = v.id + "/" + v.id + ".jar";
+    want("versions/" + jarRel, joinPath(cacheVersions(), jarRel),
+         qint64(v.raw.value("downloads").toObject().value("client").toObject().value("size").toDouble()));
+
+    quint64 cacheDev = 0, instDev = 0;
+    e.freeCache      = freeSpaceAt(cacheDir_, &cacheDev);
+    e.freeInstance   = instanceDir.isEmpty() ? e.freeCache : freeSpaceAt(instanceDir, &instDev);
+    e.sameFilesystem = instanceDir.isEmpty() || cacheDev == instDev;
+    // на одной ФС раскладка — хардлинки (место почти не тратится), на разных — полные копии
+    e.instanceBytes  = e.sameFilesystem ? 0 : placeBytes;
+
+    const qint64 bps = Downloader::throughput();
+    e.etaSeconds = bps > 0 ? e.downloadBytes / bps : -1;
+    return e;
+}
+
 // -------------------- install --------------------
 
-void Installer::install(const VersionResolved& v)
+void Installer::setCancelToken(std::shared_ptr<CancelToken> token)
+{
+    cancel_ = std::move(token);
+    api_.net().setCancelToken(cancel_);
+}
+
+void Installer::install(const VersionResolved& v, const Estimate* preflight)
 {
     ScopeTimer T("install");
+    placer_.resetCounters();
+    const qint64 sysStartMs = processSystemTimeMs();
 
+    // пока идёт установка, сборщик мусора (в том числе из другого процесса) кэш не трогает;
+    // natives распаковываются в execRoot — держим и его
+    CacheRootsLock cacheInUse(cacheDir_, CacheLock::Mode::Shared);
+
+    // место проверяем до начала: полный диск посреди установки оставил бы полуразложенный инстанс
+    if (qEnvironmentVariableIntValue("TESUTO_SKIP_SPACE_CHECK") <= 0) {
+        const Estimate est = preflight ? *preflight : estimate(v, gameDir_);
+        qInfo().noquote() << QString("preflight: download %1 bytes in %2 file(s), copy %3 bytes to instance")
+                                 .arg(est.downloadBytes).arg(est.downloadFiles).arg(est.instanceBytes);
+        const QString err = est.shortage();
+        if (!err.isEmpty()) throw std::runtime_error(err.toStdString());
+    }
+    const qint64 fetchedBefore = Downloader::bytesFetched();
+    QElapsedTimer wall; wall.start();
+
+    // Этапы пишутся в журнал инстанса; прерванная установка этой же версии продолжается с него
+    InstallJournal journal(gameDir_, v.id);
+    if (journal.resumed())
+        qInfo() << "install: resuming interrupted install of" << v.id;
+
+    // файлы прошлой установки, не тронутые с тех пор (размер+mtime), не перехэшируем
+    const InstallManifest prev = InstallManifest::load(gameDir_);
+    trusted_ = prev.validOnDisk(gameDir_);
+
+    try {
+        checkCancelled();
+        if (!journal.stageDone("assets")) installAssets(v, journal);
+        checkCancelled();
+        if (!journal.stageDone("libraries")) installLibraries(v, journal);
+        checkCancelled();
+        if (!journal.stageDone("client")) installClient(v, journal);
+    } catch (...) {
+        // прерванные отменой запросы всплывают как «Assets install failed: …» — наружу отдаём отмену
+        if (cancelled()) throw InstallCancelled();
+        throw;
+    }
+    Downloader::recordThroughput(Downloader::bytesFetched() - fetchedBefore, wall.elapsed());
+
+    // новый манифест; файлы прошлой версии, которых в нём нет, удаляем
+    const InstallManifest next = buildManifest(v);
+    const InstallManifest::Diff diff = InstallManifest::diff(prev, next);
+    for (const QString& rel : diff.remove)
+        QFile::remove(joinPath(gameDir_, rel));
+    next.save(gameDir_);
+    qInfo().noquote() << QString("manifest: %1 file(s), %2 new/changed, %3 removed, %4 trusted by stat")
+                             .arg(next.files.size()).arg(diff.fetch.size()).arg(diff.remove.size())
+                             .arg(trusted_.size());
+    trusted_.clear();
+
+    // всё на месте — журнал больше не нужен
+    journal.commit();
+
+    qInfo().noquote() << "placement:" << placer_.summary()
+                      << QString("(sys %1 ms)").arg(processSystemTimeMs() - sysStartMs);
+}
+
+void Installer::installAssets(const VersionResolved& v, InstallJournal& journal)
+{
     // 1) asset index (кэш-first)
     qInfo() << "assets index";
     const QUrl idxUrl(v.assetIndexUrl);
@@ -133,33 +583,62 @@ void Installer::install(const VersionResolved& v)
         QString rel;
         QString instDst;
         QString cacheSrc;
+        bool    instExists = false; // ответ проверки при планировании: в инстансе лежит (невалидный) файл
+        qint64  size       = 0;     // из индекса, для прогресса
     };
     QVector<AssetTask> tasks;
     tasks.reserve(objects.size());
 
+    // 256 шардов xx/ в кэше и инстансе создаём один раз; дальше — linkat относительно открытых каталогов
+    const FilePlacer::ShardedDir instObjects (assetsObjectsPath(gameDir_));
+    const FilePlacer::ShardedDir cacheObjects(cacheAssetsObjects());
+    QVector<PlacedObject> cachedHits;   // есть в кэше — только разложить (пачкой)
+
+    const bool useUring = IoBatch::available();
+    QElapsedTimer wallTimer; wallTimer.start();
+    std::atomic<qint64> ioNs{0};
+
+    QSet<QString> planned; // один и тот же хэш встречается в индексе под разными именами
     for (auto it = objects.begin(); it != objects.end(); ++it) {
         const auto obj      = it.value().toObject();
         const QString sha   = obj.value("hash").toString();
         if (sha.size() != 40) continue;
+        if (planned.contains(sha)) continue;
+        planned.insert(sha);
+
+        // уже разложен в прерванной установке этой версии или не менялся с прошлой — не перехэшируем
+        if (journal.has('a', sha) || trusted_.value("assets/objects/" + sha.left(2) + "/" + sha) == sha)
+            continue;
 
         const QString rel    = sha.left(2) + "/" + sha;
-        const QString instDst  = joinPath(assetsObjectsPath(gameDir_), rel);
-        const QString cacheSrc = joinPath(cacheAssetsObjects(),       rel);
+        const QString instDst  = instObjects.pathFor(sha);
+        const QString cacheSrc = cacheObjects.pathFor(sha);
 
-        // если в инстансе уже валидно — пропускаем
-        if (QFileInfo::exists(instDst) && sha1File(instDst) == sha)
+        // если в инстансе уже валидно — пропускаем (пустой хэш — файла нет, отдельный exists() не нужен)
+        const QString instSha = sha1File(instDst);
+        if (instSha == sha)
             continue;
+        const bool instExists = !instSha.isEmpty();
 
-        // если в кэше валидно — линкуем/копируем
-        if (QFileInfo::exists(cacheSrc) && sha1File(cacheSrc) == sha) {
-            if (!linkOrCopy(cacheSrc, instDst))
-                throw std::runtime_error(("Cannot place cached asset " + rel).toStdString());
+        // если в кэше валидно — линкуем/копируем (после планирования, одной пачкой)
+        if (sha1File(cacheSrc) == sha) {
+            cachedHits.push_back(PlacedObject{sha, instExists});
             continue;
         }
 
-        tasks.push_back(AssetTask{sha, rel, instDst, cacheSrc});
+        tasks.push_back(AssetTask{sha, rel, instDst, cacheSrc, instExists, qint64(obj.value("size").toDouble())});
     }
 
+    qint64 downloadBytes = 0;
+    for (const auto& t : tasks) downloadBytes += t.size;
+    ProgressMeter meter(observer_, "assets", cachedHits.size() + tasks.size(), downloadBytes);
+
+    {
+        IoPhaseTimer timing(ioNs);
+        placeObjects(cacheObjects, instObjects, cachedHits, useUring, &journal);
+    }
+    meter.add(cachedHits.size(), 0);
+
     // Параллелим скачивание ассетов (самая долгая часть установки)
     const int threads = qEnvironmentVariableIntValue("TESUTO_DL_THREADS") > 0
                         ? qgetenv("TESUTO_DL_THREADS").toInt()
@@ -167,59 +646,145 @@ void Installer::install(const VersionResolved& v)
     QThreadPool pool;
     pool.setMaxThreadCount(qMax(1, threads));
 
-    const QList<QUrl> bases = {
-        QUrl("https://resources.fastmcmirror.org"),
-        QUrl("https://resources.download.minecraft.net")
-    };
+    // LAN-зеркало (если есть) первым: объекты, уже скачанные соседом, не идут из интернета
+    const QList<QUrl> lan = Downloader::lanMirror("resources");
 
-    // ВАЖНО: не бросаем исключения из задач QtConcurrent.
-    // На некоторых сборках Qt это приводит к превращению ошибки в голое `std::exception`
-    // (и мы теряем текст), а иногда и к аварийному завершению.
-    std::atomic_bool anyFail{false};
-    QMutex errMx;
-    QString firstErr;
+    // исключения из задач QtConcurrent не выпускаем — собираем первую ошибку (см. FirstError)
+    FirstError err;
+
+    // io_uring: скачанные объекты копим и пишем пачками (openat/write/close/renameat + linkat в инстанс)
+    struct PendingWrite { PlacedObject obj; QByteArray data; };
+    QMutex pendMx;
+    QVector<PendingWrite> pending;
+    qint64 pendingBytes = 0;
+    const bool durable = qEnvironmentVariableIntValue("TESUTO_IO_FSYNC") > 0;
+
+    // одна загрузка на объект на весь процесс (параллельные установки одной версии)
+    SingleFlight& flights = SingleFlight::instance();
+
+    auto flushWrites = [&](QVector<PendingWrite> batch) {
+        if (batch.isEmpty()) return;
+        IoPhaseTimer timing(ioNs);
+        // объект, запись которого забрал ждущий (SingleFlight::join), второй раз не пишем — только раскладываем
+        QVector<PlacedObject> written;
+        written.reserve(batch.size());
+        QVector<PendingWrite> mine;
+        for (auto& w : batch) {
+            if (flights.claimWrite(w.obj.sha)) mine.push_back(std::move(w));
+            else written.push_back(w.obj);
+        }
+        IoBatch io;
+        for (const auto& w : mine)
+            io.addWrite(cacheObjects.fd(), FilePlacer::ShardedDir::relFor(w.obj.sha), w.data, durable);
+        const bool ran = !mine.isEmpty() && io.run();
+        int i = 0;
+        try {
+            for (; i < mine.size(); ++i) {
+                // не вышло пачкой — обычная запись
+                if (!ran || !io.ok(i))
+                    writeFileOrThrow(cacheObjects.pathFor(mine[i].obj.sha), mine[i].data);
+                flights.done(mine[i].obj.sha);
+                written.push_back(mine[i].obj);
+            }
+        } catch (const std::exception&) {
+            // незаписанное отдаём ждущим (если они есть) — байты проверены
+            for (; i < mine.size(); ++i) {
+                flights.release(mine[i].obj.sha);
+                flights.abandon(mine[i].obj.sha);
+            }
+            throw;
+        }
+        placeObjects(cacheObjects, instObjects, written, true, &journal);
+    };
 
     try {
         QtConcurrent::blockingMap(
             &pool,
             tasks,
             [&](AssetTask& t) {
-                if (anyFail.load()) return; // быстрый выход, если уже есть ошибка
-                try {
-                // отдельный Net на поток (QNetworkAccessManager не потокобезопасен)
-                Net net;
-                MojangAPI api(net);
-
-                QByteArray data = api.dl().getWithMirrors(bases, t.rel);
-
-                // в кэш
-                ensureDir(QFileInfo(t.cacheSrc).dir().absolutePath());
-                {
-                    QFile f(t.cacheSrc);
-                    if (!f.open(QIODevice::WriteOnly))
-                        throw std::runtime_error(("cache write failed: " + t.cacheSrc).toStdString());
-                    if (f.write(data) != data.size())
-                        throw std::runtime_error(("cache write short: " + t.cacheSrc).toStdString());
-                }
+                if (err.failed() || cancelled()) return; // быстрый выход, если уже есть ошибка или отмена
+                err.guard([&] {
+                auto placeFromCache = [&] {
+                    IoPhaseTimer timing(ioNs);
+                    if (!placer_.placeObject(cacheObjects, instObjects, t.sha, t.instExists))
+                        throw std::runtime_error(("Cannot place asset to instance " + t.rel).toStdString());
+                    journal.record('a', t.sha);
+                };
 
-                if (sha1File(t.cacheSrc) != t.sha) {
-                    QFile::remove(t.cacheSrc);
-                    throw std::runtime_error(("Checksum mismatch for asset " + t.rel).toStdString());
+                // этот объект уже качает другая установка — ждём её, а не качаем второй раз
+                const SingleFlight::Join join = flights.join(t.sha);
+                if (!join.leader) {
+                    // ведущий отложил запись в свою пачку — байты проверены, пишем сами
+                    if (!join.written) {
+                        // запись, отложенную ведущим в пачку, join отдал нам — ведущий её пропустит
+                        IoPhaseTimer timing(ioNs);
+                        try {
+                            writeFileOrThrow(t.cacheSrc, join.data);
+                        } catch (...) {
+                            flights.release(t.sha);
+                            throw;
+                        }
+                        flights.done(t.sha);
+                    }
+                    placeFromCache();
+                    meter.add(1, t.size);
+                    return;
                 }
+                QByteArray data;
+                QVector<PendingWrite> ready;
+                bool deferred = false;
+                try {
+                    // пока мы планировали или ждали, объект мог появиться в кэше
+                    if (sha1File(t.cacheSrc) == t.sha) {
+                        flights.done(t.sha);
+                    } else {
+                        // отдельный Net на поток (QNetworkAccessManager не потокобезопасен)
+                        Net net;
+                        net.setCancelToken(cancel_);
+                        MojangAPI api(net);
 
-                // в инстанс (линк/копия)
-                if (!Installer::linkOrCopy(t.cacheSrc, t.instDst))
-                    throw std::runtime_error(("Cannot place asset to instance " + t.rel).toStdString());
+                        // сеть — без шард-лока (см. SingleFlight::fetchToCache);
+                        // sha1 проверен по буферу — не перечитываем только что записанный файл
+                        data = fetchAssetObject(api.dl(), lan, t.sha);
 
+                        // пачка io_uring пишет без шард-лока: другой процесс в худшем случае
+                        // запишет тот же объект ещё раз, но целостности это не вредит (temp + rename)
+                        if (useUring && cacheObjects.fd() >= 0) {
+                            flights.publish(t.sha, data);
+                            QMutexLocker lk(&pendMx);
+                            pendingBytes += data.size();
+                            pending.push_back(PendingWrite{PlacedObject{t.sha, t.instExists}, std::move(data)});
+                            if (pending.size() >= 64 || pendingBytes >= (32 << 20)) {
+                                ready.swap(pending);
+                                pendingBytes = 0;
+                            }
+                            deferred = true;
+                        } else {
+                            // в кэш (шард-каталог уже создан); под шард-локом — с перепроверкой
+                            {
+                                CacheLock shard(CacheLock::shardFile(cacheDir_, t.sha), CacheLock::Mode::Exclusive);
+                                IoPhaseTimer timing(ioNs);
+                                if (sha1File(t.cacheSrc) != t.sha) writeFileOrThrow(t.cacheSrc, data);
+                            }
+                            flights.done(t.sha);
+                        }
+                    }
                 } catch (const std::exception& e) {
-                    anyFail.store(true);
-                    QMutexLocker lk(&errMx);
-                    if (firstErr.isEmpty()) firstErr = QString::fromUtf8(e.what());
-                } catch (...) {
-                    anyFail.store(true);
-                    QMutexLocker lk(&errMx);
-                    if (firstErr.isEmpty()) firstErr = QStringLiteral("Unknown non-std exception");
+                    flights.fail(t.sha, QString::fromUtf8(e.what()));
+                    throw;
                 }
+                // дальше загрузкой владеет пачка: done/fail для неё выставит flushWrites
+                if (deferred) {
+                    flushWrites(std::move(ready));
+                    meter.add(1, t.size);
+                    return;
+                }
+
+                // в инстанс (линк/копия)
+                placeFromCache();
+                meter.add(1, t.size);
+
+                });
             }
         );
     } catch (const std::exception& e) {
@@ -229,111 +794,447 @@ void Installer::install(const VersionResolved& v)
         throw std::runtime_error("Assets parallel stage failed: Unknown exception");
     }
 
-    if (anyFail.load())
-        throw std::runtime_error(("Assets install failed: " + firstErr).toStdString());
+    if (!err.failed()) {
+        err.guard([&] { flushWrites(std::move(pending)); });
+    } else {
+        // установка падает, но скачанное и проверенное ждущим ещё пригодится
+        for (const auto& w : pending) flights.abandon(w.obj.sha);
+    }
+
+    err.throwIfFailed("Assets install failed: ");
+
+    {
+        // obj/s — по времени только раскладки и записи (сумма по потокам), без sha1-планирования и сети
+        const qint64 n    = cachedHits.size() + tasks.size();
+        const qint64 ioMs = qMax<qint64>(1, ioNs.load() / 1000000);
+        qInfo().noquote() << QString("assets: %1 objects in %2 ms; placement and writes %3 ms of I/O "
+                                     "(%4 obj/s, io backend: %5)")
+                             .arg(n).arg(wallTimer.elapsed()).arg(ioMs).arg(n * 1000 / ioMs)
+                             .arg(useUring ? "io_uring" : "thread pool");
+    }
+
+    // задачи, пропущенные из-за отмены, не скачаны — этап не завершён
+    checkCancelled();
+    journal.markStage("assets");
+}
 
+void Installer::installLibraries(const VersionResolved& v, InstallJournal& journal)
+{
     // 3) libraries (теперь тоже кэшируем — ускоряет повторные установки)
     qInfo() << "libraries";
+    qint64 libBytes = 0;
+    for (const auto& lib : v.libraries) libBytes += lib.size;
+    ProgressMeter meter(observer_, "libraries", v.libraries.size(), libBytes);
+    auto libDone = [&](const LibEntry& lib) {
+        journal.record('l', lib.path);
+        meter.add(1, lib.size);
+    };
+
+    QStringList nativeJars;
     for (const auto& lib : v.libraries) {
+        checkCancelled();
         const QString dst = joinPath(librariesPath(gameDir_), lib.path);
         const QString cacheDst = joinPath(cacheLibraries(), lib.path);
 
-        if (QFileInfo::exists(dst) && (lib.sha1.isEmpty() || sha1File(dst) == lib.sha1))
+        // natives-jar нужны и уже лежащие: каталог natives в общем кэше может ещё не существовать
+        if (lib.isNative)
+            nativeJars << dst;
+
+        if (journal.has('l', lib.path)) {
+            meter.add(1, lib.size);
+            continue;
+        }
+        const auto known = trusted_.constFind("libraries/" + lib.path);
+        if (known != trusted_.constEnd() && (lib.sha1.isEmpty() || *known == lib.sha1)) {
+            libDone(lib);
             continue;
+        }
+        if (QFileInfo::exists(dst) && (lib.sha1.isEmpty() || sha1File(dst) == lib.sha1)) {
+            libDone(lib);
+            continue;
+        }
 
         // если в кэше уже есть — разложим
         if (QFileInfo::exists(cacheDst) && (lib.sha1.isEmpty() || sha1File(cacheDst) == lib.sha1)) {
             if (!linkOrCopy(cacheDst, dst))
                 throw std::runtime_error(("Cannot place cached lib " + lib.path).toStdString());
         } else {
-            ensureDir(QFileInfo(cacheDst).dir().absolutePath());
-            QByteArray data;
-
-            try { data = api_.dl().getWithMirrors({ lib.url }, ""); }
-            catch (...) {
-                const QString rel = lib.path; // стандартный maven layout
-                data = api_.dl().getWithMirrors(
-                    { QUrl("https://libraries.fastmcmirror.org"),
-                      QUrl("https://libraries.minecraft.net") },
-                    rel);
-            }
-
-            { QFile f(cacheDst); if (!f.open(QIODevice::WriteOnly)) throw std::runtime_error("lib cache write failed"); f.write(data); }
-
-            if (!lib.sha1.isEmpty() && sha1File(cacheDst) != lib.sha1) {
-                QFile::remove(cacheDst);
-                throw std::runtime_error(("Checksum mismatch for lib " + lib.path).toStdString());
-            }
+            // ту же библиотеку может прямо сейчас качать другая установка — тогда ждём её файл в кэше
+            SingleFlight::instance().fetchToCache(cacheDir_, "libraries/" + lib.path, cacheDst,
+                [&] { return QFileInfo::exists(cacheDst) && (lib.sha1.isEmpty() || sha1File(cacheDst) == lib.sha1); },
+                [&] { return fetchLibrary(api_.dl(), lib); });
 
             // в инстанс
             if (!linkOrCopy(cacheDst, dst))
                 throw std::runtime_error(("Cannot place lib to instance " + lib.path).toStdString());
         }
+        libDone(lib);
+    }
 
-        if (lib.isNative) {
-            const QString natDir = nativesPath(gameDir_, v.id);
-            ensureDir(natDir);
-            QProcess p;
-            p.setProgram("unzip");
-            p.setArguments({ "-o", dst, "-d", natDir });
-            p.start();
-            if (!p.waitForFinished(-1) || p.exitStatus()!=QProcess::NormalExit || p.exitCode()!=0) {
-                const QString err = QString::fromUtf8(p.readAllStandardError());
-                throw std::runtime_error(
-                    QString("unzip failed for natives: %1 (exit %2) %3")
-                        .arg(dst)
-                        .arg(p.exitCode())
-                        .arg(err)
-                        .toStdString());
+    // natives: один раз на (версия, arch, набор jar'ов) в общий кэш; Launcher берёт их оттуда
+    if (!nativeJars.isEmpty()) {
+        const QString natDir = CachePaths::nativesDirFor(v, cacheDir_);
+        if (QFileInfo::exists(CachePaths::nativesCompleteMarker(natDir))) {
+            qInfo() << "natives: shared cache hit" << natDir;
+        } else {
+            // распаковываем во временный каталог рядом и переименовываем целиком —
+            // параллельная установка той же версии не увидит полу-распакованный каталог
+            const QString staging = natDir + QString(".partial-%1").arg(QCoreApplication::applicationPid());
+            QDir(staging).removeRecursively();
+            try {
+                extractNatives(nativeJars, staging);
+            } catch (...) {
+                QDir(staging).removeRecursively();
+                throw;
+            }
+            { QFile m(CachePaths::nativesCompleteMarker(staging)); m.open(QIODevice::WriteOnly); }
+            if (!QDir().rename(staging, natDir)) {
+                // кто-то успел раньше — его каталог ничем не хуже
+                QDir(staging).removeRecursively();
+                if (!QFileInfo::exists(CachePaths::nativesCompleteMarker(natDir)))
+                    throw std::runtime_error(("Cannot commit natives dir " + natDir).toStdString());
             }
         }
     }
+    journal.markStage("libraries");
+}
 
-    // 4) client.jar (как было, без изменений)
+void Installer::installClient(const VersionResolved& v, InstallJournal& journal)
+{
+    // 4) client.jar
     qInfo() << "client.jar";
     const QString verDir   = joinPath(versionsPath(gameDir_), v.id);
     ensureDir(verDir);
     const QString clientJar = joinPath(verDir, v.id + ".jar");
+    // копия в общем кэше: другие инстансы этой версии и пакеты кэша (CachePack) берут её оттуда
+    const QString cacheVerDir = joinPath(cacheVersions(), v.id);
+    const QString cacheJar    = joinPath(cacheVerDir, v.id + ".jar");
 
     const auto clientObj = v.raw.value("downloads").toObject().value("client").toObject();
     const QString expectedSha = clientObj.value("sha1").toString();
+    const qint64 clientSize = qint64(clientObj.value("size").toDouble());
+    ProgressMeter meter(observer_, "client", 1, clientSize);
 
     auto needDownload = [&](){
         if (!QFileInfo::exists(clientJar)) return true;
         if (expectedSha.isEmpty()) return false;
+        if (trusted_.value("versions/" + v.id + "/" + v.id + ".jar") == expectedSha) return false;
         return sha1File(clientJar) != expectedSha;
     };
 
-    if (needDownload()) {
-        QByteArray data;
-        bool ok = false;
+    const bool need   = needDownload();
+    const bool cached = QFileInfo::exists(cacheJar);
+    if (need && cached && (expectedSha.isEmpty() || sha1File(cacheJar) == expectedSha)) {
+        if (!linkOrCopy(cacheJar, clientJar))
+            throw std::runtime_error("Cannot place cached client.jar");
+    } else if (need) {
+        // запись через временный файл + rename: живой client.jar не бывает полузаписанным
+        const QByteArray data = fetchClientJar(api_.dl(), v, cacheVersions());
+        ensureDir(cacheVerDir);
+        writeFileOrThrow(cacheJar, data);
+        if (!linkOrCopy(cacheJar, clientJar))
+            throw std::runtime_error("Cannot place client.jar to instance");
+    } else if (!cached) {
+        // поставлен до появления копии в кэше — положим её туда
+        ensureDir(cacheVerDir);
+        linkOrCopy(clientJar, cacheJar);
+    }
 
-        try { data = api_.dl().getWithMirrors({ v.clientJarUrl }, QString()); ok = true; }
-        catch (...) {}
+    // 5) version.json (и в кэш: по нему пакет кэша знает, какой Java нужна версии)
+    const QByteArray json = QJsonDocument(v.raw).toJson();
+    writeFileOrThrow(joinPath(verDir, v.id + ".json"), json);
+    ensureDir(cacheVerDir);
+    writeFileOrThrow(joinPath(cacheVerDir, v.id + ".json"), json);
 
-        if (!ok && expectedSha.size() == 40) {
-            const QString rel = "v1/objects/" + expectedSha + "/client.jar";
-            try { data = api_.dl().getWithMirrors({ QUrl("https://piston-data.mojang.com") }, rel); ok = true; }
-            catch (...) {}
-        }
-        if (!ok) {
-            const QUrl bmcl(QString("https://bmclapi2.bangbang93.com/version/%1/client").arg(v.id));
-            try { data = api_.dl().getWithMirrors({ bmcl }, QString()); ok = true; }
-            catch (...) {}
+    meter.add(1, clientSize);
+    journal.markStage("client");
+}
+
+// -------------------- prefetch --------------------
+
+Installer::PrefetchStats Installer::prefetch(const QList<VersionResolved>& versions, const ProgressFn& onProgress)
+{
+    ScopeTimer T("prefetch");
+    // пока качаем, сборщик мусора (в том числе из другого процесса) кэш не трогает
+    CacheLock cacheInUse(CacheLock::wholeFile(cacheDir_), CacheLock::Mode::Shared);
+    const FilePlacer::ShardedDir cacheObjects(cacheAssetsObjects()); // заодно создаёт шарды xx/
+
+    // 1) объединённый план. Ключ — путь в кэше: общие для версий файлы схлопываются.
+    // Что уже лежит в кэше, не перехэшируем — sha1 проверит установка при раскладке
+    struct Item {
+        enum Kind { Object, Library, Client } kind;
+        QString  flight;   // ключ SingleFlight/шарда
+        QString  dst;      // путь в кэше
+        qint64   size = 0;
+        int      ver  = -1;
+        LibEntry lib;
+    };
+    QVector<Item> plan;
+    QSet<QString> seen;
+    PrefetchStats st;
+    auto want = [&](Item it) {
+        if (seen.contains(it.dst)) return;
+        seen.insert(it.dst);
+        if (QFileInfo::exists(it.dst)) { ++st.alreadyCached; return; }
+        st.totalBytes += it.size;
+        plan.push_back(std::move(it));
+    };
+
+    for (int i = 0; i < versions.size(); ++i) {
+        const VersionResolved& v = versions[i];
+        const QString verDir = joinPath(cacheVersions(), v.id);
+        ensureDir(verDir);
+        writeFileOrThrow(joinPath(verDir, v.id + ".json"), QJsonDocument(v.raw).toJson());
+
+        const QJsonObject objects = fetchAssetIndexCached(v.assetIndexUrl).value("objects").toObject();
+        for (auto it = objects.begin(); it != objects.end(); ++it) {
+            const QJsonObject o = it.value().toObject();
+            const QString sha = o.value("hash").toString();
+            if (sha.size() != 40) continue;
+            want({Item::Object, sha, cacheObjects.pathFor(sha), qint64(o.value("size").toDouble()), i, LibEntry()});
         }
-        if (!ok) throw std::runtime_error("Cannot download client.jar from all mirrors");
+        for (const LibEntry& lib : v.libraries)
+            if (!lib.path.isEmpty()) want({Item::Library, "libraries/" + lib.path, joinPath(cacheLibraries(), lib.path), lib.size, i, lib});
+
+        const qint64 jarSize = qint64(v.raw.value("downloads").toObject().value("client").toObject()
+                                          .value("size").toDouble());
+        want({Item::Client, "versions/" + v.id, joinPath(verDir, v.id + ".jar"), jarSize, i, LibEntry()});
+    }
+    qInfo().noquote() << QString("prefetch: %1 version(s), %2 unique file(s) to fetch (%3 bytes), %4 already cached")
+                             .arg(versions.size()).arg(plan.size()).arg(st.totalBytes).arg(st.alreadyCached);
+    if (onProgress) onProgress(0, st.totalBytes);
 
-        { QFile f(clientJar); if (!f.open(QIODevice::WriteOnly)) throw std::runtime_error("write client.jar failed"); f.write(data); }
-        if (!expectedSha.isEmpty() && sha1File(clientJar) != expectedSha) {
-            QFile::remove(clientJar);
-            throw std::runtime_error("Checksum mismatch for client.jar");
+    // 2) параллельная загрузка; каждый уникальный файл — один раз
+    const int threads = qEnvironmentVariableIntValue("TESUTO_DL_THREADS") > 0
+                        ? qgetenv("TESUTO_DL_THREADS").toInt()
+                        : 8;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, threads));
+    const QList<QUrl> lan = Downloader::lanMirror("resources");
+    SingleFlight& flights = SingleFlight::instance();
+
+    std::atomic<qint64> doneBytes{0};
+    std::atomic_int nObjects{0}, nLibraries{0}, nClients{0};
+    FirstError err;
+
+    QtConcurrent::blockingMap(&pool, plan, [&](Item& item) {
+        if (err.failed()) return;
+        err.guard([&] {
+            // другая установка в этом процессе уже качает этот файл — ждём её
+            const bool fetched = flights.fetchToCache(cacheDir_, item.flight, item.dst,
+                [&] { return QFileInfo::exists(item.dst); },
+                [&] {
+                    // отдельный Net на поток (QNetworkAccessManager не потокобезопасен)
+                    Net net;
+                    MojangAPI api(net);
+                    switch (item.kind) {
+                    case Item::Object:  return fetchAssetObject(api.dl(), lan, item.flight);
+                    case Item::Library: return fetchLibrary(api.dl(), item.lib);
+                    case Item::Client:  return fetchClientJar(api.dl(), versions[item.ver], cacheVersions());
+                    }
+                    return QByteArray();
+                });
+            if (fetched) {
+                switch (item.kind) {
+                case Item::Object:  nObjects.fetch_add(1);   break;
+                case Item::Library: nLibraries.fetch_add(1); break;
+                case Item::Client:  nClients.fetch_add(1);   break;
+                }
+            }
+            const qint64 done = doneBytes.fetch_add(item.size) + item.size;
+            if (onProgress) onProgress(done, st.totalBytes);
+        });
+    });
+    err.throwIfFailed("Prefetch failed: ");
+
+    st.objects   = nObjects.load();
+    st.libraries = nLibraries.load();
+    st.clients   = nClients.load();
+    qInfo().noquote() << QString("prefetch: fetched %1 object(s), %2 librar(ies), %3 client jar(s)")
+                             .arg(st.objects).arg(st.libraries).arg(st.clients);
+    return st;
+}
+
+// -------------------- repair --------------------
+
+Installer::RepairStats Installer::repair(const VersionResolved& v, const ProgressFn& onProgress)
+{
+    ScopeTimer T("repair");
+    RepairStats st;
+
+    InstallManifest m = InstallManifest::load(gameDir_);
+    if (m.isEmpty() || m.versionId != v.id) {
+        qInfo() << "repair: no manifest for" << v.id << "- running full install";
+        install(v);
+        st.reinstalled = true;
+        return st;
+    }
+    CacheLock cacheInUse(CacheLock::wholeFile(cacheDir_), CacheLock::Mode::Shared);
+    // библиотеки модлоадера (свой манифест, в нём и URL для повторной загрузки)
+    InstallManifest lm = InstallManifest::load(gameDir_, InstallManifest::Part::Loader);
+
+    // 1) проверка: stat здесь не верим, хэшируем всё
+    QList<InstallManifest::File> files = m.files.values();
+    for (const auto& f : lm.files)
+        if (!m.files.contains(f.path)) files.push_back(f);
+    qint64 total = 0;
+    for (const auto& f : files) total += f.size;
+    std::atomic<qint64> checkedBytes{0};
+    QMutex badMx;
+    QList<InstallManifest::File> bad;
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+        QtConcurrent::blockingMap(&pool, files, [&](InstallManifest::File& f) {
+            if (sha1File(joinPath(gameDir_, f.path)) != f.sha1) {
+                QMutexLocker lk(&badMx);
+                bad.push_back(f);
+            }
+            const qint64 done = checkedBytes.fetch_add(f.size) + f.size;
+            if (onProgress) onProgress(done, total);
+        });
+    }
+    st.checked = files.size();
+    st.broken  = bad.size();
+    qInfo().noquote() << QString("repair: %1 file(s) checked, %2 broken").arg(st.checked).arg(st.broken);
+    if (bad.isEmpty()) return st;
+
+    // 2) починка только битых
+    const QString jarRel  = "versions/" + v.id + "/" + v.id + ".jar";
+    const QString jsonRel = "versions/" + v.id + "/" + v.id + ".json";
+    QHash<QString, LibEntry> libs;
+    for (const auto& lib : v.libraries) libs.insert("libraries/" + lib.path, lib);
+
+    QList<InstallManifest::File> fetch;
+    qint64 fetchTotal = 0;
+    for (const auto& f : bad) {
+        const QString dst = joinPath(gameDir_, f.path);
+        // индекс и version.json — мелочь и без загрузки по сети из пула (api_ не потокобезопасен)
+        if (f.path == jsonRel) {
+            writeFileOrThrow(dst, QJsonDocument(v.raw).toJson());
+        } else if (f.path.startsWith("assets/indexes/")) {
+            QFile::remove(dst);
+            fetchAssetIndexCached(v.assetIndexUrl);
+        } else {
+            fetch.push_back(f);
+            fetchTotal += f.size;
+            continue;
         }
+        m.add(gameDir_, f.path, sha1File(dst));
+        ++st.repaired;
     }
 
-    // 5) version.json
-    QFile vv(joinPath(verDir, v.id + ".json"));
-    if (vv.open(QIODevice::WriteOnly))
-        vv.write(QJsonDocument(v.raw).toJson());
+    const FilePlacer::ShardedDir cacheObjects(cacheAssetsObjects());
+    const QList<QUrl> lan = Downloader::lanMirror("resources");
+    SingleFlight& flights = SingleFlight::instance();
+
+    // копия в кэше: целая — берём её, иначе качаем заново (одна загрузка на процесс)
+    auto ensureCached = [&](const QString& key, const QString& path, const QString& sha,
+                            const std::function<QByteArray()>& download) {
+        flights.fetchToCache(cacheDir_, key, path, [&] { return sha1File(path) == sha; }, download);
+    };
+
+    const int threads = qEnvironmentVariableIntValue("TESUTO_DL_THREADS") > 0
+                        ? qgetenv("TESUTO_DL_THREADS").toInt()
+                        : 8;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, threads));
+    std::atomic<qint64> fixedBytes{0};
+    FirstError err;
+    QMutex manifestMx;
+
+    QtConcurrent::blockingMap(&pool, fetch, [&](InstallManifest::File& f) {
+        if (err.failed()) return;
+        err.guard([&] {
+            Net net;
+            MojangAPI api(net);
+            QString src;
+            if (f.path.startsWith("assets/objects/")) {
+                const QString sha = QFileInfo(f.path).fileName();
+                src = cacheObjects.pathFor(sha);
+                ensureCached(sha, src, f.sha1, [&] { return fetchAssetObject(api.dl(), lan, sha); });
+            } else if (libs.contains(f.path)) {
+                const LibEntry lib = libs.value(f.path);
+                src = joinPath(cacheLibraries(), lib.path);
+                ensureCached(f.path, src, f.sha1, [&] { return fetchLibrary(api.dl(), lib); });
+            } else if (f.path == jarRel) {
+                const QString verDir = joinPath(cacheVersions(), v.id);
+                ensureDir(verDir);
+                src = joinPath(verDir, v.id + ".jar");
+                ensureCached("versions/" + v.id, src, f.sha1, [&] {
+                    return fetchClientJar(api.dl(), v, cacheVersions());
+                });
+            } else if (lm.files.contains(f.path) && !f.url.isEmpty()) {
+                // библиотека лоадера: тот же кэш и ключ, что у ModloaderInstaller
+                src = joinPath(cacheDir_, f.path);
+                ensureCached(f.path, src, f.sha1, [&] {
+                    const QByteArray data = api.dl().getWithMirrors({ QUrl(f.url) }, QString());
+                    if (QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() != f.sha1.toLatin1())
+                        throw std::runtime_error(("Checksum mismatch for loader lib " + f.path).toStdString());
+                    return data;
+                });
+            } else {
+                throw std::runtime_error(("Unknown origin of " + f.path).toStdString());
+            }
+
+            // битая копия в инстансе могла быть тем же inode, что и старая копия кэша — кладём заново
+            const QString dst = joinPath(gameDir_, f.path);
+            QFile::remove(dst);
+            if (!linkOrCopy(src, dst))
+                throw std::runtime_error(("Cannot place repaired " + f.path).toStdString());
+            {
+                QMutexLocker lk(&manifestMx);
+                (m.files.contains(f.path) ? m : lm).add(gameDir_, f.path, f.sha1);
+                ++st.repaired;
+            }
+            const qint64 done = fixedBytes.fetch_add(f.size) + f.size;
+            if (onProgress) onProgress(done, fetchTotal);
+        });
+    });
+
+    // починенное отмечаем в манифесте и при частичной неудаче
+    m.save(gameDir_);
+    if (!lm.isEmpty()) lm.save(gameDir_, InstallManifest::Part::Loader);
+    qInfo().noquote() << QString("repair: %1 of %2 broken file(s) repaired").arg(st.repaired).arg(st.broken);
+    err.throwIfFailed("Repair failed: ");
+    return st;
+}
+
+// -------------------- manifest --------------------
+
+InstallManifest Installer::buildManifest(const VersionResolved& v) const
+{
+    InstallManifest m;
+    m.versionId = v.id;
+
+    // хэш известен заранее (из индекса/version.json) или файл не менялся — не читаем содержимое
+    auto shaOf = [&](const QString& rel, const QString& known) {
+        if (!known.isEmpty()) return known;
+        const QString t = trusted_.value(rel);
+        return t.isEmpty() ? sha1File(joinPath(gameDir_, rel)) : t;
+    };
+
+    const QString idxRel = "assets/indexes/" + QFileInfo(v.assetIndexUrl.path()).completeBaseName() + ".json";
+    m.add(gameDir_, idxRel, sha1File(joinPath(gameDir_, idxRel)));
+
+    const QJsonObject objects = fetchAssetIndexCached(v.assetIndexUrl).value("objects").toObject();
+    for (auto it = objects.begin(); it != objects.end(); ++it) {
+        const QString sha = it.value().toObject().value("hash").toString();
+        if (sha.size() != 40) continue;
+        m.add(gameDir_, "assets/objects/" + sha.left(2) + "/" + sha, sha);
+    }
+
+    for (const auto& lib : v.libraries) {
+        const QString rel = "libraries/" + lib.path;
+        m.add(gameDir_, rel, shaOf(rel, lib.sha1));
+    }
+
+    const QString jarRel = "versions/" + v.id + "/" + v.id + ".jar";
+    m.add(gameDir_, jarRel,
+          shaOf(jarRel, v.raw.value("downloads").toObject().value("client").toObject().value("sha1").toString()));
+    const QString jsonRel = "versions/" + v.id + "/" + v.id + ".json";
+    m.add(gameDir_, jsonRel, sha1File(joinPath(gameDir_, jsonRel)));
+    return m;
 }
 
 // -------------------- classpath --------------------
@@ -349,59 +1250,20 @@ QStringList Installer::classpathJars(const VersionResolved& v) const
 }
 
 
-QString Installer::installTemurinJre(int major, const QString& destBase, QString* outVersion)
+QString Installer::installTemurinJre(int major, QString* outVersion)
 {
 #ifdef Q_OS_LINUX
-    // Resolve arch/os
-#if defined(Q_PROCESSOR_X86_64)
-    const QString arch = "x64";
-#elif defined(Q_PROCESSOR_ARM_64)
-    const QString arch = "aarch64";
-#else
-    const QString arch = "x64";
-#endif
-    const QString os = "linux";
-
-    // Build URL to Adoptium API (JRE, hotspot)
-    const QString api = QString("https://api.adoptium.net/v3/binary/latest/%1/ga/%2/%3/jre/hotspot/normal/eclipse")
-                        .arg(QString::number(major), os, arch);
-
-    Net net;
-    Downloader dl(net);
-    QByteArray data = dl.getWithMirrors({QUrl(api)}, QString());
-
-    // Save to cache file
-    const QString cache = QDir(defaultCacheDir()).filePath(QString("temurin-jre-%1-%2-%3.tar.gz").arg(major).arg(os).arg(arch));
-    {
-        QFile f(cache);
-        if (!f.open(QIODevice::WriteOnly))
-            throw std::runtime_error(("Cannot write cache file: " + cache).toStdString());
-        if (f.write(data) != data.size())
-            throw std::runtime_error(("Short write cache file: " + cache).toStdString());
-    }
-
-    // Extract
-    const QString runtimeBase = QDir(destBase).filePath(QString("java-%1").arg(major));
-    QDir().mkpath(runtimeBase);
-    QProcess tar;
-    tar.start("tar", {"-xzf", cache, "-C", runtimeBase, "--strip-components=1"});
-    if (!tar.waitForFinished(-1) || tar.exitStatus()!=QProcess::NormalExit || tar.exitCode()!=0) {
-        const QString err = QString::fromUtf8(tar.readAllStandardError());
-        throw std::runtime_error(
-            QString("tar extract failed (exit %1): %2")
-                .arg(tar.exitCode())
-                .arg(err)
-                .toStdString());
-    }
-
-    const QString javaPath = QDir(runtimeBase).filePath("bin/java");
-    QFile fi(javaPath);
-    fi.setPermissions(fi.permissions() | QFile::ExeOwner | QFile::ExeGroup | QFile::ExeOther);
-
-    if (outVersion) *outVersion = QString::number(major);
-    return javaPath;
+    // общий для всех инстансов стор рантаймов в кэше: один build распаковывается один раз
+    RuntimeStore store(cacheDir_);
+    return store.ensureTemurin(major, outVersion);
 #else
-    Q_UNUSED(major); Q_UNUSED(destBase); Q_UNUSED(outVersion);
+    Q_UNUSED(major); Q_UNUSED(outVersion);
     return QString();
 #endif
 }
+
+QString Installer::installMojangRuntime(const VersionResolved& v, QString* outVersion)
+{
+    RuntimeStore store(cacheDir_);
+    return store.ensureMojang(v.javaComponent, outVersion);
+}
@@ -1,47 +1,137 @@
 #pragma once
 #include <QtCore>
+#include <functional>
+#include <memory>
 #include "MojangAPI.h"
 #include "Downloader.h"
 #include "Util.h"
+#include "FilePlacer.h"
+#include "InstallManifest.h"
+#include "CancelToken.h"
+#include "InstallObserver.h"
+
+class InstallJournal;
 
 class Installer {
 public:
-    // cacheDir можно не указывать — возьмём дефолтный (~/.cache/tesuto-launcher)
+    // cacheDir можно не указывать — возьмём дефолтный (~/.cache/tesuto-launcher).
+    // Пустой gameDir — только работа с кэшем (prefetch), каталоги инстанса не создаются
     Installer(MojangAPI& api, QString gameDir, QString cacheDir = QString());
 
-    // Ставит всё нужное для версии в gameDir_
-    void install(const VersionResolved& v);
+    // Оценка установки v в instanceDir (пусто — только кэш): сколько качать (по размерам из индекса
+    // assets и version.json, минус уже лежащее в кэше), сколько займут копии в инстансе и сколько
+    // места свободно (statvfs). Ничего не хэширует, только stat. storeIndex = false — скачанный
+    // индекс assets не сохраняется (оценка для просмотра, ставить версию ещё не решили)
+    struct Estimate {
+        qint64  downloadBytes  = 0;
+        int     downloadFiles  = 0;
+        qint64  instanceBytes  = 0;  // копии в инстансе: 0, если кэш и инстанс на одной ФС (хардлинки)
+        qint64  freeCache      = -1; // байт свободно; -1 — неизвестно
+        qint64  freeInstance   = -1;
+        bool    sameFilesystem = true;
+        qint64  etaSeconds     = -1; // по скорости прошлых установок; -1 — не измерялась
+        QString cachePath;
+        QString instancePath;
+
+        // Пусто — места хватает; иначе текст ошибки (сколько нужно и сколько свободно)
+        QString shortage() const;
+    };
+    Estimate estimate(const VersionResolved& v, const QString& instanceDir, bool storeIndex = true) const;
+
+    // Ставит всё нужное для версии в gameDir_. Перед началом проверяет место на диске
+    // (TESUTO_SKIP_SPACE_CHECK=1 — не проверять); preflight — уже посчитанная оценка этой же
+    // версии в gameDir_, тогда она не считается второй раз
+    void install(const VersionResolved& v, const Estimate* preflight = nullptr);
+
+    // Ход install() по этапам ("assets", "libraries", "client"): объекты и байты, скорость, ETA.
+    // Отмена прерывает текущие запросы, install() бросает InstallCancelled; журнал остаётся,
+    // следующая установка продолжит с места остановки. Токен ставится и на Net из api
+    void setObserver(InstallObserver* obs) { observer_ = obs; }
+    void setCancelToken(std::shared_ptr<CancelToken> token);
+
+    // Предзагрузка набора версий в общий кэш (для офлайна), без инстанса.
+    // План — объединение assets, библиотек и client.jar всех версий: каждый уникальный файл
+    // качается один раз, прогресс — по уникальным байтам (onProgress зовётся из рабочих потоков).
+    struct PrefetchStats {
+        int    objects       = 0; // скачано уникальных объектов assets
+        int    libraries     = 0;
+        int    clients       = 0;
+        int    alreadyCached = 0;
+        qint64 totalBytes    = 0; // объём скачанного плана
+    };
+    using ProgressFn = std::function<void(qint64 doneBytes, qint64 totalBytes)>;
+    PrefetchStats prefetch(const QList<VersionResolved>& versions, const ProgressFn& onProgress = ProgressFn());
+
+    // Починка инстанса: полный sha1 всех файлов из манифеста (параллельно), затем перекачка и
+    // раскладка только несовпавших. Копия в кэше тоже перепроверяется — битый файл инстанса часто
+    // хардлинк на такой же битый объект кэша. Нет манифеста этой версии — обычная install().
+    // onProgress — сначала по байтам проверки, затем по байтам починки. Ошибки — std::runtime_error
+    struct RepairStats {
+        int  checked     = 0;
+        int  broken      = 0;
+        int  repaired    = 0;
+        bool reinstalled = false; // сверять было не с чем, выполнена install()
+    };
+    RepairStats repair(const VersionResolved& v, const ProgressFn& onProgress = ProgressFn());
 
     // Класс-путь для запуска (libs + client.jar)
     QStringList classpathJars(const VersionResolved& v) const;
 
 
 
-    // Install Temurin JRE to destBase (e.g., <gameDir>/runtime). Returns path to bin/java.
+    // Install Temurin JRE into the shared runtime store (<cache>/runtimes). Returns path to bin/java.
     // Only linux implemented; others return empty string.
-    QString installTemurinJre(int major, const QString& destBase, QString* outVersion = nullptr);
+    QString installTemurinJre(int major, QString* outVersion = nullptr);
+
+    // Mojang java-runtime для версии (javaVersion.component) из общего стора. Пусто — компонента нет
+    // в version.json или Mojang не публикует рантайм для этой платформы.
+    QString installMojangRuntime(const VersionResolved& v, QString* outVersion = nullptr);
 
 private:
+    // Этапы install(); каждый в конце отмечается в журнале
+    void installAssets   (const VersionResolved& v, InstallJournal& journal);
+    void installLibraries(const VersionResolved& v, InstallJournal& journal);
+    void installClient   (const VersionResolved& v, InstallJournal& journal);
+
+    // Манифест того, что лежит в инстансе после установки v
+    InstallManifest buildManifest(const VersionResolved& v) const;
+
     MojangAPI& api_;
     QString gameDir_;
     QString cacheDir_; // общий кэш
+    FilePlacer placer_; // раскладка кэш -> инстанс (стратегия кэшируется по паре ФС)
+    QHash<QString, QString> trusted_; // на время install(): файлы из прошлого манифеста, целые по stat (путь -> sha1)
+    InstallObserver*             observer_ = nullptr;
+    std::shared_ptr<CancelToken> cancel_;
+
+    bool cancelled() const { return cancel_ && cancel_->cancelled(); }
+    void checkCancelled() const { if (cancel_) cancel_->throwIfCancelled(); }
 
     // --- пути внутри инстанса ---
     static QString assetsObjectsPath(const QString& base) { return joinPath(base, "assets/objects"); }
     static QString assetsIndexesPath(const QString& base) { return joinPath(base, "assets/indexes"); }
     static QString librariesPath    (const QString& base) { return joinPath(base, "libraries"); }
     static QString versionsPath     (const QString& base) { return joinPath(base, "versions"); }
-    static QString nativesPath      (const QString& base, const QString& id){ return joinPath(base, "versions/"+id+"/natives"); }
 
     // --- пути внутри кэша ---
     QString cacheAssetsObjects() const { return joinPath(cacheDir_, "assets/objects"); }
     QString cacheAssetsIndexes() const { return joinPath(cacheDir_, "assets/indexes"); }
     QString cacheLibraries     () const { return joinPath(cacheDir_, "libraries"); }
+    QString cacheVersions      () const { return joinPath(cacheDir_, "versions"); }
 
     // Лок. утилиты
     static QString defaultCacheDir();
-    static bool linkOrCopy(const QString& src, const QString& dst);
+    bool linkOrCopy(const QString& src, const QString& dst);
+
+    // Объект для раскладки из кэша в инстанс (instExists — в инстансе лежит невалидная копия)
+    struct PlacedObject { QString sha; bool instExists = false; };
+    // Разложить пачку объектов; с io_uring — одним batch'ем linkat, остаток — через FilePlacer
+    void placeObjects(const FilePlacer::ShardedDir& from, const FilePlacer::ShardedDir& to,
+                      const QVector<PlacedObject>& objs, bool useUring, InstallJournal* journal = nullptr);
+
+    // Распаковка natives-jar'ов в natDir (in-process, параллельно по jar'ам)
+    void extractNatives(const QStringList& jars, const QString& natDir) const;
 
-    // Быстрый fetch asset index с локальным кэшем
-    QJsonObject fetchAssetIndexCached(const QUrl& url) const;
+    // Быстрый fetch asset index с локальным кэшем; store = false — скачанный индекс не сохранять
+    QJsonObject fetchAssetIndexCached(const QUrl& url, bool store = true) const;
 };
@@ -0,0 +1,207 @@
+#include "IoBatch.h"
+#include <QThread>
+
+#ifdef USE_IO_URING
+#include <liburing.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct IoBatch::Private {
+    struct Job {
+        bool       write   = false;
+        bool       replace = false;
+        bool       fsync   = false;
+        int        sdir    = -1;
+        int        ddir    = -1;
+        QByteArray sname;
+        QByteArray dname;
+        QByteArray tmp;
+        QByteArray data;
+        int        err     = -1;   // -1 — не выполнялась
+    };
+    QVector<Job> jobs;
+
+    // сколько SQE занимает цепочка задачи
+    static unsigned sqesFor(const Job& j)
+    {
+        if (j.write) return j.fsync ? 5u : 4u;
+        return j.replace ? 2u : 1u;
+    }
+};
+
+IoBatch::IoBatch() : d(new Private) {}
+IoBatch::~IoBatch() = default;
+
+int IoBatch::size() const { return d->jobs.size(); }
+
+bool IoBatch::ok(int job) const
+{
+    return job >= 0 && job < d->jobs.size() && d->jobs[job].err == 0;
+}
+
+int IoBatch::error(int job) const
+{
+    return (job >= 0 && job < d->jobs.size()) ? d->jobs[job].err : -1;
+}
+
+static QByteArray uniqueTmp(const QByteArray& name, int job)
+{
+    // pid — кэш может быть общим у нескольких процессов, id потоков у них совпадают
+    return name + ".tesuto-tmp-" + QByteArray::number(QCoreApplication::applicationPid())
+                + "-" + QByteArray::number(quintptr(QThread::currentThreadId()), 16)
+                + "-" + QByteArray::number(job);
+}
+
+int IoBatch::addLink(int sdir, const QByteArray& sname, int ddir, const QByteArray& dname, bool replace)
+{
+    Private::Job j;
+    j.sdir = sdir; j.sname = sname;
+    j.ddir = ddir; j.dname = dname;
+    j.replace = replace;
+    if (replace) j.tmp = uniqueTmp(dname, d->jobs.size());
+    d->jobs.push_back(std::move(j));
+    return d->jobs.size() - 1;
+}
+
+int IoBatch::addWrite(int ddir, const QByteArray& dname, const QByteArray& data, bool fsync)
+{
+    Private::Job j;
+    j.write = true;
+    j.ddir  = ddir; j.dname = dname;
+    j.data  = data;
+    j.fsync = fsync;
+    j.tmp   = uniqueTmp(dname, d->jobs.size());
+    d->jobs.push_back(std::move(j));
+    return d->jobs.size() - 1;
+}
+
+#ifdef USE_IO_URING
+
+namespace {
+constexpr unsigned kRingDepth = 256; // SQE в одной пачке
+constexpr unsigned kFileSlots = 64;  // «прямые» дескрипторы: openat кладёт fd в слот, write/close берут его оттуда
+
+enum OpKind : quint64 { OpOpen = 1, OpWrite, OpFsync, OpClose, OpRename, OpLink };
+}
+
+bool IoBatch::available()
+{
+    static const bool ok = []{
+        if (qgetenv("TESUTO_IO_BACKEND").trimmed().toLower() == "pool") return false;
+        io_uring ring;
+        if (io_uring_queue_init(8, &ring, 0) < 0) return false;
+        bool all = false;
+        if (io_uring_probe* p = io_uring_get_probe_ring(&ring)) {
+            all = io_uring_opcode_supported(p, IORING_OP_OPENAT)
+               && io_uring_opcode_supported(p, IORING_OP_WRITE)
+               && io_uring_opcode_supported(p, IORING_OP_FSYNC)
+               && io_uring_opcode_supported(p, IORING_OP_CLOSE)
+               && io_uring_opcode_supported(p, IORING_OP_RENAMEAT)
+               && io_uring_opcode_supported(p, IORING_OP_LINKAT);
+            io_uring_free_probe(p);
+        }
+        io_uring_queue_exit(&ring);
+        return all;
+    }();
+    return ok;
+}
+
+bool IoBatch::run()
+{
+    io_uring ring;
+    if (io_uring_queue_init(kRingDepth, &ring, 0) < 0) return false;
+    const bool haveSlots = (io_uring_register_files_sparse(&ring, kFileSlots) == 0);
+
+    auto& jobs = d->jobs;
+    int next = 0;
+    while (next < jobs.size()) {
+        unsigned queued = 0;
+        unsigned slot   = 0;
+
+        // набираем пачку: не больше kRingDepth SQE и kFileSlots записей
+        while (next < jobs.size()) {
+            auto& j = jobs[next];
+            const unsigned need = Private::sqesFor(j);
+            if (queued + need > kRingDepth) break;
+            if (j.write && !haveSlots) { j.err = ENOTSUP; ++next; continue; }
+            if (j.write && slot >= kFileSlots) break;
+
+            const quint64 tag = quint64(next) << 8;
+            auto push = [&](OpKind k, bool linkNext) -> io_uring_sqe* {
+                io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+                io_uring_sqe_set_data64(sqe, tag | k);
+                if (linkNext) sqe->flags |= IOSQE_IO_LINK;
+                return sqe;
+            };
+
+            if (j.write) {
+                io_uring_sqe* sqe = push(OpOpen, true);
+                io_uring_prep_openat_direct(sqe, j.ddir, j.tmp.constData(),
+                                            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666, slot); // как QSaveFile: права режет umask
+                sqe = push(OpWrite, true);
+                io_uring_prep_write(sqe, int(slot), j.data.constData(), unsigned(j.data.size()), 0);
+                sqe->flags |= IOSQE_FIXED_FILE;
+                if (j.fsync) {
+                    sqe = push(OpFsync, true);
+                    io_uring_prep_fsync(sqe, int(slot), 0);
+                    sqe->flags |= IOSQE_FIXED_FILE;
+                }
+                sqe = push(OpClose, true);
+                io_uring_prep_close_direct(sqe, slot);
+                sqe = push(OpRename, false);
+                io_uring_prep_renameat(sqe, j.ddir, j.tmp.constData(), j.ddir, j.dname.constData(), 0);
+                ++slot;
+            } else {
+                const QByteArray& target = j.replace ? j.tmp : j.dname;
+                io_uring_sqe* sqe = push(OpLink, j.replace);
+                io_uring_prep_linkat(sqe, j.sdir, j.sname.constData(), j.ddir, target.constData(), 0);
+                if (j.replace) {
+                    sqe = push(OpRename, false);
+                    io_uring_prep_renameat(sqe, j.ddir, j.tmp.constData(), j.ddir, j.dname.constData(), 0);
+                }
+            }
+            j.err = 0;
+            queued += need;
+            ++next;
+        }
+
+        if (queued == 0) continue;
+        if (io_uring_submit_and_wait(&ring, queued) < 0) {
+            io_uring_queue_exit(&ring);
+            return false;
+        }
+
+        for (unsigned k = 0; k < queued; ++k) {
+            io_uring_cqe* cqe = nullptr;
+            if (io_uring_wait_cqe(&ring, &cqe) < 0) break;
+            const quint64 ud  = io_uring_cqe_get_data64(cqe);
+            const int     res = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+
+            auto& j = jobs[int(ud >> 8)];
+            int e = 0;
+            if (res < 0) e = -res;
+            else if ((ud & 0xff) == OpWrite && res != j.data.size()) e = EIO; // короткая запись рвёт цепочку
+            // первая «настоящая» ошибка важнее ECANCELED хвоста цепочки
+            if (e != 0 && (j.err == 0 || j.err == ECANCELED)) j.err = e;
+        }
+    }
+
+    io_uring_queue_exit(&ring);
+
+    // недописанные временные файлы не оставляем
+    for (auto& j : jobs) {
+        if (j.err != 0 && !j.tmp.isEmpty()) ::unlinkat(j.ddir, j.tmp.constData(), 0);
+        j.data.clear();
+    }
+    return true;
+}
+
+#else // !USE_IO_URING
+
+bool IoBatch::available() { return false; }
+bool IoBatch::run()       { return false; }
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+#include <QtCore>
+#include <memory>
+
+// Пакетный файловый ввод-вывод через io_uring (Linux, сборка с -DUSE_IO_URING=ON).
+// Задачи копятся в очереди и уходят в ядро пачками; каждая задача — цепочка связанных SQE
+// (openat -> write -> fsync -> close -> renameat, либо linkat [-> renameat]), итог по задаче — ok/errno.
+// Без io_uring available() == false, и вызывающий идёт обычным путём через пул потоков.
+class IoBatch {
+public:
+    // io_uring есть в сборке, ядро поддерживает нужные опкоды и не выключен через TESUTO_IO_BACKEND=pool
+    static bool available();
+
+    IoBatch();
+    ~IoBatch();
+    IoBatch(const IoBatch&) = delete;
+    IoBatch& operator=(const IoBatch&) = delete;
+
+    // linkat(sdir/sname -> ddir/dname); replace=true — под временным именем и затем renameat поверх dname
+    int addLink(int sdir, const QByteArray& sname, int ddir, const QByteArray& dname, bool replace);
+    // Атомарная запись: openat(tmp) -> write -> [fsync] -> close -> renameat(tmp -> dname)
+    int addWrite(int ddir, const QByteArray& dname, const QByteArray& data, bool fsync);
+
+    // Отправить всё накопленное и дождаться завершения. false — кольцо не поднялось (ни одна задача не выполнена)
+    bool run();
+
+    int  size() const;
+    bool ok(int job) const;
+    int  error(int job) const; // errno первой неудачной операции цепочки (0 — успех)
+
+private:
+    struct Private;
+    std::unique_ptr<Private> d;
+};
@@ -0,0 +1,292 @@
+#include "JavaRegistry.h"
+#include "CachePaths.h"
+#include "JavaUtil.h"
+#include "RuntimeStore.h"
+#include "Util.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+#ifdef Q_OS_WIN
+const char* kJavaExe = "java.exe";
+#else
+const char* kJavaExe = "java";
+#endif
+
+// "17.0.9" -> 17, "1.8.0_392" -> 8
+int majorFromVersion(const QString& v)
+{
+    const QStringList parts = v.split(QRegularExpression("[._+-]"), Qt::SkipEmptyParts);
+    if (parts.isEmpty()) return -1;
+    bool ok = false;
+    const int first = parts[0].toInt(&ok);
+    if (!ok) return -1;
+    if (first == 1 && parts.size() > 1) return parts[1].toInt();
+    return first;
+}
+
+// Файл `release` в корне JDK/JRE: KEY="value" построчно
+QHash<QString, QString> readRelease(const QString& home)
+{
+    QHash<QString, QString> kv;
+    QFile f(QDir(home).filePath("release"));
+    if (!f.open(QIODevice::ReadOnly)) return kv;
+    for (const QByteArray& raw : f.readAll().split('\n')) {
+        const int eq = raw.indexOf('=');
+        if (eq <= 0) continue;
+        QString val = QString::fromUtf8(raw.mid(eq + 1)).trimmed();
+        if (val.size() >= 2 && val.startsWith('"') && val.endsWith('"')) val = val.mid(1, val.size() - 2);
+        kv.insert(QString::fromUtf8(raw.left(eq)).trimmed(), val);
+    }
+    return kv;
+}
+
+// bin/java внутри каталога установки (без рекурсивного обхода)
+QString javaNear(const QString& base)
+{
+    for (const QString& rel : {QString("bin/"), QString("jre/bin/"), QString("Contents/Home/bin/")}) {
+        const QString cand = QDir(base).filePath(rel + kJavaExe);
+        if (JavaUtil::isExecutable(cand)) return cand;
+    }
+    return QString();
+}
+
+struct Candidate { QString java; int rank; };
+
+// Все места, где обычно лежат Java; только stat/readdir, без запуска процессов
+QVector<Candidate> collectCandidates()
+{
+    QVector<Candidate> out;
+    auto addJava = [&](const QString& p, int rank) { if (JavaUtil::isExecutable(p)) out.push_back({p, rank}); };
+    auto addHome = [&](const QString& home, int rank) {
+        const QString j = javaNear(home);
+        if (!j.isEmpty()) out.push_back({j, rank});
+    };
+    auto addChildren = [&](const QString& dir, int rank) {
+        const QDir d(dir);
+        if (!d.exists()) return;
+        for (const QString& sub : d.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+            addHome(d.filePath(sub), rank);
+    };
+
+    const QString jh = qEnvironmentVariable("JAVA_HOME");
+    if (!jh.isEmpty()) addHome(jh, 0);
+
+    const QString onPath = QStandardPaths::findExecutable(kJavaExe);
+    if (!onPath.isEmpty()) addJava(onPath, 1);
+
+    addChildren(RuntimeStore().root(), 2);
+
+    QSettings s;
+    const QString gameDir = s.value("paths/gameDir").toString();
+    if (!gameDir.isEmpty()) addChildren(QDir(gameDir).filePath("runtime"), 3);
+
+#ifdef Q_OS_LINUX
+    addChildren("/usr/lib/jvm", 4);
+    addChildren("/usr/local/lib/jvm", 4);
+    addChildren(QDir::homePath() + "/.sdkman/candidates/java", 4);
+    addJava("/usr/bin/java", 5);
+    addJava("/usr/local/bin/java", 5);
+#elif defined(Q_OS_MACOS)
+    addChildren("/Library/Java/JavaVirtualMachines", 4);
+#endif
+    return out;
+}
+
+// Описание установки без запуска процесса; major < 0 — release-файла нет, нужен `java -version`
+JavaRegistry::Install describe(const QString& canonicalJava, int rank)
+{
+    JavaRegistry::Install in;
+    in.java  = canonicalJava;
+    in.rank  = rank;
+    in.mtime = QFileInfo(canonicalJava).lastModified().toMSecsSinceEpoch();
+    QDir bin = QFileInfo(canonicalJava).dir();
+    bin.cdUp();
+    in.home = bin.absolutePath();
+    auto rel = readRelease(in.home);
+    if (rel.isEmpty() && in.home.endsWith("/jre")) rel = readRelease(QFileInfo(in.home).path()); // JDK 8: jre/bin/java
+    in.version = rel.value("JAVA_VERSION");
+    in.vendor  = rel.value("IMPLEMENTOR");
+    in.major   = majorFromVersion(in.version);
+    return in;
+}
+
+} // namespace
+
+JavaRegistry& JavaRegistry::instance()
+{
+    static JavaRegistry reg;
+    return reg;
+}
+
+QString JavaRegistry::registryPath()
+{
+    return joinPath(CachePaths::userRoot(), "java-registry.json");
+}
+
+void JavaRegistry::loadLocked()
+{
+    if (loaded_) return;
+    loaded_ = true;
+    QFile f(registryPath());
+    if (!f.open(QIODevice::ReadOnly)) return;
+    for (const auto& v : QJsonDocument::fromJson(f.readAll()).object().value("installs").toArray()) {
+        const QJsonObject o = v.toObject();
+        Install in;
+        in.java    = o.value("java").toString();
+        in.home    = o.value("home").toString();
+        in.major   = o.value("major").toInt(-1);
+        in.version = o.value("version").toString();
+        in.vendor  = o.value("vendor").toString();
+        in.mtime   = qint64(o.value("mtime").toDouble());
+        in.rank    = o.value("rank").toInt();
+        if (!in.java.isEmpty()) byPath_.insert(in.java, in);
+    }
+}
+
+void JavaRegistry::saveLocked() const
+{
+    QJsonArray arr;
+    for (const Install& in : byPath_) {
+        arr.append(QJsonObject{
+            {"java", in.java}, {"home", in.home}, {"major", in.major}, {"version", in.version},
+            {"vendor", in.vendor}, {"mtime", double(in.mtime)}, {"rank", in.rank},
+        });
+    }
+    ensureDir(QFileInfo(registryPath()).path());
+    QSaveFile f(registryPath());
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(QJsonDocument(QJsonObject{{"installs", arr}}).toJson(QJsonDocument::Compact));
+        f.commit();
+    }
+}
+
+QVector<JavaRegistry::Install> JavaRegistry::installs()
+{
+    QMutexLocker lk(&mx_);
+    loadLocked();
+    QVector<Install> out(byPath_.begin(), byPath_.end());
+    std::sort(out.begin(), out.end(), [](const Install& a, const Install& b) {
+        return a.rank != b.rank ? a.rank < b.rank : a.major > b.major;
+    });
+    return out;
+}
+
+std::optional<QString> JavaRegistry::best(int minMajor)
+{
+    auto pick = [&]() -> std::optional<QString> {
+        for (const Install& in : installs()) {
+            // запись могла устареть (JDK удалён/обновлён) — проверяем одним stat
+            const QFileInfo fi(in.java);
+            if (in.major >= minMajor && fi.isExecutable() && fi.lastModified().toMSecsSinceEpoch() == in.mtime)
+                return in.java;
+        }
+        return std::nullopt;
+    };
+
+    auto hit = pick();
+    if (hit) {
+        refreshAsync();
+        return hit;
+    }
+    // в кэше подходящей нет — сканируем сейчас
+    refresh();
+    return pick();
+}
+
+int JavaRegistry::majorOf(const QString& javaPath)
+{
+    const QString canon = QFileInfo(javaPath).canonicalFilePath();
+    if (canon.isEmpty()) return -1;
+    const qint64 mtime = QFileInfo(canon).lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker lk(&mx_);
+        loadLocked();
+        const auto it = byPath_.constFind(canon);
+        if (it != byPath_.constEnd() && it->mtime == mtime && it->major > 0) return it->major;
+    }
+    Install in = describe(canon, 9);
+    if (in.major < 0) in.major = JavaUtil::javaMajorVersion(canon);
+    if (in.major > 0) {
+        QMutexLocker lk(&mx_);
+        if (!byPath_.contains(canon)) { byPath_.insert(canon, in); saveLocked(); }
+    }
+    return in.major;
+}
+
+void JavaRegistry::refresh()
+{
+    QElapsedTimer timer; timer.start();
+
+    // кандидаты сводим к каноническим путям (/usr/bin/java -> /usr/lib/jvm/.../bin/java)
+    QHash<QString, int> cands;
+    for (const Candidate& c : collectCandidates()) {
+        const QString canon = QFileInfo(c.java).canonicalFilePath();
+        if (canon.isEmpty()) continue;
+        auto it = cands.find(canon);
+        if (it == cands.end()) cands.insert(canon, c.rank);
+        else *it = qMin(*it, c.rank);
+    }
+
+    QHash<QString, Install> known;
+    {
+        QMutexLocker lk(&mx_);
+        loadLocked();
+        known = byPath_;
+    }
+
+    QVector<Install> fresh;
+    QVector<Install> toProbe;
+    for (auto it = cands.cbegin(); it != cands.cend(); ++it) {
+        const qint64 mtime = QFileInfo(it.key()).lastModified().toMSecsSinceEpoch();
+        const auto k = known.constFind(it.key());
+        if (k != known.constEnd() && k->mtime == mtime && k->major > 0) {
+            Install in = *k;
+            in.rank = it.value();
+            fresh.push_back(in);
+            continue;
+        }
+        Install in = describe(it.key(), it.value());
+        if (in.major > 0) fresh.push_back(in);
+        else toProbe.push_back(in);
+    }
+
+    // без release-файла — `java -version`, но все разом
+    if (!toProbe.isEmpty()) {
+        QtConcurrent::blockingMap(toProbe, [](Install& in) {
+            in.major = JavaUtil::javaMajorVersion(in.java);
+        });
+        for (const Install& in : toProbe)
+            if (in.major > 0) fresh.push_back(in);
+    }
+
+    {
+        QMutexLocker lk(&mx_);
+        byPath_.clear();
+        for (const Install& in : fresh) byPath_.insert(in.java, in);
+        saveLocked();
+    }
+    qInfo().noquote() << QString("java registry: %1 install(s), %2 probed via `java -version`, %3 ms")
+                             .arg(fresh.size()).arg(toProbe.size()).arg(timer.elapsed());
+}
+
+void JavaRegistry::refreshAsync()
+{
+    {
+        QMutexLocker lk(&mx_);
+        if (refreshedOnce_) return;
+        refreshedOnce_ = true;
+    }
+    if (refreshing_.exchange(true)) return;
+    auto fut = QtConcurrent::run([this] {
+        refresh();
+        refreshing_.store(false);
+    });
+    Q_UNUSED(fut);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <QtCore>
+#include <atomic>
+#include <optional>
+
+// Реестр найденных Java. Кандидаты — JAVA_HOME, PATH, /usr/lib/jvm/*, стор рантаймов в кэше и т.п.;
+// версия берётся из файла `release` рядом с bin/ (без запуска процессов), `java -version`
+// запускается только для установок без него — параллельно. Результат хранится в
+// <cache>/java-registry.json с ключом (путь, mtime), так что обычный запуск читает готовый
+// список, а пересканирование идёт в фоне.
+class JavaRegistry {
+public:
+    struct Install {
+        QString java;          // канонический путь к bin/java
+        QString home;          // каталог JDK/JRE
+        int     major = -1;
+        QString version;       // полная версия (JAVA_VERSION или из `java -version`)
+        QString vendor;        // IMPLEMENTOR из release, если есть
+        qint64  mtime = 0;     // mtime bin/java — ключ актуальности записи
+        int     rank  = 0;     // приоритет источника (меньше — предпочтительнее)
+    };
+
+    static JavaRegistry& instance();
+
+    // Снимок известных установок (из памяти/файла реестра, без сканирования)
+    QVector<Install> installs();
+
+    // Лучшая Java с major >= minMajor. Пустой реестр — синхронное сканирование,
+    // иначе ответ из кэша и фоновое обновление (раз за процесс).
+    std::optional<QString> best(int minMajor);
+
+    // Major для конкретного java: из реестра, если path+mtime совпали, иначе release/`java -version`
+    int majorOf(const QString& javaPath);
+
+    // Полное пересканирование кандидатов (блокирующее)
+    void refresh();
+    // То же в пуле потоков; повторные вызовы, пока идёт сканирование, игнорируются
+    void refreshAsync();
+
+private:
+    JavaRegistry() = default;
+
+    void loadLocked();
+    void saveLocked() const;
+    static QString registryPath();
+
+    QMutex                  mx_;
+    QHash<QString, Install> byPath_;
+    bool                    loaded_ = false;
+    std::atomic_bool        refreshing_{false};
+    bool                    refreshedOnce_ = false;
+};
@@ -1,4 +1,5 @@
 #include "JavaUtil.h"
+#include "JavaRegistry.h"
 #include <QProcess>
 #include <QFileInfo>
 #include <QStandardPaths>
@@ -75,11 +76,8 @@ int javaMajorVersion(const QString& javaPath) {
 }
 
 std::optional<QString> detectJava(int minMajor) {
-    for (const auto& p : candidatesFromEnv()) {
-        if (javaMajorVersion(p) >= minMajor)
-            return p;
-    }
-    return std::nullopt;
+    // реестр отвечает из кэша (release-файлы/прошлые проверки) и сам обновляется в фоне
+    return JavaRegistry::instance().best(minMajor);
 }
 
 } // namespace JavaUtil
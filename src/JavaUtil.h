@@ -13,7 +13,7 @@ bool isExecutable(const QString& path);
 // Парсинг major из `java -version` (понимает и "1.8" как 8)
 int javaMajorVersion(const QString& javaPath);
 
-// Автодетект Java (минимум minMajor), вернёт пусто если не нашлось
+// Автодетект Java (минимум minMajor) через JavaRegistry, вернёт пусто если не нашлось
 std::optional<QString> detectJava(int minMajor = 17);
 
 } // namespace JavaUtil
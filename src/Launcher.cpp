@@ -18,6 +18,8 @@
 #include <QSettings>
 #include <QUrl>
 #include "Settings.h"
+#include "CachePaths.h"
+#include "JavaRegistry.h"
 #include <QStandardPaths>
 #include <QDirIterator>
 
@@ -138,74 +140,22 @@ static QString resolveJavaExecutable(const QString& configured, const QString& g
         }
     }
 
-    // 3) runtime/ у инстанса
+    // 3) runtime/ у инстанса: только типовые bin/java в подкаталогах, без рекурсивного обхода
     {
-        const QString rt = QDir(gameDir).filePath("runtime");
-        QString cand = findJavaNear(rt);
+        const QDir rt(QDir(gameDir).filePath("runtime"));
+        QString cand = findJavaNear(rt.path());
         if (!cand.isEmpty()) return cand;
-        cand = findJavaRecursive(rt);
-        if (!cand.isEmpty()) return cand;
-
-        const QStringList common = {
-            "java-21","jre-21","temurin-21","jdk-21",
-            "java-17","jre-17","temurin-17","jdk-17"
-        };
-        for (const auto& sub : common) {
-            cand = findJavaNear(QDir(rt).filePath(sub));
-            if (!cand.isEmpty()) return cand;
-            cand = findJavaRecursive(QDir(rt).filePath(sub));
-            if (!cand.isEmpty()) return cand;
-        }
-    }
-
-    // 4) JAVA_HOME
-    {
-        const QByteArray jh = qgetenv("JAVA_HOME");
-        if (!jh.isEmpty()) {
-            const QString j = QString::fromLocal8Bit(jh);
-            QString cand = findJavaNear(j);
-            if (!cand.isEmpty()) return cand;
-            cand = findJavaRecursive(j);
-            if (!cand.isEmpty()) return cand;
-        }
-    }
-
-    // 5) PATH
-#ifdef Q_OS_WIN
-    {
-        const QString cand = QStandardPaths::findExecutable("java.exe");
-        QString why;
-        if (!cand.isEmpty() && ensureExecutableFile(cand, &why)) return cand;
-    }
-#else
-    {
-        const QString cand = QStandardPaths::findExecutable("java");
-        QString why;
-        if (!cand.isEmpty() && ensureExecutableFile(cand, &why)) return cand;
-    }
-#endif
-
-#ifndef Q_OS_WIN
-    // 6) /usr/lib/jvm/**/bin/java
-    {
-        QDir jvms("/usr/lib/jvm");
-        if (jvms.exists()) {
-            const auto entries = jvms.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-            for (const auto& sub : entries) {
-                const QString base = jvms.filePath(sub);
-                QString cand = findJavaNear(base);
-                if (!cand.isEmpty()) return cand;
-                cand = findJavaRecursive(base);
+        if (rt.exists()) {
+            for (const auto& sub : rt.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::Reversed)) {
+                cand = findJavaNear(rt.filePath(sub));
                 if (!cand.isEmpty()) return cand;
             }
         }
     }
-    // 7) /usr/bin/java
-    {
-        QString why;
-        if (ensureExecutableFile("/usr/bin/java", &why)) return "/usr/bin/java";
-    }
-#endif
+
+    // 4) JAVA_HOME, PATH, стор рантаймов, /usr/lib/jvm/* — из реестра (готовый список, без процессов)
+    if (auto reg = JavaRegistry::instance().best(8); reg.has_value())
+        return reg.value();
 
     return {}; // совсем не нашли
 }
@@ -245,6 +195,10 @@ QString Launcher::assetIndexIdFromUrl(const QUrl& url)
 
 QString Launcher::nativesDirFor(const VersionResolved& v) const
 {
+    // общий кэш natives (распакованы один раз на версию/arch); старые установки — внутри инстанса
+    const QString shared = CachePaths::nativesDirFor(v, cacheDir_);
+    if (QFileInfo::exists(CachePaths::nativesCompleteMarker(shared)))
+        return shared;
     return joinPath(versionsPath(gameDir_), v.id + "/natives");
 }
 
@@ -7,8 +7,9 @@ struct LoaderPatch;
 
 class Launcher {
 public:
-    explicit Launcher(QString gameDir, QString javaPath)
-        : gameDir_(std::move(gameDir)), java_(std::move(javaPath)) {}
+    // cacheDir — тот же корень кэша, что у Installer (там лежат общие natives); пусто — CachePaths::root()
+    explicit Launcher(QString gameDir, QString javaPath, QString cacheDir = QString())
+        : gameDir_(std::move(gameDir)), java_(std::move(javaPath)), cacheDir_(std::move(cacheDir)) {}
 
     void setJavaPath(const QString& p)  { java_   = p; }
     void setGameDir (const QString& gd) { gameDir_ = gd; }
@@ -45,4 +46,5 @@ private:
 private:
     QString gameDir_;
     QString java_;
+    QString cacheDir_;
 };
@@ -1,6 +1,13 @@
 #include "ModLoader.h"
 #include "Net.h"
 #include "Util.h"
+#include "CancelToken.h"
+#include "InstallObserver.h"
+#include "InstallManifest.h"
+#include "CachePaths.h"
+#include "CacheLock.h"
+#include "SingleFlight.h"
+#include "FirstError.h"
 
 #include <QDir>
 #include <QFile>
@@ -13,13 +20,20 @@
 #include <QNetworkReply>
 #include <QEventLoop>
 #include <QSslConfiguration>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <atomic>
 #include <stdexcept>
 
 // ─────────────────────────────────────────────
 // Вспомогательные HTTP (синхронно, чтобы не трогать Net)
 // ─────────────────────────────────────────────
-static QByteArray httpGet(const QUrl& url, int timeoutMs = 60000)
+static QByteArray httpGet(const QUrl& url, int timeoutMs = 60000,
+                          const std::shared_ptr<CancelToken>& cancel = {})
 {
+    if (cancel) cancel->throwIfCancelled();
     QNetworkAccessManager nam;
     QNetworkRequest req(url);
     req.setHeader(QNetworkRequest::UserAgentHeader, "tesuto-launcher/1.0");
@@ -32,6 +46,7 @@ static QByteArray httpGet(const QUrl& url, int timeoutMs = 60000)
     QEventLoop loop;
     QNetworkReply* rep = nam.get(req);
     QObject::connect(rep, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+    CancelToken::Watch watch(cancel, rep);
 
     if (timeoutMs > 0) {
         QTimer timer;
@@ -46,6 +61,8 @@ static QByteArray httpGet(const QUrl& url, int timeoutMs = 60000)
         loop.exec();
     }
 
+    if (cancel && cancel->cancelled())
+        throw InstallCancelled();
     if (rep->error() != QNetworkReply::NoError)
         throw std::runtime_error(QString("HTTP GET failed: %1 (%2)")
                                  .arg(url.toString(), rep->errorString()).toStdString());
@@ -55,14 +72,56 @@ static QByteArray httpGet(const QUrl& url, int timeoutMs = 60000)
     return data;
 }
 
-static void httpDownloadToFile(const QUrl& url, const QString& filePath, int timeoutMs = 60000)
+// Хэш файла на диске (пусто — файла нет)
+static QString hashFile(const QString& path, QCryptographicHash::Algorithm algo)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return {};
+    QCryptographicHash h(algo);
+    if (!h.addData(&f)) return {};
+    return QString::fromLatin1(h.result().toHex());
+}
+
+// Контрольная сумма из maven-сайдкара: первое слово файла (бывает «<hex>  <имя>»)
+static QString parseSidecar(const QByteArray& body, int hexLen)
+{
+    const QString text = QString::fromLatin1(body).trimmed();
+    const QString word = text.section(QRegularExpression("\\s+"), 0, 0).toLower();
+    static const QRegularExpression hex("^[0-9a-f]+$");
+    return (word.size() == hexLen && hex.match(word).hasMatch()) ? word : QString();
+}
+
+static QString fetchSidecar(Net& net, const QUrl& url, int hexLen)
+{
+    try {
+        return parseSidecar(net.getBytes(url, 15000), hexLen);
+    } catch (const InstallCancelled&) {
+        throw;
+    } catch (const std::exception&) {
+        // нет сайдкара (404) — попробуем другой алгоритм
+    }
+    return {};
+}
+
+// Сайдкар рядом с jar'ом в кэше (кладём его сами после проверки)
+static QString readSidecar(const QString& path, int hexLen)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return {};
+    return parseSidecar(f.read(256), hexLen);
+}
+
+// Атомарная запись: временный файл + rename, полузаписанный jar под настоящим именем не появляется
+static void saveFileAtomic(const QString& filePath, const QByteArray& data)
 {
-    QByteArray data = httpGet(url, timeoutMs);
     QDir().mkpath(QFileInfo(filePath).path());
     QSaveFile f(filePath);
     if (!f.open(QIODevice::WriteOnly))
         throw std::runtime_error(QString("Cannot open file for write: %1").arg(filePath).toStdString());
-    f.write(data);
+    if (f.write(data) != data.size()) {
+        f.cancelWriting();
+        throw std::runtime_error(QString("Cannot write file: %1").arg(filePath).toStdString());
+    }
     if (!f.commit())
         throw std::runtime_error(QString("Cannot commit file: %1").arg(filePath).toStdString());
 }
@@ -73,6 +132,13 @@ static void httpDownloadToFile(const QUrl& url, const QString& filePath, int tim
 // ModloaderInstaller — общие хелперы
 // ─────────────────────────────────────────────
 
+ModloaderInstaller::ModloaderInstaller(Net& net, QString gameDir, QString cacheDir)
+    : net_(net)
+    , gameDir_(std::move(gameDir))
+    , cacheDir_(cacheDir.isEmpty() ? CachePaths::root() : std::move(cacheDir))
+{
+}
+
 QString ModloaderInstaller::librariesDir() const {
     return joinPath(gameDir_, "libraries");
 }
@@ -88,18 +154,81 @@ QString ModloaderInstaller::mavenPathFromName(const QString& name) {
     return QString("%1/%2/%3/%2-%3.jar").arg(group, artifact, version);
 }
 
-QString ModloaderInstaller::ensureJar(const QString& baseUrl, const QString& name) {
-    const QString rel = mavenPathFromName(name);
-    if (rel.isEmpty())
-        throw std::runtime_error(QString("Invalid maven name: %1").arg(name).toStdString());
+void ModloaderInstaller::ensureJar(Net& net, const LoaderLib& lib) {
+    const QString abs    = QDir(librariesDir()).filePath(lib.rel);
+    const QString cached = joinPath(joinPath(cacheDir_, "libraries"), lib.rel);
+
+    // ожидаемый хэш: из профиля, иначе сайдкар в кэше, иначе maven-сайдкар .sha1 / .sha256
+    QString want = lib.sha1.toLower();
+    QCryptographicHash::Algorithm algo = QCryptographicHash::Sha1;
+    if (want.isEmpty() && !lib.sha256.isEmpty()) {
+        want = lib.sha256.toLower();
+        algo = QCryptographicHash::Sha256;
+    }
+    bool localSidecar = false;
+    if (want.isEmpty()) {
+        if (!(want = readSidecar(cached + ".sha1", 40)).isEmpty()) {
+            localSidecar = true;
+        } else if (!(want = readSidecar(cached + ".sha256", 64)).isEmpty()) {
+            algo = QCryptographicHash::Sha256;
+            localSidecar = true;
+        }
+    }
+    if (want.isEmpty()) want = fetchSidecar(net, QUrl(lib.url.toString() + ".sha1"), 40);
+    if (want.isEmpty()) {
+        want = fetchSidecar(net, QUrl(lib.url.toString() + ".sha256"), 64);
+        if (!want.isEmpty()) algo = QCryptographicHash::Sha256;
+    }
+    const QString sidecar = cached + (algo == QCryptographicHash::Sha1 ? ".sha1" : ".sha256");
+
+    // без хэша верим лишь тому, что файл есть (и предупреждаем); иначе — только проверенному
+    auto valid = [&](const QString& path) {
+        if (!QFileInfo::exists(path)) return false;
+        return want.isEmpty() || hashFile(path, algo) == want;
+    };
+    if (want.isEmpty())
+        qWarning().noquote() << "loader lib" << lib.rel << "has no checksum, it is not verified";
+
+    // уже разложен (обрывок прошлой загрузки не пройдёт проверку и будет заменён)
+    if (valid(abs)) return;
+
+    // кэш: та же схема, что у ванильных библиотек — одна загрузка на процесс, запись под шард-локом
+    // с перепроверкой; ключ общий с Installer
+    SingleFlight::instance().fetchToCache(cacheDir_, "libraries/" + lib.rel, cached,
+        [&] { return valid(cached); },
+        [&] {
+            const QByteArray data = net.getBytes(lib.url, 60000);
+            if (!want.isEmpty()) {
+                const QString got = QString::fromLatin1(QCryptographicHash::hash(data, algo).toHex());
+                if (got != want)
+                    throw std::runtime_error(QString("Checksum mismatch for %1: expected %2, got %3")
+                                             .arg(lib.url.toString(), want, got).toStdString());
+            }
+            return data;
+        });
+    // хэш рядом с проверенным jar'ом: следующая установка обходится без сети
+    if (!want.isEmpty() && !localSidecar)
+        saveFileAtomic(sidecar, want.toLatin1());
 
-    const QString abs = QDir(librariesDir()).filePath(rel);
-    if (QFile::exists(abs))
-        return rel;
+    if (!placer_.place(cached, abs))
+        throw std::runtime_error(("Cannot place loader lib to instance " + lib.rel).toStdString());
+}
 
-    const QUrl url(QString("%1/%2").arg(baseUrl, rel));
-    httpDownloadToFile(url, abs, 60000);
-    return rel;
+void ModloaderInstaller::saveLoaderManifest(const QString& id, const QVector<LoaderLib>& plan) const {
+    // по нему библиотеки лоадера видят сборщик мусора кэша (ссылки и при раскладке копией),
+    // фоновая проверка и «Проверить и починить»; sha1 нужен и тем, у кого в профиле только sha256
+    const QHash<QString, QString> known =
+        InstallManifest::load(gameDir_, InstallManifest::Part::Loader).validOnDisk(gameDir_);
+    InstallManifest m;
+    m.versionId = id;
+    for (const LoaderLib& lib : plan) {
+        const QString rel = "libraries/" + lib.rel;
+        QString sha1 = lib.sha1.toLower();
+        if (sha1.isEmpty()) sha1 = known.value(rel);
+        if (sha1.isEmpty()) sha1 = hashFile(joinPath(gameDir_, rel), QCryptographicHash::Sha1);
+        if (m.add(gameDir_, rel, sha1)) m.files[rel].url = lib.url.toString();
+    }
+    m.save(gameDir_, InstallManifest::Part::Loader);
 }
 
 LoaderPatch ModloaderInstaller::installFromProfileJson(const QJsonObject& profile) {
@@ -108,8 +237,10 @@ LoaderPatch ModloaderInstaller::installFromProfileJson(const QJsonObject& profil
     // mainClass
     patch.mainClass = profile.value("mainClass").toString();
 
-    // libraries
+    // libraries: план по профилю (порядок classpath сохраняем), затем одна параллельная волна загрузок
     const auto libs = profile.value("libraries").toArray();
+    QVector<LoaderLib> plan;
+    plan.reserve(libs.size());
     for (const auto& v : libs) {
         const auto obj = v.toObject();
         const QString name = obj.value("name").toString();
@@ -124,12 +255,44 @@ LoaderPatch ModloaderInstaller::installFromProfileJson(const QJsonObject& profil
             else
                 url = "https://libraries.minecraft.net";
         }
+        if (url.endsWith('/')) url.chop(1);
 
-        // тянем jar (если нужно) и добавляем в CP (относительный путь от libraries)
-        const QString rel = ensureJar(url, name);
+        const QString rel = mavenPathFromName(name);
+        if (rel.isEmpty())
+            throw std::runtime_error(QString("Invalid maven name: %1").arg(name).toStdString());
+
+        // относительный путь от libraries — в CP
         patch.classpath << rel;
+        plan.push_back(LoaderLib{name, rel, QUrl(QString("%1/%2").arg(url, rel)),
+                                 obj.value("sha1").toString(), obj.value("sha256").toString()});
     }
 
+    const int threads = qEnvironmentVariableIntValue("TESUTO_DL_THREADS") > 0
+                        ? qgetenv("TESUTO_DL_THREADS").toInt()
+                        : 8;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, threads));
+
+    // пока раскладываем, сборщик мусора кэш не трогает
+    CacheLock cacheInUse(CacheLock::wholeFile(cacheDir_), CacheLock::Mode::Shared);
+
+    ProgressMeter meter(observer_, "loader", plan.size(), 0); // размеров в профиле нет
+    // как и в Installer: исключения из задач QtConcurrent не выпускаем, собираем первую ошибку
+    FirstError err;
+    QtConcurrent::blockingMap(&pool, plan, [&](const LoaderLib& lib) {
+        if (err.failed() || (cancel_ && cancel_->cancelled())) return;
+        err.guard([&] {
+            // отдельный Net на поток (QNetworkAccessManager не потокобезопасен)
+            Net net;
+            net.setCancelToken(cancel_);
+            ensureJar(net, lib);
+            meter.add(1, QFileInfo(QDir(librariesDir()).filePath(lib.rel)).size());
+        });
+    });
+    if (cancel_) cancel_->throwIfCancelled();
+    err.throwIfFailed("Loader libraries install failed: ");
+    saveLoaderManifest(profile.value("id").toString(), plan);
+
     // jvm args (берём только простые строки)
     const auto args = profile.value("arguments").toObject().value("jvm").toArray();
     for (const auto& a : args) {
@@ -151,7 +314,7 @@ QJsonObject ModloaderInstaller::fetchFabricProfileJson(const QString& mcVersion,
     if (loader.isEmpty() || loader == "latest") {
         // выберем последнюю стабильную
         const QUrl listUrl(QString("https://meta.fabricmc.net/v2/versions/loader/%1").arg(mcVersion));
-        const auto arr = QJsonDocument::fromJson(httpGet(listUrl)).array();
+        const auto arr = QJsonDocument::fromJson(httpGet(listUrl, 60000, cancel_)).array();
         if (arr.isEmpty())
             throw std::runtime_error("Fabric: no loader versions for this MC");
         // ищем stable, иначе берём первую
@@ -169,7 +332,7 @@ QJsonObject ModloaderInstaller::fetchFabricProfileJson(const QString& mcVersion,
 
     const QUrl profUrl(QString("https://meta.fabricmc.net/v2/versions/loader/%1/%2/profile/json")
                        .arg(mcVersion, loader));
-    const auto doc = QJsonDocument::fromJson(httpGet(profUrl));
+    const auto doc = QJsonDocument::fromJson(httpGet(profUrl, 60000, cancel_));
     if (!doc.isObject())
         throw std::runtime_error("Fabric: invalid profile json");
     return doc.object();
@@ -194,7 +357,7 @@ QJsonObject ModloaderInstaller::fetchQuiltProfileJson(const QString& mcVersion,
     if (loader.isEmpty() || loader == "latest") {
         // meta Quilt: берём первую стабильную
         const QUrl listUrl(QString("https://meta.quiltmc.org/v3/versions/loader/%1").arg(mcVersion));
-        const auto arr = QJsonDocument::fromJson(httpGet(listUrl)).array();
+        const auto arr = QJsonDocument::fromJson(httpGet(listUrl, 60000, cancel_)).array();
         if (arr.isEmpty())
             throw std::runtime_error("Quilt: no loader versions for this MC");
         QString picked;
@@ -211,7 +374,7 @@ QJsonObject ModloaderInstaller::fetchQuiltProfileJson(const QString& mcVersion,
 
     const QUrl profUrl(QString("https://meta.quiltmc.org/v3/versions/loader/%1/%2/profile/json")
                        .arg(mcVersion, loader));
-    const auto doc = QJsonDocument::fromJson(httpGet(profUrl));
+    const auto doc = QJsonDocument::fromJson(httpGet(profUrl, 60000, cancel_));
     if (!doc.isObject())
         throw std::runtime_error("Quilt: invalid profile json");
     return doc.object();
@@ -3,8 +3,14 @@
 #include <QString>
 #include <QStringList>
 #include <QJsonObject>
+#include <QUrl>
+#include <QVector>
+#include <memory>
+#include "FilePlacer.h"
 
 class Net;
+class CancelToken;
+class InstallObserver;
 
 // Патч для лаунча
 struct LoaderPatch {
@@ -15,8 +21,9 @@ struct LoaderPatch {
 
 class ModloaderInstaller {
 public:
-    ModloaderInstaller(Net& net, QString gameDir)
-        : net_(net), gameDir_(std::move(gameDir)) {}
+    // cacheDir — общий кэш Installer (пусто — CachePaths::root()): библиотеки лоадера лежат там же,
+    // где и ванильные (<cache>/libraries/<maven>), и раскладываются в инстанс через FilePlacer
+    ModloaderInstaller(Net& net, QString gameDir, QString cacheDir = QString());
 
     LoaderPatch installFabric(const QString& mcVersion, const QString& loaderVersion);
     LoaderPatch installQuilt (const QString& mcVersion, const QString& loaderVersion);
@@ -24,10 +31,28 @@ public:
     LoaderPatch installForge   (const QString& /*mcVersion*/, const QString& /*loaderVersion*/);
     LoaderPatch installNeoForge(const QString& /*mcVersion*/, const QString& /*loaderVersion*/);
 
+    // Ход установки (этап "loader": библиотеки сделано/всего) и отмена — как у Installer
+    void setObserver(InstallObserver* obs) { observer_ = obs; }
+    void setCancelToken(std::shared_ptr<CancelToken> token) { cancel_ = std::move(token); }
+
 private:
+    // Библиотека из профиля лоадера. sha1/sha256 — из профиля, если он их даёт; иначе берутся
+    // из maven-сайдкаров <jar>.sha1 / <jar>.sha256
+    struct LoaderLib {
+        QString name;
+        QString rel;      // maven-путь относительно libraries
+        QUrl    url;
+        QString sha1;
+        QString sha256;
+    };
+
     QString librariesDir() const;
     static QString mavenPathFromName(const QString& name);
-    QString ensureJar(const QString& baseUrl, const QString& name);
+    // Проверить jar в инстансе, иначе взять из кэша (скачав туда при необходимости) и разложить.
+    // Вызывается параллельно, net — свой у каждого потока
+    void ensureJar(Net& net, const LoaderLib& lib);
+    // <instance>/.tesuto_loader_manifest.json по разложенным библиотекам
+    void saveLoaderManifest(const QString& id, const QVector<LoaderLib>& plan) const;
     LoaderPatch installFromProfileJson(const QJsonObject& profile);
 
     QJsonObject fetchFabricProfileJson(const QString& mcVersion, const QString& loaderVersion);
@@ -36,4 +61,8 @@ private:
 private:
     Net&    net_;
     QString gameDir_;
+    QString cacheDir_;
+    FilePlacer placer_; // стратегия раскладки кэшируется по паре ФС на весь процесс — общая с Installer
+    InstallObserver*             observer_ = nullptr;
+    std::shared_ptr<CancelToken> cancel_;
 };
@@ -67,6 +67,10 @@ VersionResolved MojangAPI::resolveVersion(const VersionRef& ref) {
     r.assetIndexId  = assetsObj.value("id").toString();
     r.assetIndexUrl = QUrl(assetsObj.value("url").toString());
 
+    const auto javaObj = vjson.value("javaVersion").toObject();
+    r.javaComponent = javaObj.value("component").toString();
+    r.javaMajor     = javaObj.value("majorVersion").toInt();
+
     const auto downloads = vjson.value("downloads").toObject();
     const auto client    = downloads.value("client").toObject();
     r.clientJarUrl       = QUrl(client.value("url").toString());
@@ -81,6 +85,7 @@ VersionResolved MojangAPI::resolveVersion(const VersionRef& ref) {
             LibEntry e;
             e.url  = QUrl(art.value("url").toString());
             e.sha1 = art.value("sha1").toString();
+            e.size = qint64(art.value("size").toDouble());
             e.path = art.value("path").toString();
             if (e.path.isEmpty()) e.path = mavenPathFromName(lo.value("name").toString());
             e.isNative = false;
@@ -103,6 +108,7 @@ VersionResolved MojangAPI::resolveVersion(const VersionRef& ref) {
                 LibEntry n;
                 n.url  = QUrl(cl.value("url").toString());
                 n.sha1 = cl.value("sha1").toString();
+                n.size = qint64(cl.value("size").toDouble());
                 n.path = cl.value("path").toString();
                 if (n.path.isEmpty()) n.path = mavenPathFromName(lo.value("name").toString());
                 n.isNative = true;
@@ -134,6 +140,10 @@ VersionResolved MojangAPI::resolveVersion(const QString& versionId) {
     r.assetIndexId  = assetsObj.value("id").toString();
     r.assetIndexUrl = QUrl(assetsObj.value("url").toString());
 
+    const auto javaObj = vjson.value("javaVersion").toObject();
+    r.javaComponent = javaObj.value("component").toString();
+    r.javaMajor     = javaObj.value("majorVersion").toInt();
+
     const auto downloads = vjson.value("downloads").toObject();
     const auto client    = downloads.value("client").toObject();
     r.clientJarUrl       = QUrl(client.value("url").toString());
@@ -147,6 +157,7 @@ VersionResolved MojangAPI::resolveVersion(const QString& versionId) {
             LibEntry e;
             e.url  = QUrl(art.value("url").toString());
             e.sha1 = art.value("sha1").toString();
+            e.size = qint64(art.value("size").toDouble());
             e.path = art.value("path").toString();
             if (e.path.isEmpty()) e.path = mavenPathFromName(lo.value("name").toString());
             e.isNative = false;
@@ -8,6 +8,7 @@ struct LibEntry {
     QString  path;     // относительный maven-путь (group/artifact/version/artifact-version.jar)
     QUrl     url;      // прямой URL (если дан)
     QString  sha1;     // sha1 (если дан)
+    qint64   size = 0; // размер в байтах (если дан)
     bool     isNative = false; // true, если это natives-jar (редко нужен для нашего простого запуска)
 };
 
@@ -27,6 +28,10 @@ struct VersionResolved {
 
     QUrl    clientJarUrl;
     QList<LibEntry> libraries;
+
+    // javaVersion из version.json: компонент Mojang java-runtime и требуемый major
+    QString javaComponent;
+    int     javaMajor = 0;
 };
 
 class MojangAPI {
@@ -39,6 +44,7 @@ public:
     VersionResolved    resolveVersion(const QString& versionId);
 
     Downloader& dl() { return downloader_; }
+    Net&        net() { return net_; }
 
 private:
     Net&        net_;
@@ -26,7 +26,16 @@ static void applyHeaders(QNetworkRequest& req, const Net::HeaderList& h) {
     for (const auto& kv : h) req.setRawHeader(kv.first, kv.second);
 }
 
+// Ответ оборвал CancelToken — наружу InstallCancelled, а не «GET failed»
+static void throwIfCancelled(const std::shared_ptr<CancelToken>& t, QNetworkReply* rep) {
+    if (t && t->cancelled()) {
+        rep->deleteLater();
+        throw InstallCancelled();
+    }
+}
+
 QByteArray Net::getBytes(const QUrl& url, int timeoutMs, const HeaderList& headers) {
+    if (cancel_) cancel_->throwIfCancelled();
     QNetworkRequest req(url);
     applyHeaders(req, headers);
     QNetworkReply* rep = nam_.get(req);
@@ -35,7 +44,11 @@ QByteArray Net::getBytes(const QUrl& url, int timeoutMs, const HeaderList& heade
     QObject::connect(&timer, &QTimer::timeout, &loop, [&]{ rep->abort(); });
     QObject::connect(rep, &QNetworkReply::finished, &loop, &QEventLoop::quit);
     timer.start(timeoutMs);
-    loop.exec();
+    {
+        CancelToken::Watch watch(cancel_, rep);
+        loop.exec();
+    }
+    throwIfCancelled(cancel_, rep);
 
     if (rep->error() != QNetworkReply::NoError) {
         rep->deleteLater();
@@ -47,6 +60,47 @@ QByteArray Net::getBytes(const QUrl& url, int timeoutMs, const HeaderList& heade
     return out;
 }
 
+void Net::getStream(const QUrl& url, const ChunkFn& onChunk, int timeoutMs, const HeaderList& headers) {
+    if (cancel_) cancel_->throwIfCancelled();
+    QNetworkRequest req(url);
+    applyHeaders(req, headers);
+    QNetworkReply* rep = nam_.get(req);
+
+    QEventLoop loop; QTimer timer; timer.setSingleShot(true);
+    bool timedOut = false, rejected = false;
+    QObject::connect(&timer, &QTimer::timeout, &loop, [&]{ timedOut = true; rep->abort(); });
+    QObject::connect(rep, &QNetworkReply::readyRead, &loop, [&]{
+        timer.start(timeoutMs);
+        // тело редиректа (3xx) потребителю не отдаём
+        const int st = rep->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (st >= 300 && st < 400) { rep->readAll(); return; }
+        const QByteArray chunk = rep->readAll();
+        if (!rejected && !chunk.isEmpty() && !onChunk(chunk)) { rejected = true; rep->abort(); }
+    });
+    QObject::connect(rep, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+    timer.start(timeoutMs);
+    {
+        CancelToken::Watch watch(cancel_, rep);
+        loop.exec();
+    }
+    throwIfCancelled(cancel_, rep);
+
+    const int httpStatus = rep->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const bool ok = !rejected && rep->error() == QNetworkReply::NoError;
+    // хвост, пришедший вместе с finished
+    const QByteArray tail = ok ? rep->readAll() : QByteArray();
+    rep->deleteLater();
+
+    if (rejected)
+        throw std::runtime_error(("GET aborted by consumer: " + url.toString()).toStdString());
+    if (!ok)
+        throw std::runtime_error(QString("GET failed: %1 (HTTP %2%3)")
+                                     .arg(url.toString()).arg(httpStatus)
+                                     .arg(timedOut ? ", timeout" : "").toStdString());
+    if (!tail.isEmpty() && !onChunk(tail))
+        throw std::runtime_error(("GET aborted by consumer: " + url.toString()).toStdString());
+}
+
 QJsonObject Net::getJson(const QUrl& url, int timeoutMs, const HeaderList& headers) {
     const auto data = getBytes(url, timeoutMs, headers);
     const auto doc = QJsonDocument::fromJson(data);
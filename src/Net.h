@@ -4,6 +4,9 @@
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QUrlQuery>
+#include <functional>
+#include <memory>
+#include "CancelToken.h"
 
 class Net : public QObject {
     Q_OBJECT
@@ -15,6 +18,9 @@ public:
 
     void setConcurrency(int n);
 
+    // Отмена: ждущий запрос прерывается сразу и бросает InstallCancelled, новые не начинаются
+    void setCancelToken(std::shared_ptr<CancelToken> token) { cancel_ = std::move(token); }
+
     QJsonObject getJson(const QUrl& url, int timeoutMs = 20000,
                         const HeaderList& headers = HeaderList());
 
@@ -36,7 +42,15 @@ public:
     QByteArray getBytes(const QUrl& url, int timeoutMs = 20000,
                         const HeaderList& headers = HeaderList());
 
+    // Потоковый GET: тело отдаётся кусками в onChunk по мере прихода (без накопления в памяти).
+    // timeoutMs — таймаут простоя (сбрасывается на каждом куске), а не всей загрузки.
+    // onChunk вернул false — загрузка прерывается и getStream бросает исключение.
+    using ChunkFn = std::function<bool(const QByteArray&)>;
+    void getStream(const QUrl& url, const ChunkFn& onChunk, int timeoutMs = 30000,
+                   const HeaderList& headers = HeaderList());
+
 private:
     QNetworkAccessManager nam_;
     int concurrency_ = 2;
+    std::shared_ptr<CancelToken> cancel_;
 };
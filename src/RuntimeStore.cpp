@@ -0,0 +1,472 @@
+#include "RuntimeStore.h"
+#include "CacheLock.h"
+#include "CachePaths.h"
+#include "Downloader.h"
+#include "FilePlacer.h"
+#include "FirstError.h"
+#include "Net.h"
+#include "SingleFlight.h"
+#include "TarGzExtractor.h"
+#include "Util.h"
+#include <QCollator>
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSettings>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+const char* kMarker = ".tesuto_runtime.json";
+
+// как часто при наличии локального Temurin спрашивать Adoptium о новом build
+constexpr qint64 kTemurinCheckMs = 24 * 3600 * 1000;
+
+QString adoptiumArch()
+{
+#if defined(Q_PROCESSOR_X86_64)
+    return "x64";
+#elif defined(Q_PROCESSOR_ARM_64)
+    return "aarch64";
+#else
+    return "x64";
+#endif
+}
+
+// '+' и прочее из semver в имени каталога допустимы, но '/' и пробелы — нет
+QString safeComponent(QString s)
+{
+    for (QChar& c : s)
+        if (!(c.isLetterOrNumber() || c == '.' || c == '+' || c == '-' || c == '_')) c = '_';
+    return s;
+}
+
+} // namespace
+
+RuntimeStore::RuntimeStore(QString cacheRoot)
+    : root_(joinPath(CachePaths::execRoot(cacheRoot), "runtimes"))
+{
+    ensureDir(root_);
+}
+
+QString RuntimeStore::javaIn(const QString& runtimeDir)
+{
+    if (!QFileInfo::exists(QDir(runtimeDir).filePath(kMarker))) return QString();
+    const QString java = QDir(runtimeDir).filePath("bin/java");
+    return QFileInfo(java).isExecutable() ? java : QString();
+}
+
+QString RuntimeStore::newestLocal(const QString& prefix, const QString& suffix, QString* outVersion) const
+{
+    QStringList names = QDir(root_).entryList({prefix + "*" + suffix}, QDir::Dirs | QDir::NoDotAndDotDot);
+    QCollator coll;
+    coll.setNumericMode(true);
+    std::sort(names.begin(), names.end(), [&](const QString& a, const QString& b) { return coll.compare(a, b) > 0; });
+    for (const QString& n : names) {
+        const QString java = javaIn(QDir(root_).filePath(n));
+        if (java.isEmpty()) continue;
+        if (outVersion) *outVersion = n.mid(prefix.size(), n.size() - prefix.size() - suffix.size());
+        return java;
+    }
+    return QString();
+}
+
+QString RuntimeStore::ensureTemurin(int major, QString* outVersion)
+{
+    // локальный build отдаём сразу: API Adoptium (до 20 с) на пути запуска не стоит
+    const QString local = newestLocal(QString("temurin-%1-").arg(major),
+                                      QString("-linux-%1").arg(adoptiumArch()), outVersion);
+    if (local.isEmpty()) return installLatestTemurin(major, outVersion);
+    refreshTemurinAsync(major);
+    return local;
+}
+
+void RuntimeStore::refreshTemurinAsync(int major) const
+{
+    // не чаще раза в сутки на major и не больше одной проверки одновременно в процессе
+    static QMutex mx;
+    static QSet<int> running;
+    const QString key = QString("runtime/temurin%1CheckedAt").arg(major);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - QSettings().value(key, 0).toLongLong() < kTemurinCheckMs) return;
+    {
+        QMutexLocker lk(&mx);
+        if (running.contains(major)) return;
+        running.insert(major);
+    }
+    const QString cacheRoot = QFileInfo(root_).path();
+    auto fut = QtConcurrent::run([cacheRoot, major, key] {
+        try {
+            QString version;
+            RuntimeStore(cacheRoot).installLatestTemurin(major, &version);
+            QSettings().setValue(key, QDateTime::currentMSecsSinceEpoch());
+            qInfo() << "temurin" << major << "is up to date:" << version;
+        } catch (const std::exception& e) {
+            qWarning() << "temurin" << major << "background refresh failed:" << e.what();
+        }
+        QMutexLocker lk(&mx);
+        running.remove(major);
+    });
+    Q_UNUSED(fut);
+}
+
+QString RuntimeStore::installLatestTemurin(int major, QString* outVersion)
+{
+    const QString arch   = adoptiumArch();
+    const QString prefix = QString("temurin-%1-").arg(major);
+    const QString suffix = QString("-linux-%1").arg(arch);
+    CacheLock cacheInUse(CacheLock::wholeFile(QFileInfo(root_).path()), CacheLock::Mode::Shared);
+
+    // 1) какой build сейчас актуален (ссылка на архив и его SHA-256)
+    const QString api = QString("https://api.adoptium.net/v3/assets/latest/%1/hotspot"
+                                "?architecture=%2&image_type=jre&os=linux&vendor=eclipse")
+                            .arg(major).arg(arch);
+    Net net;
+    QJsonObject pkg;
+    QString version;
+    try {
+        const QJsonArray arr = QJsonDocument::fromJson(net.getBytes(QUrl(api), 20000)).array();
+        for (const auto& it : arr) {
+            const QJsonObject o = it.toObject();
+            const QJsonObject p = o.value("binary").toObject().value("package").toObject();
+            if (p.value("link").toString().isEmpty()) continue;
+            pkg = p;
+            version = o.value("version").toObject().value("semver").toString();
+            if (version.isEmpty()) version = o.value("release_name").toString();
+            break;
+        }
+    } catch (const std::exception& e) {
+        qWarning() << "adoptium api unavailable:" << e.what();
+    }
+
+    if (pkg.isEmpty()) {
+        // офлайн или API ничего не вернул — берём то, что уже есть
+        const QString java = newestLocal(prefix, suffix, outVersion);
+        if (java.isEmpty())
+            throw std::runtime_error(QString("Temurin %1 is not available: no API response and no local runtime")
+                                         .arg(major).toStdString());
+        return java;
+    }
+
+    const QString dir = QDir(root_).filePath(prefix + safeComponent(version) + suffix);
+    if (outVersion) *outVersion = version;
+
+    // 2) этот build уже распакован — ничего не качаем
+    const QString have = javaIn(dir);
+    if (!have.isEmpty()) {
+        qInfo() << "runtime store hit:" << dir;
+        return have;
+    }
+
+    // 3) качаем в staging рядом с целевым каталогом, считая SHA-256 на лету
+    const QString expected = pkg.value("checksum").toString().trimmed().toLower();
+    const QString staging  = dir + QString(".partial-%1").arg(QCoreApplication::applicationPid());
+    QDir(staging).removeRecursively();
+
+    QElapsedTimer timer; timer.start();
+    try {
+        QCryptographicHash sha(QCryptographicHash::Sha256);
+        QString extractErr;
+        {
+            TarGzExtractor tgz(staging, 1);
+            try {
+                net.getStream(QUrl(pkg.value("link").toString()), [&](const QByteArray& chunk) {
+                    // исключение не должно пролететь через цикл событий Qt — ловим и прерываем загрузку
+                    try {
+                        sha.addData(chunk);
+                        tgz.feed(chunk);
+                        return true;
+                    } catch (const std::exception& e) {
+                        extractErr = QString::fromUtf8(e.what());
+                        return false;
+                    }
+                });
+            } catch (const std::exception& e) {
+                throw std::runtime_error((extractErr.isEmpty() ? QString::fromUtf8(e.what()) : extractErr).toStdString());
+            }
+            tgz.finish();
+            qInfo().noquote() << QString("temurin %1 (%2): %3 file(s), %4 MiB unpacked in %5 ms")
+                                     .arg(major).arg(version).arg(tgz.filesWritten())
+                                     .arg(tgz.bytesWritten() / (1024.0 * 1024.0), 0, 'f', 1)
+                                     .arg(timer.elapsed());
+        }
+
+        const QString got = QString::fromLatin1(sha.result().toHex());
+        if (expected.isEmpty())
+            qWarning() << "adoptium: no checksum published for" << pkg.value("name").toString();
+        else if (got != expected)
+            throw std::runtime_error(QString("Temurin archive checksum mismatch: expected %1, got %2")
+                                         .arg(expected, got).toStdString());
+
+        // права берутся из архива, но исполняемость bin/java выставляем явно
+        const QString javaPath = QDir(staging).filePath("bin/java");
+        if (!QFileInfo::exists(javaPath))
+            throw std::runtime_error(("JRE archive has no bin/java: " + pkg.value("name").toString()).toStdString());
+        QFile fi(javaPath);
+        fi.setPermissions(fi.permissions() | QFile::ExeOwner | QFile::ExeGroup | QFile::ExeOther);
+
+        QJsonObject marker{
+            {"vendor", "temurin"},
+            {"major", major},
+            {"version", version},
+            {"os", "linux"},
+            {"arch", arch},
+            {"archive", pkg.value("name").toString()},
+            {"sha256", got},
+            {"installedAt", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+        };
+        QSaveFile mf(QDir(staging).filePath(kMarker));
+        if (!mf.open(QIODevice::WriteOnly)
+            || mf.write(QJsonDocument(marker).toJson(QJsonDocument::Indented)) < 0 || !mf.commit())
+            throw std::runtime_error(("Cannot write runtime marker in " + staging).toStdString());
+    } catch (...) {
+        QDir(staging).removeRecursively();
+        throw;
+    }
+
+    // 4) публикуем каталог целиком; параллельный процесс мог успеть раньше — его копия равноценна
+    if (!QDir().rename(staging, dir)) {
+        QDir(staging).removeRecursively();
+        if (javaIn(dir).isEmpty())
+            throw std::runtime_error(("Cannot commit runtime dir " + dir).toStdString());
+    }
+    return QDir(dir).filePath("bin/java");
+}
+
+// -------------------- Mojang java-runtime --------------------
+
+namespace {
+
+const char* kMojangIndexUrl =
+    "https://launchermeta.mojang.com/v1/products/java-runtime/2ec0cc96c44e5a76b9c8b7c39df7210883d12871/all.json";
+
+// Ключ платформы в all.json
+QString mojangPlatform()
+{
+#if defined(Q_OS_LINUX)
+#  if defined(Q_PROCESSOR_X86_64)
+    return "linux";
+#  elif defined(Q_PROCESSOR_X86_32)
+    return "linux-i386";
+#  else
+    return QString(); // Mojang не публикует рантаймы для linux/arm
+#  endif
+#elif defined(Q_OS_MACOS)
+#  if defined(Q_PROCESSOR_ARM_64)
+    return "mac-os-arm64";
+#  else
+    return "mac-os";
+#  endif
+#elif defined(Q_OS_WIN)
+#  if defined(Q_PROCESSOR_ARM_64)
+    return "windows-arm64";
+#  elif defined(Q_PROCESSOR_X86_64)
+    return "windows-x64";
+#  else
+    return "windows-x86";
+#  endif
+#else
+    return QString();
+#endif
+}
+
+QJsonObject readJsonFile(const QString& path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return QJsonObject();
+    return QJsonDocument::fromJson(f.readAll()).object();
+}
+
+void writeJsonFile(const QString& path, const QJsonObject& o)
+{
+    ensureDir(QFileInfo(path).path());
+    QSaveFile f(path);
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(QJsonDocument(o).toJson(QJsonDocument::Compact));
+        f.commit();
+    }
+}
+
+} // namespace
+
+QJsonObject RuntimeStore::mojangIndex(Net& net) const
+{
+    const QString cached = QDir(root_).filePath("mojang/all.json");
+    try {
+        const QJsonObject o = net.getJson(QUrl(kMojangIndexUrl), 20000);
+        writeJsonFile(cached, o);
+        return o;
+    } catch (const std::exception& e) {
+        qWarning() << "java-runtime index unavailable, using cached copy:" << e.what();
+    }
+    return readJsonFile(cached);
+}
+
+QJsonObject RuntimeStore::mojangManifest(Net& net, const QJsonObject& ref) const
+{
+    // манифесты адресуются sha1 — однажды скачанный не меняется
+    const QString sha  = ref.value("sha1").toString();
+    const QString path = QDir(root_).filePath("mojang/manifests/" + sha + ".json");
+    if (!sha.isEmpty() && sha1File(path) == sha) return readJsonFile(path);
+
+    const QByteArray body = net.getBytes(QUrl(ref.value("url").toString()), 20000);
+    const QString got = QString::fromLatin1(QCryptographicHash::hash(body, QCryptographicHash::Sha1).toHex());
+    if (!sha.isEmpty() && got != sha)
+        throw std::runtime_error(("java-runtime manifest sha1 mismatch: " + ref.value("url").toString()).toStdString());
+    const QJsonObject o = QJsonDocument::fromJson(body).object();
+    if (!sha.isEmpty()) writeJsonFile(path, o);
+    return o;
+}
+
+QString RuntimeStore::ensureMojang(const QString& component, QString* outVersion)
+{
+    const QString platform = mojangPlatform();
+    if (platform.isEmpty() || component.isEmpty()) return QString();
+    // объекты рантаймов общие — сборщик мусора не должен удалить их посреди раскладки
+    CacheLock cacheInUse(CacheLock::wholeFile(QFileInfo(root_).path()), CacheLock::Mode::Shared);
+
+    Net net;
+    const QJsonArray builds = mojangIndex(net).value(platform).toObject().value(component).toArray();
+    const QString prefix = QString("mojang-%1-").arg(component);
+    const QString suffix = "-" + platform;
+    if (builds.isEmpty()) {
+        // офлайн (нет ни сети, ни копии all.json) или компонента нет для платформы — что есть локально
+        return newestLocal(prefix, suffix, outVersion);
+    }
+
+    const QJsonObject build   = builds.first().toObject();
+    const QString     version = build.value("version").toObject().value("name").toString();
+    const QString     dir     = QDir(root_).filePath(prefix + safeComponent(version) + suffix);
+    if (outVersion) *outVersion = version;
+
+    const QString have = javaIn(dir);
+    if (!have.isEmpty()) {
+        qInfo() << "runtime store hit:" << dir;
+        return have;
+    }
+
+    const QJsonObject files = mojangManifest(net, build.value("manifest").toObject()).value("files").toObject();
+    if (files.isEmpty())
+        throw std::runtime_error(("Empty java-runtime manifest for " + component).toStdString());
+
+    // 1) план: объекты content-addressed кэша, нужные компоненту
+    struct Obj { QString sha; QUrl url; qint64 size = 0; };
+    QHash<QString, Obj> need;
+    FilePlacer::ShardedDir objects(QDir(root_).filePath("objects"));
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        const QJsonObject f = it.value().toObject();
+        if (f.value("type").toString() != "file") continue;
+        const QJsonObject raw = f.value("downloads").toObject().value("raw").toObject();
+        const QString sha = raw.value("sha1").toString();
+        if (sha.isEmpty()) throw std::runtime_error(("java-runtime entry without sha1: " + it.key()).toStdString());
+        Obj& o = need[sha];
+        o.sha  = sha;
+        o.url  = QUrl(raw.value("url").toString());
+        o.size = raw.value("size").toVariant().toLongLong();
+    }
+    QVector<Obj> todo;
+    for (const Obj& o : need) todo.push_back(o);
+
+    // 2) объекты — как assets: уже лежащие в кэше сверяются по sha1; недостающие качаются один раз
+    //    на процесс (SingleFlight), запись под шард-локом; LAN-зеркало первым, sha1 до записи
+    QElapsedTimer timer; timer.start();
+    const QString cacheRoot = QFileInfo(root_).path();
+    const QList<QUrl> lan = Downloader::lanMirror("runtimes");
+    SingleFlight& flights = SingleFlight::instance();
+    std::atomic_int fetched{0};
+    FirstError err;
+    QtConcurrent::blockingMap(todo, [&](Obj& o) {
+        if (err.failed()) return;
+        err.guard([&] {
+            const QString path = objects.pathFor(o.sha);
+            const bool got = flights.fetchToCache(cacheRoot, "runtimes/" + o.sha, path,
+                [&] { return sha1File(path) == o.sha; },
+                [&] {
+                    Net tnet;
+                    Downloader dl(tnet);
+                    auto sha1Ok = [&](const QByteArray& d) {
+                        return QCryptographicHash::hash(d, QCryptographicHash::Sha1).toHex() == o.sha.toLatin1();
+                    };
+                    QByteArray data;
+                    if (!lan.isEmpty()) {
+                        try { data = dl.getWithMirrors(lan, o.sha.left(2) + "/" + o.sha); } catch (...) {}
+                    }
+                    if (!sha1Ok(data)) data = dl.getWithMirrors({ o.url }, QString());
+                    if (!sha1Ok(data))
+                        throw std::runtime_error(("java-runtime sha1 mismatch: " + o.url.toString()).toStdString());
+                    return data;
+                });
+            if (got) fetched.fetch_add(1);
+        });
+    });
+    err.throwIfFailed();
+
+    // 3) собираем дерево рантайма в staging: каталоги, файлы из кэша, ссылки
+    const QString staging = dir + QString(".partial-%1").arg(QCoreApplication::applicationPid());
+    QDir(staging).removeRecursively();
+    try {
+        FilePlacer placer;
+        QVector<QPair<QString, QString>> links;
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            const QString rel = QDir::cleanPath(it.key());
+            if (rel.startsWith('/') || rel == ".." || rel.startsWith("../"))
+                throw std::runtime_error(("java-runtime path escapes root: " + it.key()).toStdString());
+            const QString dst = QDir(staging).filePath(rel);
+            const QJsonObject f = it.value().toObject();
+            const QString type = f.value("type").toString();
+            if (type == "directory") {
+                ensureDir(dst);
+            } else if (type == "file") {
+                ensureDir(QFileInfo(dst).path());
+                const QString sha = f.value("downloads").toObject().value("raw").toObject().value("sha1").toString();
+                // исполняемость — свойство inode: хардлинк на объект кэша её бы изменил у всех ссылок,
+                // поэтому исполняемые файлы (bin/* и пара хелперов) — отдельные копии
+                if (f.value("executable").toBool()) {
+                    if (!QFile::copy(objects.pathFor(sha), dst))
+                        throw std::runtime_error(("Cannot copy " + dst).toStdString());
+                    QFile(dst).setPermissions(QFile(dst).permissions()
+                                              | QFile::ExeOwner | QFile::ExeGroup | QFile::ExeOther);
+                } else if (!placer.place(objects.pathFor(sha), dst)) {
+                    throw std::runtime_error(("Cannot place " + dst).toStdString());
+                }
+            } else if (type == "link") {
+                links.push_back({dst, f.value("target").toString()});
+            }
+        }
+        for (const auto& l : links) {
+            ensureDir(QFileInfo(l.first).path());
+            if (!QFile::link(l.second, l.first))
+                throw std::runtime_error(("Cannot create link " + l.first).toStdString());
+        }
+
+        const QString javaPath = QDir(staging).filePath("bin/java");
+        if (!QFileInfo(javaPath).isExecutable())
+            throw std::runtime_error(("java-runtime has no executable bin/java: " + component).toStdString());
+
+        writeJsonFile(QDir(staging).filePath(kMarker), QJsonObject{
+            {"vendor", "mojang"},
+            {"component", component},
+            {"version", version},
+            {"os", platform},
+            {"manifestSha1", build.value("manifest").toObject().value("sha1").toString()},
+            {"installedAt", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+        });
+        qInfo().noquote() << QString("java-runtime %1 %2: %3 file(s), %4 downloaded in %5 ms, placement: %6")
+                                 .arg(component, version).arg(need.size()).arg(fetched.load())
+                                 .arg(timer.elapsed()).arg(placer.summary());
+    } catch (...) {
+        QDir(staging).removeRecursively();
+        throw;
+    }
+
+    if (!QDir().rename(staging, dir)) {
+        QDir(staging).removeRecursively();
+        if (javaIn(dir).isEmpty())
+            throw std::runtime_error(("Cannot commit runtime dir " + dir).toStdString());
+    }
+    return QDir(dir).filePath("bin/java");
+}
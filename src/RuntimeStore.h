@@ -0,0 +1,42 @@
+#pragma once
+#include <QtCore>
+
+class Net;
+
+// Хранилище Java-рантаймов в общем кэше: <cache>/runtimes/<vendor>-<major>-<version>-<os>-<arch>
+// (для общего кэша машины — в личном кэше пользователя, см. CachePaths::execRoot).
+// Каждый build распаковывается один раз и используется всеми инстансами;
+// готовность каталога подтверждает маркер .tesuto_runtime.json (пишется последним, до rename).
+class RuntimeStore {
+public:
+    explicit RuntimeStore(QString cacheRoot = QString());
+
+    QString root() const { return root_; }
+
+    // Temurin JRE <major> (Linux): самый новый локальный build этого major сразу, без сети; свежий
+    // GA-build по Adoptium API докачивается в фоне (не чаще раза в сутки) и достанется следующему запуску.
+    // Локального нет — свежий build скачивается сейчас; архив проверяется по SHA-256 из API прямо
+    // во время потоковой распаковки. Возвращает путь к bin/java.
+    QString ensureTemurin(int major, QString* outVersion = nullptr);
+
+    // Рантайм Mojang по компоненту из version.json (javaVersion.component, напр. "java-runtime-gamma").
+    // Файлы компонента лежат в кэше content-addressed (<runtimes>/objects/xx/<sha1>) и раскладываются
+    // хардлинками, поэтому общие для разных версий рантайма файлы качаются и хранятся один раз,
+    // а обновление рантайма тянет только изменившиеся файлы. Возвращает путь к bin/java.
+    QString ensureMojang(const QString& component, QString* outVersion = nullptr);
+
+    // Уже распакованный рантайм (есть маркер и bin/java) — путь к bin/java, иначе пусто
+    static QString javaIn(const QString& runtimeDir);
+
+private:
+    QJsonObject mojangIndex(Net& net) const;            // all.json (с офлайн-копией в кэше)
+    QJsonObject mojangManifest(Net& net, const QJsonObject& ref) const; // манифест компонента по sha1
+
+    // Свежий GA-build по API (уже распакованный — без загрузки); без сети — самый новый локальный
+    QString installLatestTemurin(int major, QString* outVersion);
+    void refreshTemurinAsync(int major) const;
+
+    QString newestLocal(const QString& prefix, const QString& suffix, QString* outVersion) const;
+
+    QString root_;
+};
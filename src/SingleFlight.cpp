@@ -0,0 +1,180 @@
+#include "SingleFlight.h"
+#include "CacheLock.h"
+#include <QSaveFile>
+#include <stdexcept>
+
+namespace {
+
+void writeAtomic(const QString& path, const QByteArray& data)
+{
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || f.write(data) != data.size() || !f.commit())
+        throw std::runtime_error(("write failed: " + path).toStdString());
+}
+
+} // namespace
+
+SingleFlight& SingleFlight::instance()
+{
+    static SingleFlight sf;
+    return sf;
+}
+
+SingleFlight::Join SingleFlight::join(const QString& key)
+{
+    QMutexLocker lk(&mx_);
+    for (;;) {
+        auto it = flights_.find(key);
+        if (it == flights_.end()) {
+            flights_.insert(key, std::make_shared<Flight>());
+            Join j;
+            j.leader = true;
+            return j;
+        }
+
+        // держим свою ссылку: ведущий уберёт запись из таблицы, а состояние нам ещё нужно
+        const std::shared_ptr<Flight> f = it.value();
+        ++f->waiters;
+        // ждём загрузку, а опубликованный объект, который уже пишет кто-то другой, — его запись
+        while (f->state == State::Downloading || (f->state == State::Published && f->writing))
+            cv_.wait(&mx_);
+        --f->waiters;
+
+        // ведущий не справился — его установку могли отменить или у него моргнула сеть; у нас свой
+        // токен и свой Net, поэтому пробуем заново: первый вернувшийся станет ведущим, остальные
+        // подождут его. Ошибку получит только тот, кто упал ведущим сам
+        if (f->state == State::Failed) {
+            qInfo().noquote() << QString("single-flight: %1 failed for another install (%2), retrying")
+                                     .arg(key, f->error);
+            continue;
+        }
+
+        Join j;
+        j.written = (f->state == State::Done);
+        if (!j.written) {
+            // запись отложена ведущим — забираем её себе, его пачка этот объект пропустит
+            j.data     = f->data;
+            f->writing = true;
+        }
+        return j;
+    }
+}
+
+void SingleFlight::publish(const QString& key, const QByteArray& data)
+{
+    QMutexLocker lk(&mx_);
+    if (auto f = flights_.value(key)) {
+        f->data  = data;
+        f->state = State::Published;
+    }
+    cv_.wakeAll();
+}
+
+bool SingleFlight::claimWrite(const QString& key)
+{
+    QMutexLocker lk(&mx_);
+    const std::shared_ptr<Flight> f = flights_.value(key);
+    if (!f) return false; // записал ждущий, загрузка завершена
+    while (f->state == State::Published && f->writing)
+        cv_.wait(&mx_);
+    if (f->state != State::Published) return false;
+    f->writing = true;
+    return true;
+}
+
+void SingleFlight::release(const QString& key)
+{
+    QMutexLocker lk(&mx_);
+    if (auto f = flights_.value(key)) {
+        f->writing = false;
+        // ведущий уже отказался, ждущих нет — байты больше никому не нужны
+        if (f->abandoned && f->waiters == 0) flights_.remove(key);
+    }
+    cv_.wakeAll();
+}
+
+void SingleFlight::abandon(const QString& key)
+{
+    QMutexLocker lk(&mx_);
+    abandonLocked(key);
+}
+
+void SingleFlight::abandonLocked(const QString& key)
+{
+    if (auto f = flights_.value(key)) {
+        if (f->state != State::Published) return;
+        f->abandoned = true;
+        // записывает или ждёт кто-то другой — он и завершит загрузку; иначе следующий станет ведущим
+        if (!f->writing && f->waiters == 0) flights_.remove(key);
+    }
+    cv_.wakeAll();
+}
+
+void SingleFlight::done(const QString& key)
+{
+    QMutexLocker lk(&mx_);
+    finishLocked(key, State::Done);
+}
+
+void SingleFlight::fail(const QString& key, const QString& error)
+{
+    QMutexLocker lk(&mx_);
+    if (auto f = flights_.value(key)) {
+        // уже опубликованные байты ждущим ещё пригодятся — такую загрузку неудачной не считаем
+        if (f->state == State::Published) {
+            abandonLocked(key);
+            return;
+        }
+        f->error = error;
+    }
+    finishLocked(key, State::Failed);
+}
+
+void SingleFlight::finishLocked(const QString& key, State st)
+{
+    if (auto f = flights_.take(key)) {
+        f->state = st;
+        if (st != State::Published) f->data.clear();
+    }
+    cv_.wakeAll();
+}
+
+bool SingleFlight::fetchToCache(const QString& cacheRoot, const QString& key, const QString& path,
+                                const std::function<bool()>& valid, const std::function<QByteArray()>& download)
+{
+    if (valid()) return false;
+    const Join j = join(key);
+    if (!j.leader) {
+        if (!j.written) {
+            // запись, отложенную ведущим, join отдал нам: он этот объект уже не пишет
+            try {
+                writeAtomic(path, j.data);
+            } catch (...) {
+                release(key);
+                throw;
+            }
+            done(key);
+        }
+        return false;
+    }
+    try {
+        bool fetched = false;
+        // пока ждали очереди в таблице, файл мог положить прошлый ведущий
+        if (!valid()) {
+            // сеть — без шард-лока: соседние по шарду объекты не ждут чужую загрузку. Другой процесс
+            // на том же кэше в худшем случае скачает тот же файл параллельно, но запишет его один
+            const QByteArray data = download();
+            CacheLock shard(CacheLock::shardFile(cacheRoot, key), CacheLock::Mode::Exclusive);
+            if (!valid()) {
+                writeAtomic(path, data);
+                fetched = true;
+            }
+        }
+        done(key);
+        return fetched;
+    } catch (const std::exception& e) {
+        fail(key, QString::fromUtf8(e.what()));
+        throw;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <QtCore>
+#include <functional>
+#include <memory>
+
+// Таблица «один объект — одна загрузка и одна запись» на весь процесс.
+// Первый, кто запросил ключ (sha1 содержимого), становится ведущим и качает; остальные ждут его.
+// Если ведущий отложил запись на диск (пачка io_uring), первый ждущий забирает запись себе:
+// пишет проверенные байты сразу, а пачка ведущего этот объект пропускает (claimWrite). Остальные
+// ждут только эту запись — никто не ждёт чужую пачку, поэтому взаимных блокировок между установками нет.
+class SingleFlight {
+public:
+    struct Join {
+        bool       leader  = false; // качать нам
+        bool       written = false; // объект уже в кэше
+        QByteArray data;            // иначе — проверенные байты: запись за нами, затем done(),
+                                    // при ошибке записи — release()
+    };
+
+    static SingleFlight& instance();
+
+    // Присоединиться к загрузке key. Блокирует, пока ведущий качает. Если ведущий упал,
+    // присоединяется заново (и, возможно, сам становится ведущим) — чужая ошибка не пробрасывается
+    Join join(const QString& key);
+
+    // Ведущий: объект скачан и проверен, запись в кэш отложена
+    void publish(const QString& key, const QByteArray& data);
+    // Ведущий перед отложенной записью: false — объект уже записал ждущий, писать не нужно
+    bool claimWrite(const QString& key);
+    // Записать опубликованный объект не вышло — запись достанется следующему (ведущему или ждущему)
+    void release(const QString& key);
+    // Ведущий: опубликованный объект он уже не запишет (установка упала); запишет ждущий, если есть
+    void abandon(const QString& key);
+    // Ведущий: объект лежит в кэше
+    void done(const QString& key);
+    // Ведущий: не получилось; ждущие попробуют сами
+    void fail(const QString& key, const QString& error);
+
+    // Файл кэша path целиком: уже valid() — ничего; иначе одна загрузка на процесс.
+    // download() отдаёт проверенные байты и идёт без блокировок; шард-лок cacheRoot держится только
+    // на перепроверке valid() и записи (temp + rename). true — файл скачали и записали мы.
+    // Ошибки — std::runtime_error, только свои: ждущий упавшего ведущего повторяет загрузку сам
+    bool fetchToCache(const QString& cacheRoot, const QString& key, const QString& path,
+                      const std::function<bool()>& valid, const std::function<QByteArray()>& download);
+
+private:
+    enum class State { Downloading, Published, Done, Failed };
+    struct Flight {
+        State      state = State::Downloading;
+        QByteArray data;
+        QString    error;
+        bool       writing   = false; // опубликованный объект сейчас кто-то пишет
+        bool       abandoned = false; // ведущий его больше не запишет
+        int        waiters   = 0;
+    };
+
+    SingleFlight() = default;
+    void finishLocked(const QString& key, State st);
+    void abandonLocked(const QString& key);
+
+    QMutex                                   mx_;
+    QWaitCondition                           cv_;
+    QHash<QString, std::shared_ptr<Flight>>  flights_;
+};
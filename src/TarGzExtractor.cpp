@@ -0,0 +1,347 @@
+#include "TarGzExtractor.h"
+#include "Util.h"
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int    kBlock    = 512;
+constexpr int    kInflBuf  = 256 * 1024;
+constexpr qint64 kMaxMeta  = 1 << 20; // L/K/pax-записи больше мегабайта — явно мусор
+
+[[noreturn]] void fail(const QString& why)
+{
+    throw std::runtime_error(("tar.gz: " + why).toStdString());
+}
+
+// Числовое поле заголовка: восьмеричное ASCII или base-256 (GNU, для больших размеров)
+quint64 parseNum(const char* p, int n)
+{
+    if (n > 0 && (uchar(p[0]) & 0x80)) {
+        quint64 v = uchar(p[0]) & 0x7f;
+        for (int i = 1; i < n; ++i) v = (v << 8) | uchar(p[i]);
+        return v;
+    }
+    int i = 0;
+    while (i < n && p[i] == ' ') ++i;
+    quint64 v = 0;
+    for (; i < n && p[i] >= '0' && p[i] <= '7'; ++i) v = v * 8 + quint64(p[i] - '0');
+    return v;
+}
+
+QString strField(const char* p, int n)
+{
+    return QString::fromUtf8(p, int(strnlen(p, size_t(n))));
+}
+
+} // namespace
+
+struct TarGzExtractor::Private {
+    enum class State { Header, Data, Pad, End };
+    enum class Sink  { Skip, File, Meta };
+
+    z_stream   zs{};
+    bool       zInit = false;
+    bool       zDone = false;      // текущий gzip-member дочитан
+    QByteArray inflBuf;
+
+    State      state = State::Header;
+    QByteArray hdr;                // заголовок, собираемый из кусков
+    quint64    remaining = 0;      // байт данных текущей записи
+    quint64    pad = 0;            // добивка до 512
+
+    Sink       sink = Sink::Skip;
+    QFile      out;
+    quint32    mode = 0;
+    char       metaType = 0;
+    QByteArray meta;
+
+    // переопределения для следующей записи (GNU L/K, pax x)
+    QString nextPath, nextLink;
+    qint64  nextSize = -1;
+
+    struct Link { QString path; QString target; };
+    QVector<Link>                    symlinks;
+    QVector<QPair<QString, quint32>> dirModes;
+    QSet<QString>                    madeDirs;
+
+    void mkdirs(const QString& dir)
+    {
+        if (madeDirs.contains(dir)) return;
+        if (!ensureDir(dir)) fail("cannot create directory " + dir);
+        madeDirs.insert(dir);
+    }
+};
+
+TarGzExtractor::TarGzExtractor(QString dest, int stripComponents)
+    : d(new Private), dest_(QDir::cleanPath(std::move(dest))), strip_(stripComponents)
+{
+    // 16 + MAX_WBITS — zlib сам разбирает gzip-заголовок и проверяет CRC32 в трейлере
+    if (inflateInit2(&d->zs, 16 + MAX_WBITS) != Z_OK) fail("inflateInit failed");
+    d->zInit = true;
+    d->inflBuf.resize(kInflBuf);
+    d->mkdirs(dest_);
+}
+
+TarGzExtractor::~TarGzExtractor()
+{
+    if (d->zInit) inflateEnd(&d->zs);
+    if (d->out.isOpen()) {
+        d->out.close();
+        d->out.remove(); // недописанный файл не оставляем
+    }
+}
+
+void TarGzExtractor::feed(const char* data, qint64 size)
+{
+    auto& zs = d->zs;
+    while (size > 0) {
+        // zlib принимает uInt: большие куски подаём частями
+        const uInt part = uInt(qMin<qint64>(size, 1 << 30));
+        zs.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = part;
+        data += part;
+        size -= part;
+
+        for (;;) {
+            if (d->zDone) {
+                if (zs.avail_in == 0) break;
+                // после конца tar хвост (добивка нулями и т.п.) не интересен
+                if (d->state == Private::State::End) { zs.avail_in = 0; break; }
+                // несколько склеенных gzip-member'ов — допустимо
+                if (inflateReset(&zs) != Z_OK) fail("inflateReset failed");
+                d->zDone = false;
+            }
+            zs.next_out  = reinterpret_cast<Bytef*>(d->inflBuf.data());
+            zs.avail_out = uInt(d->inflBuf.size());
+            const int rc = inflate(&zs, Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+                if (d->state == Private::State::End) { zs.avail_in = 0; break; }
+                fail(QString("inflate error %1%2").arg(rc).arg(zs.msg ? QString(": ") + zs.msg : QString()));
+            }
+            const qint64 produced = d->inflBuf.size() - qint64(zs.avail_out);
+            if (produced > 0) consumeTar(d->inflBuf.constData(), produced);
+            if (rc == Z_STREAM_END) { d->zDone = true; continue; }
+            if (zs.avail_in == 0 && zs.avail_out != 0) break; // вход съеден, выход не упёрся в буфер
+            if (rc == Z_BUF_ERROR) break;
+        }
+    }
+}
+
+void TarGzExtractor::consumeTar(const char* p, qint64 n)
+{
+    using State = Private::State;
+    using Sink  = Private::Sink;
+
+    while (n > 0) {
+        switch (d->state) {
+        case State::Header: {
+            const qint64 take = qMin<qint64>(kBlock - d->hdr.size(), n);
+            d->hdr.append(p, int(take));
+            p += take; n -= take;
+            if (d->hdr.size() == kBlock) {
+                onHeader();
+                d->hdr.clear();
+            }
+            break;
+        }
+        case State::Data: {
+            const qint64 take = qint64(qMin<quint64>(d->remaining, quint64(n)));
+            if (d->sink == Sink::File) {
+                if (d->out.write(p, take) != take)
+                    fail("write failed: " + d->out.fileName() + ": " + d->out.errorString());
+                bytes_ += take;
+            } else if (d->sink == Sink::Meta) {
+                d->meta.append(p, int(take));
+            }
+            p += take; n -= take;
+            d->remaining -= quint64(take);
+            if (d->remaining == 0) {
+                onEntryDone();
+                d->state = d->pad ? State::Pad : State::Header;
+            }
+            break;
+        }
+        case State::Pad: {
+            const qint64 take = qint64(qMin<quint64>(d->pad, quint64(n)));
+            p += take; n -= take;
+            d->pad -= quint64(take);
+            if (d->pad == 0) d->state = State::Header;
+            break;
+        }
+        case State::End:
+            return;
+        }
+    }
+}
+
+QString TarGzExtractor::mapPath(const QString& archivePath) const
+{
+    if (archivePath.startsWith('/')) fail("absolute path in archive: " + archivePath);
+    QStringList parts;
+    for (const QString& c : archivePath.split('/', Qt::SkipEmptyParts)) {
+        if (c == ".") continue;
+        if (c == "..") fail("path escapes destination: " + archivePath);
+        parts << c;
+    }
+    if (parts.size() <= strip_) return QString();
+    return dest_ + "/" + parts.mid(strip_).join('/');
+}
+
+void TarGzExtractor::onHeader()
+{
+    using State = Private::State;
+    using Sink  = Private::Sink;
+    const char* h = d->hdr.constData();
+
+    // нулевой блок — конец архива
+    bool zero = true;
+    for (int i = 0; i < kBlock && zero; ++i) zero = (h[i] == 0);
+    if (zero) { d->state = State::End; return; }
+
+    // контрольная сумма считается с пробелами на месте поля chksum
+    quint64 sum = 0;
+    for (int i = 0; i < kBlock; ++i) sum += (i >= 148 && i < 156) ? quint64(' ') : quint64(uchar(h[i]));
+    if (sum != parseNum(h + 148, 8)) fail("header checksum mismatch");
+
+    QString name = strField(h, 100);
+    if (memcmp(h + 257, "ustar", 5) == 0) {
+        const QString prefix = strField(h + 345, 155);
+        if (!prefix.isEmpty()) name = prefix + "/" + name;
+    }
+    QString link   = strField(h + 157, 100);
+    quint64 size   = parseNum(h + 124, 12);
+    const char type = h[156];
+    d->mode = quint32(parseNum(h + 100, 8)) & 07777;
+
+    d->sink = Sink::Skip;
+    if (type == 'L' || type == 'K' || type == 'x') {
+        if (size > quint64(kMaxMeta)) fail("oversized extended header");
+        d->sink = Sink::Meta;
+        d->metaType = type;
+        d->meta.clear();
+    } else if (type != 'g') {
+        if (!d->nextPath.isEmpty()) name = d->nextPath;
+        if (!d->nextLink.isEmpty()) link = d->nextLink;
+        if (d->nextSize >= 0)       size = quint64(d->nextSize);
+        d->nextPath.clear(); d->nextLink.clear(); d->nextSize = -1;
+
+        const QString target = mapPath(name);
+        if (!target.isEmpty()) {
+            switch (type) {
+            case '5':
+                d->mkdirs(target);
+                d->dirModes.push_back({target, d->mode});
+                break;
+            case '0': case '\0': case '7': {
+                d->mkdirs(QFileInfo(target).path());
+                QFile::remove(target); // как tar: unlink + create (не пишем в занятый бинарь)
+                d->out.setFileName(target);
+                if (!d->out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                    fail("cannot create " + target + ": " + d->out.errorString());
+                d->sink = Sink::File;
+                break;
+            }
+            case '1': {
+                const QString src = mapPath(link);
+                if (src.isEmpty()) fail("hard link target outside archive root: " + link);
+                d->mkdirs(QFileInfo(target).path());
+                QFile::remove(target);
+#ifdef Q_OS_UNIX
+                if (::link(QFile::encodeName(src).constData(), QFile::encodeName(target).constData()) != 0)
+#endif
+                    if (!QFile::copy(src, target)) fail("cannot link " + target + " -> " + src);
+                ++files_;
+                break;
+            }
+            case '2':
+                d->symlinks.push_back({target, link});
+                break;
+            default:
+                break; // устройства, fifo и прочее в JRE не встречаются
+            }
+        }
+    }
+
+    d->remaining = size;
+    d->pad = (kBlock - size % kBlock) % kBlock;
+    if (size > 0) {
+        d->state = State::Data;
+    } else {
+        onEntryDone();
+        d->state = State::Header;
+    }
+}
+
+void TarGzExtractor::onEntryDone()
+{
+    using Sink = Private::Sink;
+
+    if (d->sink == Sink::File) {
+        d->out.close();
+        if (d->out.error() != QFileDevice::NoError)
+            fail("close failed: " + d->out.fileName() + ": " + d->out.errorString());
+        d->out.setPermissions(permissionsFromMode(d->mode ? d->mode : 0644));
+        ++files_;
+    } else if (d->sink == Sink::Meta) {
+        if (d->metaType == 'L' || d->metaType == 'K') {
+            const QString v = QString::fromUtf8(d->meta.constData(), int(strnlen(d->meta.constData(), size_t(d->meta.size()))));
+            (d->metaType == 'L' ? d->nextPath : d->nextLink) = v;
+        } else {
+            // pax: записи вида "<len> key=value\n"
+            qsizetype pos = 0;
+            while (pos < d->meta.size()) {
+                const qsizetype sp = d->meta.indexOf(' ', pos);
+                if (sp < 0) break;
+                const qsizetype len = d->meta.mid(pos, sp - pos).toLongLong();
+                if (len <= 0 || pos + len > d->meta.size()) break;
+                const QByteArray rec = d->meta.mid(sp + 1, pos + len - sp - 2); // без '\n'
+                const qsizetype eq = rec.indexOf('=');
+                if (eq > 0) {
+                    const QByteArray key = rec.left(eq);
+                    const QByteArray val = rec.mid(eq + 1);
+                    if (key == "path")          d->nextPath = QString::fromUtf8(val);
+                    else if (key == "linkpath") d->nextLink = QString::fromUtf8(val);
+                    else if (key == "size")     d->nextSize = val.toLongLong();
+                }
+                pos += len;
+            }
+        }
+        d->meta.clear();
+    }
+    d->sink = Sink::Skip;
+}
+
+void TarGzExtractor::finish()
+{
+    using State = Private::State;
+    // архив без завершающих нулевых блоков принимаем, если gzip закончился ровно на границе записи
+    const bool clean = d->state == State::End
+                    || (d->zDone && d->state == State::Header && d->hdr.isEmpty());
+    if (!clean) fail("truncated archive");
+
+    const QString root = QFileInfo(dest_).canonicalFilePath();
+    for (const auto& l : d->symlinks) {
+        d->mkdirs(QFileInfo(l.path).path());
+        // родитель мог оказаться ссылкой, созданной выше по списку, — наружу dest не пишем
+        const QString parent = QFileInfo(QFileInfo(l.path).path()).canonicalFilePath();
+        if (parent != root && !parent.startsWith(root + "/"))
+            fail("symlink escapes destination: " + l.path);
+        QFile::remove(l.path);
+#ifdef Q_OS_UNIX
+        if (::symlink(QFile::encodeName(l.target).constData(), QFile::encodeName(l.path).constData()) != 0)
+            fail("cannot create symlink " + l.path + " -> " + l.target);
+#else
+        if (!QFile::link(l.target, l.path))
+            fail("cannot create symlink " + l.path + " -> " + l.target);
+#endif
+    }
+
+    // права каталогов — в самом конце и от глубоких к верхним (0555 не мешает писать внутрь)
+    for (auto it = d->dirModes.crbegin(); it != d->dirModes.crend(); ++it)
+        QFile::setPermissions(it->first, permissionsFromMode(it->second ? it->second : 0755));
+}
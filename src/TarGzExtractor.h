@@ -0,0 +1,41 @@
+#pragma once
+#include <QtCore>
+#include <memory>
+
+// Потоковая распаковка .tar.gz: байты подаются кусками (прямо из сети), gzip разжимается zlib,
+// tar разбирается по мере поступления и пишется на диск — без промежуточного файла архива.
+// Поддерживает ustar, GNU long name/link (L/K) и pax (path/linkpath/size), права из заголовка,
+// симлинки и хардлинки. Симлинки и права каталогов применяются в finish(), после всех файлов,
+// чтобы запись не могла уйти за пределы dest через ссылку из того же архива.
+class TarGzExtractor {
+public:
+    // stripComponents — как `tar --strip-components` (сколько первых компонентов пути отбросить)
+    explicit TarGzExtractor(QString dest, int stripComponents = 0);
+    ~TarGzExtractor();
+    TarGzExtractor(const TarGzExtractor&) = delete;
+    TarGzExtractor& operator=(const TarGzExtractor&) = delete;
+
+    // Очередной кусок сжатого потока. Ошибки — std::runtime_error
+    void feed(const char* data, qint64 size);
+    void feed(const QByteArray& chunk) { feed(chunk.constData(), chunk.size()); }
+
+    // Конец потока: проверяет, что архив дочитан, создаёт отложенные ссылки, ставит права каталогам
+    void finish();
+
+    qint64 filesWritten() const { return files_; }
+    qint64 bytesWritten() const { return bytes_; }
+
+private:
+    void consumeTar(const char* p, qint64 n);
+    void onHeader();
+    void onEntryDone();
+    QString mapPath(const QString& archivePath) const; // пусто — запись отбрасывается
+
+    struct Private;
+    std::unique_ptr<Private> d;
+
+    QString dest_;
+    int     strip_ = 0;
+    qint64  files_ = 0;
+    qint64  bytes_ = 0;
+};
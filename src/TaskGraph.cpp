@@ -0,0 +1,77 @@
+#include "TaskGraph.h"
+#include <exception>
+#include <stdexcept>
+
+void TaskGraph::add(const QString& name, const QStringList& deps, Fn fn)
+{
+    nodes_.push_back(Node{name, deps, std::move(fn), State::Pending});
+}
+
+void TaskGraph::run()
+{
+    if (nodes_.isEmpty()) return;
+
+    QHash<QString, int> byName;
+    for (int i = 0; i < nodes_.size(); ++i) byName.insert(nodes_[i].name, i);
+
+    // каждой задаче — свой поток: их единицы, а внутри они сами держат пулы загрузки
+    QThreadPool pool;
+    pool.setMaxThreadCount(nodes_.size());
+
+    QMutex mx;
+    QWaitCondition cv;
+    std::exception_ptr firstErr;
+    int running = 0;
+    bool cycle = false;
+
+    QMutexLocker lk(&mx);
+    for (;;) {
+        bool progressed = false;
+        int pending = 0;
+        for (int i = 0; i < nodes_.size(); ++i) {
+            Node& n = nodes_[i];
+            if (n.state != State::Pending) continue;
+
+            bool ready = true, blocked = false;
+            for (const QString& d : n.deps) {
+                const auto it = byName.constFind(d);
+                if (it == byName.constEnd()) continue;
+                const State ds = nodes_[*it].state;
+                if (ds == State::Failed || ds == State::Skipped) blocked = true;
+                else if (ds != State::Done) ready = false;
+            }
+            if (blocked) {
+                qInfo().noquote() << "task" << n.name << "skipped: a dependency failed";
+                n.state = State::Skipped;
+                progressed = true;
+                continue;
+            }
+            if (!ready) { ++pending; continue; }
+
+            n.state = State::Running;
+            ++running;
+            progressed = true;
+            pool.start([&, i] {
+                std::exception_ptr err;
+                try { nodes_[i].fn(); }
+                catch (...) { err = std::current_exception(); }
+                QMutexLocker l(&mx);
+                nodes_[i].state = err ? State::Failed : State::Done;
+                if (err && !firstErr) firstErr = err;
+                --running;
+                cv.wakeAll();
+            });
+        }
+        if (progressed) continue; // новые Done/Skipped могли разблокировать других
+        if (running == 0) {
+            cycle = pending > 0;
+            break;
+        }
+        cv.wait(&mx);
+    }
+    lk.unlock();
+    pool.waitForDone();
+
+    if (firstErr) std::rethrow_exception(firstErr);
+    if (cycle) throw std::runtime_error("Task graph has a dependency cycle");
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <QtCore>
+#include <functional>
+
+// Небольшой планировщик этапов установки: задачи с объявленными зависимостями выполняются
+// параллельно, каждая — как только готовы все её зависимости. Например, профиль и библиотеки
+// модлоадера зависят только от id версии и не ждут assets ванили, а рантайм Java — только от
+// version.json. Задачи пользуются собственными Net (QNetworkAccessManager не потокобезопасен).
+class TaskGraph {
+public:
+    using Fn = std::function<void()>;
+
+    // Зависимость от задачи, которой в графе нет, считается выполненной — удобно для
+    // необязательных этапов (нет модлоадера — нет и задачи "loader")
+    void add(const QString& name, const QStringList& deps, Fn fn);
+
+    bool isEmpty() const { return nodes_.isEmpty(); }
+
+    // Выполнить всё и дождаться. Задачи, зависящие от упавшей, не запускаются; уже идущие
+    // доделываются. Затем пробрасывается первое исключение как есть (InstallCancelled остаётся
+    // InstallCancelled). Цикл в зависимостях — std::runtime_error
+    void run();
+
+private:
+    enum class State { Pending, Running, Done, Failed, Skipped };
+    struct Node {
+        QString     name;
+        QStringList deps;
+        Fn          fn;
+        State       state = State::Pending;
+    };
+    QVector<Node> nodes_;
+};
@@ -20,6 +20,22 @@ return d.mkpath(p);
 inline QString joinPath(const QString &a, const QString &b) { return QDir(a).filePath(b); }
 
 
+// unix-права (0755 и т.п.) -> QFileDevice::Permissions (для распаковки архивов)
+inline QFileDevice::Permissions permissionsFromMode(quint32 mode) {
+    QFileDevice::Permissions p;
+    if (mode & 0400) p |= QFileDevice::ReadOwner  | QFileDevice::ReadUser;
+    if (mode & 0200) p |= QFileDevice::WriteOwner | QFileDevice::WriteUser;
+    if (mode & 0100) p |= QFileDevice::ExeOwner   | QFileDevice::ExeUser;
+    if (mode & 0040) p |= QFileDevice::ReadGroup;
+    if (mode & 0020) p |= QFileDevice::WriteGroup;
+    if (mode & 0010) p |= QFileDevice::ExeGroup;
+    if (mode & 0004) p |= QFileDevice::ReadOther;
+    if (mode & 0002) p |= QFileDevice::WriteOther;
+    if (mode & 0001) p |= QFileDevice::ExeOther;
+    return p;
+}
+
+
 struct ScopeTimer {
 QString what; QElapsedTimer t; ~ScopeTimer(){ qInfo() << what << "took" << t.elapsed() << "ms"; }
 ScopeTimer(QString w):what(std::move(w)){ t.start(); }
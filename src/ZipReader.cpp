@@ -0,0 +1,166 @@
+#include "ZipReader.h"
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+#include <zlib.h>
+
+namespace {
+
+constexpr quint32 kSigLocal      = 0x04034b50;
+constexpr quint32 kSigCentral    = 0x02014b50;
+constexpr quint32 kSigEocd       = 0x06054b50;
+constexpr quint32 kSigZip64Loc   = 0x07064b50;
+constexpr quint32 kSigZip64Eocd  = 0x06064b50;
+
+inline quint16 rd16(const uchar* p) { return qFromLittleEndian<quint16>(p); }
+inline quint32 rd32(const uchar* p) { return qFromLittleEndian<quint32>(p); }
+inline quint64 rd64(const uchar* p) { return qFromLittleEndian<quint64>(p); }
+
+} // namespace
+
+ZipReader::ZipReader(const QString& path)
+    : file_(path)
+{
+    if (!file_.open(QIODevice::ReadOnly)) {
+        error_ = QString("cannot open %1: %2").arg(path, file_.errorString());
+        return;
+    }
+    size_ = file_.size();
+    if (size_ < 22) { error_ = QString("not a zip: %1").arg(path); return; }
+
+    data_ = file_.map(0, size_);
+    if (!data_) { error_ = QString("mmap failed: %1").arg(path); return; }
+
+    if (!parseCentralDirectory()) {
+        file_.unmap(const_cast<uchar*>(data_));
+        data_ = nullptr;
+        if (error_.isEmpty()) error_ = QString("broken zip: %1").arg(path);
+    }
+}
+
+ZipReader::~ZipReader()
+{
+    if (data_) file_.unmap(const_cast<uchar*>(data_));
+}
+
+bool ZipReader::parseCentralDirectory()
+{
+    // EOCD ищем с конца (за ним может быть комментарий до 64 КБ)
+    qint64 eocd = -1;
+    const qint64 stop = qMax<qint64>(0, size_ - 22 - 0xFFFF);
+    for (qint64 p = size_ - 22; p >= stop; --p) {
+        if (rd32(data_ + p) == kSigEocd) { eocd = p; break; }
+    }
+    if (eocd < 0) { error_ = "end of central directory not found"; return false; }
+
+    quint64 count    = rd16(data_ + eocd + 10);
+    quint64 cdSize   = rd32(data_ + eocd + 12);
+    quint64 cdOffset = rd32(data_ + eocd + 16);
+
+    // ZIP64: локатор стоит прямо перед EOCD
+    if (eocd >= 20 && rd32(data_ + eocd - 20) == kSigZip64Loc) {
+        const quint64 z64 = rd64(data_ + eocd - 20 + 8);
+        if (z64 + 56 <= quint64(size_) && rd32(data_ + z64) == kSigZip64Eocd) {
+            count    = rd64(data_ + z64 + 32);
+            cdSize   = rd64(data_ + z64 + 40);
+            cdOffset = rd64(data_ + z64 + 48);
+        }
+    }
+    if (cdOffset + cdSize > quint64(size_)) { error_ = "central directory out of bounds"; return false; }
+
+    entries_.reserve(int(qMin<quint64>(count, 65535)));
+    quint64 p = cdOffset;
+    const quint64 end = cdOffset + cdSize;
+    for (quint64 i = 0; i < count; ++i) {
+        if (p + 46 > end || rd32(data_ + p) != kSigCentral) { error_ = "bad central directory entry"; return false; }
+        const uchar* h = data_ + p;
+        const quint16 madeBy  = rd16(h + 4);
+        const quint16 nameLen = rd16(h + 28);
+        const quint16 extraLen= rd16(h + 30);
+        const quint16 commLen = rd16(h + 32);
+        if (p + 46 + nameLen + extraLen + commLen > end) { error_ = "central directory entry out of bounds"; return false; }
+
+        Entry e;
+        e.flags       = rd16(h + 8);
+        e.method      = rd16(h + 10);
+        e.crc32       = rd32(h + 16);
+        e.compSize    = rd32(h + 20);
+        e.size        = rd32(h + 24);
+        e.localOffset = rd32(h + 42);
+        if ((madeBy >> 8) == 3) e.unixMode = (rd32(h + 38) >> 16) & 0777; // 3 = unix
+        e.name = QString::fromUtf8(reinterpret_cast<const char*>(h + 46), nameLen);
+
+        // ZIP64 extra (0x0001): присутствуют только поля, равные 0xFFFFFFFF, в фиксированном порядке
+        const uchar* x    = h + 46 + nameLen;
+        const uchar* xend = x + extraLen;
+        while (x + 4 <= xend) {
+            const quint16 id = rd16(x), len = rd16(x + 2);
+            const uchar* f = x + 4;
+            if (f + len > xend) break;
+            if (id == 0x0001) {
+                const uchar* fend = f + len;
+                if (e.size        == 0xFFFFFFFFu && f + 8 <= fend) { e.size        = rd64(f); f += 8; }
+                if (e.compSize    == 0xFFFFFFFFu && f + 8 <= fend) { e.compSize    = rd64(f); f += 8; }
+                if (e.localOffset == 0xFFFFFFFFu && f + 8 <= fend) { e.localOffset = rd64(f); f += 8; }
+            }
+            x += 4 + len;
+        }
+
+        entries_.push_back(std::move(e));
+        p += 46 + nameLen + extraLen + commLen;
+    }
+    return true;
+}
+
+quint32 ZipReader::crc32Of(const char* data, qint64 size)
+{
+    uLong crc = ::crc32(0L, Z_NULL, 0);
+    while (size > 0) {
+        const uInt chunk = uInt(qMin<qint64>(size, 1 << 30));
+        crc = ::crc32(crc, reinterpret_cast<const Bytef*>(data), chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return quint32(crc);
+}
+
+bool ZipReader::read(const Entry& e, QByteArray* out, QString* err) const
+{
+    auto fail = [&](const QString& why) {
+        if (err) *err = QString("%1: %2").arg(e.name, why);
+        return false;
+    };
+    if (!data_) return fail("archive is not open");
+    if (e.flags & 0x1) return fail("encrypted entries are not supported");
+
+    const quint64 lh = e.localOffset;
+    if (lh + 30 > quint64(size_) || rd32(data_ + lh) != kSigLocal) return fail("bad local header");
+    const quint64 dataOff = lh + 30 + rd16(data_ + lh + 26) + rd16(data_ + lh + 28);
+    if (dataOff + e.compSize > quint64(size_)) return fail("entry data out of bounds");
+    const uchar* src = data_ + dataOff;
+
+    if (e.size > quint64(std::numeric_limits<int>::max())) return fail("entry too large");
+    out->resize(qsizetype(e.size));
+
+    if (e.method == 0) {
+        if (e.compSize != e.size) return fail("stored size mismatch");
+        memcpy(out->data(), src, size_t(e.size));
+    } else if (e.method == 8) {
+        z_stream zs{};
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) return fail("inflateInit failed");
+        zs.next_in   = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(src));
+        zs.avail_in  = uInt(e.compSize);
+        zs.next_out  = reinterpret_cast<Bytef*>(out->data());
+        zs.avail_out = uInt(e.size);
+        const int rc = inflate(&zs, Z_FINISH);
+        const uLong produced = zs.total_out;
+        inflateEnd(&zs);
+        if ((rc != Z_STREAM_END && !(rc == Z_BUF_ERROR && e.size == 0)) || produced != e.size)
+            return fail("inflate failed");
+    } else {
+        return fail(QString("unsupported compression method %1").arg(e.method));
+    }
+
+    if (crc32Of(out->constData(), out->size()) != e.crc32) return fail("CRC mismatch");
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QtCore>
+
+// Минимальный читатель zip/jar: файл отображается в память (QFile::map),
+// оглавление берётся из central directory, данные — stored или deflate (zlib).
+// Нужен для распаковки natives без внешнего `unzip`.
+class ZipReader {
+public:
+    struct Entry {
+        QString name;              // путь внутри архива ('/' как разделитель)
+        quint16 method      = 0;   // 0 — stored, 8 — deflate
+        quint16 flags       = 0;
+        quint32 crc32       = 0;
+        quint64 compSize    = 0;
+        quint64 size        = 0;
+        quint64 localOffset = 0;
+        quint32 unixMode    = 0;   // права из external attrs (если архив создан на unix), иначе 0
+
+        bool isDir() const { return name.endsWith('/'); }
+    };
+
+    explicit ZipReader(const QString& path);
+    ~ZipReader();
+    ZipReader(const ZipReader&) = delete;
+    ZipReader& operator=(const ZipReader&) = delete;
+
+    bool isOpen() const { return data_ != nullptr; }
+    QString errorString() const { return error_; }
+
+    const QVector<Entry>& entries() const { return entries_; }
+
+    // Распаковать запись в память с проверкой CRC32
+    bool read(const Entry& e, QByteArray* out, QString* err = nullptr) const;
+
+    // CRC32 произвольного буфера (тот же алгоритм, что в zip)
+    static quint32 crc32Of(const char* data, qint64 size);
+
+private:
+    bool parseCentralDirectory();
+
+    QFile          file_;
+    const uchar*   data_ = nullptr;
+    qint64         size_ = 0;
+    QVector<Entry> entries_;
+    QString        error_;
+};
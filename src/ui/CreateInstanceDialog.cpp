@@ -10,7 +10,14 @@
 #include <QJsonObject>
 #include <QXmlStreamReader>
 #include <QSet>
+#include <QPointer>
+#include <QUuid>
+#include <QtConcurrent>
 #include <tuple>
+#include "../Net.h"
+#include "../MojangAPI.h"
+#include "../CacheManager.h"
+#include "../InstanceStore.h"
 
 // ---- helpers: simple sync GET ----
 static QByteArray httpGet(const QUrl& url, int timeoutMs = 15000, QString* errOut = nullptr) {
@@ -40,8 +47,10 @@ static QByteArray httpGet(const QUrl& url, int timeoutMs = 15000, QString* errOu
 // ====================== UI =========================
 CreateInstanceDialog::CreateInstanceDialog(const QStringList& mcVersions,
                                            const QStringList& knownGroups,
-                                           QWidget* parent)
+                                           QWidget* parent,
+                                           const QString& gameRoot)
     : QDialog(parent)
+    , gameRoot_(gameRoot)
 {
     setWindowTitle(tr("Создать сборку"));
     auto* root = new QVBoxLayout(this);
@@ -67,6 +76,11 @@ CreateInstanceDialog::CreateInstanceDialog(const QStringList& mcVersions,
     versionCombo_->addItems(mcVersions);
     if (versionCombo_->count()>0) versionCombo_->setCurrentIndex(0);
     leftLay->addWidget(versionCombo_);
+    sizeInfo_ = new QLabel(leftBox);
+    sizeInfo_->setStyleSheet("color: gray;");
+    sizeInfo_->setWordWrap(true);
+    leftLay->addWidget(sizeInfo_);
+    leftLay->addStretch();
 
     auto* rightBox = new QGroupBox(tr("Модлоадер"), this);
     auto* rightLay = new QFormLayout(rightBox);
@@ -117,12 +131,18 @@ CreateInstanceDialog::CreateInstanceDialog(const QStringList& mcVersions,
     debounce_->setInterval(200);
     connect(debounce_, &QTimer::timeout, this, &CreateInstanceDialog::refreshLoaderList);
 
+    sizeDebounce_ = new QTimer(this);
+    sizeDebounce_->setSingleShot(true);
+    sizeDebounce_->setInterval(300);
+    connect(sizeDebounce_, &QTimer::timeout, this, &CreateInstanceDialog::refreshSizeEstimate);
+
     connect(loaderKindCombo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &CreateInstanceDialog::onLoaderKindChanged);
     connect(versionCombo_,    QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &CreateInstanceDialog::onVersionChanged);
 
     onLoaderKindChanged(loaderKindCombo_->currentIndex());
+    sizeDebounce_->start();
 }
 
 QString CreateInstanceDialog::name() const { return nameEdit_->text().trimmed(); }
@@ -146,10 +166,66 @@ void CreateInstanceDialog::onLoaderKindChanged(int) {
 }
 
 void CreateInstanceDialog::onVersionChanged(int) {
+    sizeDebounce_->start();
     if (currentKind() == "none") return;
     debounce_->start();
 }
 
+QString CreateInstanceDialog::describeEstimate(const Installer::Estimate& e)
+{
+    QString eta;
+    if (e.downloadBytes == 0)    eta = tr("всё уже в кэше");
+    else if (e.etaSeconds < 0)   eta = tr("время неизвестно");
+    else if (e.etaSeconds < 60)  eta = tr("≈ %1 с").arg(qMax<qint64>(1, e.etaSeconds));
+    else                         eta = tr("≈ %1 мин").arg((e.etaSeconds + 59) / 60);
+
+    QString text = tr("Скачать %1 (%2 файлов), %3")
+                       .arg(CacheManager::formatBytes(e.downloadBytes)).arg(e.downloadFiles).arg(eta);
+    if (e.instanceBytes > 0)
+        text += tr("; копии в сборке %1").arg(CacheManager::formatBytes(e.instanceBytes));
+    if (e.freeCache >= 0)
+        text += tr("; свободно %1").arg(CacheManager::formatBytes(e.sameFilesystem ? e.freeCache
+                                                                                   : qMin(e.freeCache, e.freeInstance)));
+    const QString err = e.shortage();
+    if (!err.isEmpty()) text += "\n" + tr("Недостаточно места на диске!");
+    return text;
+}
+
+void CreateInstanceDialog::refreshSizeEstimate()
+{
+    const QString mc = currentMC();
+    const int seq = ++sizeSeq_;
+    if (mc.isEmpty()) { sizeInfo_->clear(); return; }
+    // уже оценённую версию не разрешаем и не считаем заново
+    if (sizeTexts_.contains(mc)) { sizeInfo_->setText(sizeTexts_.value(mc)); return; }
+    sizeInfo_->setText(tr("Оценка размера…"));
+
+    QPointer<CreateInstanceDialog> self(this);
+    // каталога новой сборки ещё нет: раскладка — целиком, место — на ФС каталога instances
+    Instance draft;
+    draft.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    const QString instDir = InstanceStore(gameRoot_).pathFor(draft);
+    auto fut = QtConcurrent::run([=]{
+        QString text;
+        bool ok = false;
+        try {
+            Net net; MojangAPI api(net);
+            const VersionResolved v = api.resolveVersion(mc);
+            // индекс assets только читаем: версию пока лишь выбирают
+            text = describeEstimate(Installer(api, QString()).estimate(v, instDir, false));
+            ok = true;
+        } catch (const std::exception& e) {
+            text = tr("Размер неизвестен: %1").arg(QString::fromUtf8(e.what()));
+        }
+        QMetaObject::invokeMethod(qApp, [self, seq, mc, text, ok]{
+            if (!self) return;
+            if (ok) self->sizeTexts_.insert(mc, text);
+            if (self->sizeSeq_ == seq) self->sizeInfo_->setText(text);
+        }, Qt::QueuedConnection);
+    });
+    Q_UNUSED(fut);
+}
+
 QString CreateInstanceDialog::currentMC() const { return versionCombo_->currentText().trimmed(); }
 QString CreateInstanceDialog::currentKind() const { return loaderKindCombo_->currentData().toString(); }
 
@@ -1,6 +1,8 @@
 #pragma once
 #include <QDialog>
+#include <QHash>
 #include <QStringList>
+#include "../Installer.h"
 
 class QLineEdit;
 class QComboBox;
@@ -11,9 +13,14 @@ class QTimer;
 class CreateInstanceDialog : public QDialog {
     Q_OBJECT
 public:
+    // gameRoot — где будет сборка (для оценки свободного места); пусто — без оценки места инстанса
     explicit CreateInstanceDialog(const QStringList& mcVersions,
                                   const QStringList& knownGroups,
-                                  QWidget* parent = nullptr);
+                                  QWidget* parent = nullptr,
+                                  const QString& gameRoot = QString());
+
+    // «Скачать 310 MiB (3412 файлов), ≈ 2 мин; свободно 41 GiB» — и здесь, и в логе установки
+    static QString describeEstimate(const Installer::Estimate& e);
 
     QString name() const;
     QString group() const;
@@ -25,6 +32,7 @@ private slots:
     void onLoaderKindChanged(int);
     void onVersionChanged(int);
     void refreshLoaderList();  // дебаунс-обновление списка версий лоадера
+    void refreshSizeEstimate(); // оценка размера установки выбранной версии (в фоне)
 
 private:
     // UI
@@ -35,6 +43,11 @@ private:
     QComboBox*  loaderVersionCombo_{};
     QLabel*     loaderStatus_{};
     QTimer*     debounce_{};
+    QLabel*     sizeInfo_{};
+    QTimer*     sizeDebounce_{};
+    int         sizeSeq_ = 0;     // ответ устаревшего запроса оценки отбрасываем
+    QHash<QString, QString> sizeTexts_; // оценки уже выбранных версий (id -> текст)
+    QString     gameRoot_;
 
     // сеть/кеш
     void setLoaderBusy(bool busy, const QString& msg = {});
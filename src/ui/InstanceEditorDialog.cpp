@@ -15,12 +15,16 @@
 #include <QFontMetrics>
 #include <QDir>
 #include <QFileInfo>
+#include <QPointer>
+#include <memory>
 
 #include "../InstanceStore.h"
 #include "../LoaderPatchIO.h"
 #include "../Settings.h"
 #include "../ModLoader.h"
 #include "../Net.h"
+#include "../MojangAPI.h"
+#include "../Installer.h"
 
 // ───── JSON helpers ─────────────────────────────────────────
 QString InstanceEditorDialog::metaPath(const QString& instDir) {
@@ -481,10 +485,70 @@ QWidget* InstanceEditorDialog::buildTabFiles() {
     connect(btnExport, &QPushButton::clicked, this, &InstanceEditorDialog::exportModsList);
     connect(btnImport, &QPushButton::clicked, this, &InstanceEditorDialog::importModsList);
 
+    // Проверка sha1 всех файлов игры и перекачка только испорченных
+    auto* repairRow = new QHBoxLayout;
+    btnRepair_ = new QPushButton(tr("Проверить и починить"), this);
+    btnRepair_->setToolTip(tr("Сверить все файлы игры с контрольными суммами и заново скачать только повреждённые"));
+    lblRepair_ = new QLabel(this);
+    repairRow->addWidget(btnRepair_);
+    repairRow->addWidget(lblRepair_, 1);
+    v->addLayout(repairRow);
+    connect(btnRepair_, &QPushButton::clicked, this, &InstanceEditorDialog::repairInstance);
+
     v->addStretch();
     return w;
 }
 
+// ───── Repair ──────────────────────────────────────────────
+void InstanceEditorDialog::repairInstance()
+{
+    btnRepair_->setEnabled(false);
+    lblRepair_->setText(tr("Проверка файлов…"));
+
+    // проверка может идти минуты — диалог к её концу могли уже закрыть
+    QPointer<InstanceEditorDialog> self(this);
+    const QString instDir = instanceDir_;
+    const QString mcVer   = mcVersion_;
+    auto fut = QtConcurrent::run([=]{
+        try {
+            Net net;
+            MojangAPI api(net);
+            const VersionResolved resolved = api.resolveVersion(mcVer);
+            Installer inst(api, instDir);
+
+            // прогресс зовётся на каждый файл — в UI отправляем только смену процента
+            auto lastPct = std::make_shared<std::atomic_int>(-1);
+            const Installer::RepairStats st = inst.repair(resolved, [=](qint64 done, qint64 total){
+                const int pct = total > 0 ? int(done * 100 / total) : 0;
+                if (lastPct->exchange(pct) == pct) return;
+                QMetaObject::invokeMethod(qApp, [self, pct]{
+                    if (self) self->lblRepair_->setText(tr("Проверка и починка… %1%").arg(pct));
+                }, Qt::QueuedConnection);
+            });
+
+            QString msg;
+            if (st.reinstalled)      msg = tr("Сверять было не с чем — сборка установлена заново.");
+            else if (st.broken == 0) msg = tr("Все файлы целы (проверено: %1).").arg(st.checked);
+            else                     msg = tr("Повреждено файлов: %1, восстановлено: %2.").arg(st.broken).arg(st.repaired);
+            QMetaObject::invokeMethod(qApp, [self, msg]{
+                if (!self) return;
+                self->btnRepair_->setEnabled(true);
+                self->lblRepair_->setText(msg);
+            }, Qt::QueuedConnection);
+        } catch (const std::exception& e) {
+            const QString msg = QString::fromUtf8(e.what());
+            QMetaObject::invokeMethod(qApp, [self, msg]{
+                if (!self) return;
+                self->btnRepair_->setEnabled(true);
+                self->lblRepair_->clear();
+                QMessageBox::warning(self, tr("Ошибка проверки"),
+                                     tr("Не удалось починить сборку: %1").arg(msg));
+            }, Qt::QueuedConnection);
+        }
+    });
+    Q_UNUSED(fut);
+}
+
 // ───── Export/Import mods list ────────────────────────────
 void InstanceEditorDialog::exportModsList()
 {
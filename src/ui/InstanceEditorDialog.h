@@ -47,6 +47,9 @@ private:
     void exportModsList();
     void importModsList();
 
+    // verify every file of the instance and refetch only broken ones
+    void repairInstance();
+
 private:
     QString instanceDir_;
     QString mcVersion_;
@@ -76,6 +79,10 @@ private:
     QSpinBox*  sbMaxRam_{};
     QLabel*    lblRamHint_{};
 
+    // Files
+    class QPushButton* btnRepair_{};
+    QLabel*            lblRepair_{};
+
     // Game
     QCheckBox* cbFullscreen_{};
     QSpinBox*  sbW_{};
@@ -21,6 +21,8 @@
 #include <QCryptographicHash>
 #include <QUuid>
 #include <QInputDialog>
+#include <algorithm>
+#include <atomic>
 #include <optional>
 #include <functional>
 #include <QDateTime>
@@ -33,6 +35,7 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QSet>
 #include <QMetaObject>
 #include <QCloseEvent>
@@ -48,10 +51,19 @@
 #include "../Net.h"
 #include "../MojangAPI.h"
 #include "../Installer.h"
+#include "../InstallJournal.h"
+#include "../InstallManifest.h"
+#include "../CacheManager.h"
+#include "../CachePaths.h"
+#include "../CacheScrubber.h"
+#include "../CacheServer.h"
 #include "../Launcher.h"
 #include "../InstanceStore.h"
 #include "../Settings.h"
 #include "../ModLoader.h"
+#include "../CancelToken.h"
+#include "../InstallObserver.h"
+#include "../TaskGraph.h"
 #include "../Util.h"
 
 #include "CreateInstanceDialog.h"
@@ -78,8 +90,14 @@ static void appendLog(const QWidget* root, const QString& s);
 // RAII-гарда для гарантированного endBusy() из фоновых задач
 struct UiBusyGuard {
     MainWindow* w{};
+    std::shared_ptr<CancelToken> cancel; // токен установки задачи — снимается вместе с «занято»
     ~UiBusyGuard() {
         if (!w) return;
+        if (cancel) {
+            MainWindow* mw = w;
+            QMetaObject::invokeMethod(w, [mw, token = cancel]{ mw->endInstallProgress(token); },
+                                      Qt::QueuedConnection);
+        }
 #if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
         // Типобезопасный вызов слота в GUI-потоке
         QMetaObject::invokeMethod(w, &MainWindow::endBusy, Qt::QueuedConnection);
@@ -90,6 +108,48 @@ struct UiBusyGuard {
     }
 };
 
+// Наблюдатель установки для фоновых задач: ход переносится в статусбар GUI-потоком.
+// Один наблюдатель — одна задача (ваниль, модлоадер): статусбар показывает их рядом,
+// строка задачи убирается вместе с наблюдателем
+class UiInstallObserver : public InstallObserver {
+public:
+    explicit UiInstallObserver(MainWindow* w) : w_(w), task_(nextTask()) {}
+    ~UiInstallObserver() override {
+        QPointer<MainWindow> w = w_;
+        const int task = task_;
+        QMetaObject::invokeMethod(qApp, [w, task]{ if (w) w->dropInstallProgress(task); }, Qt::QueuedConnection);
+    }
+    void onProgress(const InstallProgress& p) override {
+        QPointer<MainWindow> w = w_;
+        const int task = task_;
+        QMetaObject::invokeMethod(qApp, [w, task, p]{ if (w) w->showInstallProgress(task, p); }, Qt::QueuedConnection);
+    }
+private:
+    static int nextTask() { static std::atomic_int n{0}; return ++n; }
+
+    QPointer<MainWindow> w_;
+    const int task_;
+};
+
+// Установка модлоадера сборки со своим Net (задача TaskGraph идёт в своём потоке); патч сохраняется на диск
+static LoaderPatch installModloader(const QString& instDir, const QString& kind, const QString& mcVersion,
+                                    const QString& loaderVer, InstallObserver* observer,
+                                    const std::shared_ptr<CancelToken>& cancel)
+{
+    Net net;
+    net.setCancelToken(cancel);
+    ModloaderInstaller mli(net, instDir);
+    mli.setObserver(observer);
+    mli.setCancelToken(cancel);
+    LoaderPatch patch;
+    if (kind == "fabric")        patch = mli.installFabric(mcVersion, loaderVer);
+    else if (kind == "quilt")    patch = mli.installQuilt (mcVersion, loaderVer);
+    else if (kind == "forge")    patch = mli.installForge (mcVersion, loaderVer);
+    else if (kind == "neoforge") patch = mli.installNeoForge(mcVersion, loaderVer);
+    LoaderPatchIO::save(instDir, patch);
+    return patch;
+}
+
 // ====================== Константы MSA ======================
 // По умолчанию используем client_id официального Minecraft Launcher (удобно для dev/тестов).
 // В проде лучше зарегистрировать свою Azure App и использовать её client_id.
@@ -371,9 +431,14 @@ static void saveInstallMarker(const QString& instanceDir,
     o["versionId"] = versionId;
     o["modloader"] = modloader;
     o["installedAt"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
-    QFile f(installMarkerPath(instanceDir));
-    if (f.open(QIODevice::WriteOnly))
+    // корневой дайджест манифеста файлов: маркер относится ровно к этому набору
+    o["manifestRoot"] = InstallManifest::load(instanceDir).rootDigest();
+    // маркер — последний шаг установки: пишем атомарно, чтобы он не мог оказаться битым
+    QSaveFile f(installMarkerPath(instanceDir));
+    if (f.open(QIODevice::WriteOnly)) {
         f.write(QJsonDocument(o).toJson(QJsonDocument::Indented));
+        f.commit();
+    }
 }
 static bool markerMatches(const QJsonObject& marker,
                           const QString& versionId,
@@ -990,16 +1055,104 @@ void MainWindow::applyBusyUi() {
     if (!busy) statusBar()->clearMessage();
 }
 void MainWindow::beginBusy(const QString& msg) {
-    if (sbText_) sbText_->setText(msg.isEmpty() ? tr("Занято…") : msg);
+    sbBase_ = msg.isEmpty() ? tr("Занято…") : msg;
+    if (sbText_) sbText_->setText(sbBase_);
     ++busyCount_;
     applyBusyUi();
 }
 void MainWindow::endBusy() {
     busyCount_ = std::max(0, busyCount_ - 1);
-    if (busyCount_ == 0 && sbText_) sbText_->clear();
+    if (busyCount_ == 0) {
+        if (sbText_) sbText_->clear();
+        // следующая задача снова начнёт с «крутилки»
+        if (sbProg_) { sbProg_->setRange(0, 0); sbProg_->resetFormat(); }
+        if (sbCancel_) sbCancel_->setVisible(false);
+        installCancels_.clear();
+        installProgress_.clear();
+        sbBase_.clear();
+    }
     applyBusyUi();
 }
 
+std::shared_ptr<CancelToken> MainWindow::beginInstallProgress() {
+    auto token = std::make_shared<CancelToken>();
+    installCancels_.push_back(token);
+    if (sbCancel_) {
+        sbCancel_->setEnabled(true);
+        sbCancel_->setVisible(true);
+    }
+    return token;
+}
+
+void MainWindow::endInstallProgress(const std::shared_ptr<CancelToken>& token) {
+    installCancels_.erase(std::remove_if(installCancels_.begin(), installCancels_.end(),
+                                         [&](const std::weak_ptr<CancelToken>& w) {
+                                             const auto t = w.lock();
+                                             return !t || t == token;
+                                         }),
+                          installCancels_.end());
+    if (sbCancel_ && installCancels_.isEmpty()) sbCancel_->setVisible(false);
+}
+
+void MainWindow::cancelInstalls() {
+    for (const auto& w : std::as_const(installCancels_))
+        if (const auto t = w.lock()) t->cancel();
+}
+
+void MainWindow::showInstallProgress(int task, const InstallProgress& p) {
+    if (busyCount_ == 0) return; // запоздавший отчёт уже завершённой задачи
+    installProgress_.insert(task, p);
+    renderInstallProgress();
+}
+
+void MainWindow::dropInstallProgress(int task) {
+    if (installProgress_.remove(task) && busyCount_ > 0) renderInstallProgress();
+}
+
+void MainWindow::renderInstallProgress() {
+    if (!sbProg_) return;
+    if (installProgress_.isEmpty()) {
+        sbProg_->setRange(0, 0);
+        sbProg_->resetFormat();
+        if (sbText_) sbText_->setText(sbBase_);
+        return;
+    }
+
+    const QHash<QString, QString> phases = {
+        {"assets",    tr("ресурсы")},
+        {"libraries", tr("библиотеки")},
+        {"client",    tr("клиент")},
+        {"loader",    tr("модлоадер")},
+    };
+
+    // Полоса — средняя доля задач, текст — по части на задачу в порядке их начала
+    int permilleSum = 0;
+    QStringList formats, parts;
+    for (const InstallProgress& p : std::as_const(installProgress_)) {
+        const QString phase = phases.value(p.phase, p.phase);
+
+        // доля — по байтам, если размеры известны, иначе по объектам
+        int permille = 0;
+        if (p.bytesTotal > 0)  permille = int(qMin<qint64>(1000, p.bytesDone * 1000 / p.bytesTotal));
+        else if (p.total > 0)  permille = int(qMin<qint64>(1000, qint64(p.done) * 1000 / p.total));
+        permilleSum += permille;
+        formats << QStringLiteral("%1 %2/%3").arg(phase).arg(p.done).arg(p.total);
+
+        QString part = phase;
+        if (p.bytesTotal > 0)
+            part += tr(": %1 из %2").arg(CacheManager::formatBytes(p.bytesDone), CacheManager::formatBytes(p.bytesTotal));
+        if (p.bytesPerSec > 0)
+            part += tr(", %1/с").arg(CacheManager::formatBytes(p.bytesPerSec));
+        if (p.etaSeconds > 0)
+            part += tr(", осталось ≈ %1:%2").arg(p.etaSeconds / 60).arg(p.etaSeconds % 60, 2, 10, QChar('0'));
+        parts << part;
+    }
+    sbProg_->setRange(0, 1000);
+    sbProg_->setValue(permilleSum / installProgress_.size());
+    sbProg_->setFormat(formats.join(QStringLiteral(" · ")));
+    if (sbText_) sbText_->setText(sbBase_ + ' ' + parts.join(QStringLiteral("; ")));
+}
+
 // ====================== MainWindow конструктор ======================
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
@@ -1015,6 +1168,7 @@ MainWindow::MainWindow(QWidget* parent)
     auto* actSettings        = tool->addAction(tr("Настройки"));
     auto* actRefreshVersions = tool->addAction(tr("Обновить список версий"));
     auto* actToggleLog       = tool->addAction(tr("Показать лог"));
+    auto* actPrefetch        = tool->addAction(tr("Скачать версии…"));
 
 
     auto* topRow = new QHBoxLayout;
@@ -1071,8 +1225,19 @@ MainWindow::MainWindow(QWidget* parent)
     sbProg_ = new QProgressBar(this);
     sbProg_->setRange(0, 0);
     sbProg_->setVisible(false);
+    sbCancel_ = new QToolButton(this);
+    sbCancel_->setText(tr("Отмена"));
+    sbCancel_->setToolTip(tr("Прервать установку; уже скачанное останется в кэше"));
+    sbCancel_->setVisible(false);
     statusBar()->addWidget(sbText_);
     statusBar()->addPermanentWidget(sbProg_, 1);
+    statusBar()->addPermanentWidget(sbCancel_);
+    connect(sbCancel_, &QToolButton::clicked, this, [this]{
+        if (installCancels_.isEmpty()) return;
+        cancelInstalls();
+        sbCancel_->setEnabled(false);
+        appendLog(this, tr("Отмена установки…"));
+    });
 
     auto logMsg = [this](const QString& s){ appendLog(this, s); };
 
@@ -1147,6 +1312,14 @@ MainWindow::MainWindow(QWidget* parent)
     refreshInstances();
     warmVersionsList();
 
+    // кэш держим в рамках бюджета из настроек (в фоне, idle-приоритет диска)
+    CacheManager::collectInBackground(readGameDir());
+    // и перепроверяем его целостность (idle-приоритет, с ограничением скорости, с места остановки)
+    CacheScrubber::runInBackground(readGameDir());
+
+    // раздача кэша соседям по LAN (lan/serve); живёт вместе с окном
+    CacheServer::startFromSettings(this);
+
     connect(searchEdit, &QLineEdit::textChanged, this, [this, list](const QString& text){
         const QString needle = text.trimmed();
         for (int i = 0; i < list->count(); ++i) {
@@ -1169,6 +1342,81 @@ MainWindow::MainWindow(QWidget* parent)
 
     connect(actRefreshVersions, &QAction::triggered, this, warmVersionsList);
 
+    // Заранее скачать в кэш несколько версий одним проходом (общие файлы — один раз)
+    connect(actPrefetch, &QAction::triggered, this, [=]{
+        QList<VersionRef> refs;
+        try {
+            Net net; MojangAPI api(net);
+            refs = api.getVersionList();
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, tr("Ошибка"),
+                                 tr("Не удалось получить список версий: %1").arg(e.what()));
+            return;
+        }
+
+        QDialog dlg(this);
+        dlg.setWindowTitle(tr("Скачать версии в кэш"));
+        auto* lay = new QVBoxLayout(&dlg);
+        auto* cbSnapshots = new QCheckBox(tr("Показывать снапшоты"), &dlg);
+        auto* lw = new QListWidget(&dlg);
+        for (const auto& r : refs) {
+            auto* it = new QListWidgetItem(r.id, lw);
+            it->setFlags(it->flags() | Qt::ItemIsUserCheckable);
+            it->setCheckState(Qt::Unchecked);
+            it->setData(Qt::UserRole, r.type);
+            it->setHidden(r.type != "release");
+        }
+        connect(cbSnapshots, &QCheckBox::toggled, &dlg, [lw](bool on){
+            for (int i = 0; i < lw->count(); ++i)
+                lw->item(i)->setHidden(!on && lw->item(i)->data(Qt::UserRole).toString() != "release");
+        });
+        auto* bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+        connect(bb, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+        connect(bb, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+        lay->addWidget(new QLabel(tr("Отмеченные версии будут скачаны в общий кэш:"), &dlg));
+        lay->addWidget(lw, 1);
+        lay->addWidget(cbSnapshots);
+        lay->addWidget(bb);
+        dlg.resize(360, 480);
+        if (dlg.exec() != QDialog::Accepted) return;
+
+        QList<VersionRef> chosen;
+        for (int i = 0; i < lw->count(); ++i)
+            if (lw->item(i)->checkState() == Qt::Checked) chosen << refs[i];
+        if (chosen.isEmpty()) return;
+
+        beginBusy(tr("Загрузка версий в кэш…"));
+        appendLog(this, tr("Загрузка в кэш: %1 верс.").arg(chosen.size()));
+        auto fut = QtConcurrent::run([=]{
+            UiBusyGuard guard{const_cast<MainWindow*>(this)};
+            try {
+                Net net; MojangAPI api(net);
+                QList<VersionResolved> resolved;
+                for (const auto& r : chosen) resolved << api.resolveVersion(r);
+
+                QMetaObject::invokeMethod(this, [this]{ if (sbProg_) sbProg_->setRange(0, 1000); }, Qt::QueuedConnection);
+                Installer inst(api, QString()); // только кэш, без инстанса
+                const auto st = inst.prefetch(resolved, [this](qint64 done, qint64 total){
+                    const int v = total > 0 ? int(done * 1000 / total) : 0;
+                    QMetaObject::invokeMethod(this, [this, v]{ if (sbProg_) sbProg_->setValue(v); }, Qt::QueuedConnection);
+                });
+                QMetaObject::invokeMethod(qApp, [=]{
+                    if (sbProg_) sbProg_->setRange(0, 0);
+                    appendLog(this, tr("Кэш: скачано объектов %1, библиотек %2, client.jar %3 (%4 МБ); уже было %5.")
+                                        .arg(st.objects).arg(st.libraries).arg(st.clients)
+                                        .arg(st.totalBytes / (1024 * 1024)).arg(st.alreadyCached));
+                }, Qt::QueuedConnection);
+            } catch (const std::exception& e) {
+                const QString msg = QString::fromUtf8(e.what());
+                QMetaObject::invokeMethod(qApp, [=]{
+                    if (sbProg_) sbProg_->setRange(0, 0);
+                    appendLog(this, tr("ОШИБКА загрузки версий в кэш: %1").arg(msg));
+                }, Qt::QueuedConnection);
+            }
+        });
+        Q_UNUSED(fut);
+    });
+
     connect(btnCreate, &QPushButton::clicked, this, [=]{
         QStringList versions;
         try {
@@ -1185,7 +1433,7 @@ MainWindow::MainWindow(QWidget* parent)
             for (const auto& i : store.list()) if (!i.group.isEmpty()) groups.insert(i.group);
         }
 
-        CreateInstanceDialog dlg(versions, QStringList(groups.cbegin(), groups.cend()), this);
+        CreateInstanceDialog dlg(versions, QStringList(groups.cbegin(), groups.cend()), this, readGameDir());
         if (dlg.exec() != QDialog::Accepted) return;
 
         Instance inst;
@@ -1271,51 +1519,69 @@ MainWindow::MainWindow(QWidget* parent)
         if (!picked) { QMessageBox::warning(this, tr("Ошибка"), tr("Сборка не найдена")); return; }
 
         beginBusy(tr("Установка сборки…"));
+        const std::shared_ptr<CancelToken> cancel = beginInstallProgress();
         appendLog(this, tr("Установка сборки “%1” …").arg(picked->name));
         auto fut = QtConcurrent::run([=]{
-            UiBusyGuard guard{const_cast<MainWindow*>(this)};
+            UiBusyGuard guard{const_cast<MainWindow*>(this), cancel};
             try {
-                Net net; MojangAPI api(net);
-                VersionRef ref; {
-                    const auto vlist = api.getVersionList();
-                    bool ok=false;
-                    for (const auto& v : vlist) if (v.id == picked->versionId) { ref=v; ok=true; break; }
-                    if (!ok) throw std::runtime_error(("Версия не найдена: " + picked->versionId).toStdString());
-                }
-                VersionResolved resolved = api.resolveVersion(ref);
-
-                const QString instDir = store.pathFor(*picked);
-
-                {
+                const QString instDir   = store.pathFor(*picked);
+                const QJsonObject ml    = loadInstanceMeta(instDir).value("modloader").toObject();
+                const QString kindStr   = ml.value("kind").toString();
+                const QString loaderVer = ml.value("version").toString();
+
+                // Модлоадеру нужен только id версии: его профиль и библиотеки качаются параллельно
+                // с разрешением версии и assets ванили. У каждой задачи свой Net
+                TaskGraph graph;
+                VersionResolved resolved;
+                graph.add("resolve", {}, [&]{
+                    Net net; net.setCancelToken(cancel);
+                    MojangAPI api(net);
+                    VersionRef ref; {
+                        const auto vlist = api.getVersionList();
+                        bool ok=false;
+                        for (const auto& v : vlist) if (v.id == picked->versionId) { ref=v; ok=true; break; }
+                        if (!ok) throw std::runtime_error(("Версия не найдена: " + picked->versionId).toStdString());
+                    }
+                    resolved = api.resolveVersion(ref);
+                });
+                graph.add("vanilla", {"resolve"}, [&]{
+                    Net net; net.setCancelToken(cancel);
+                    MojangAPI api(net);
+                    UiInstallObserver observer(const_cast<MainWindow*>(this));
                     Installer inst(api, instDir);
-                    inst.install(resolved);
-                }
-
-                try {
-                    const QJsonObject meta = loadInstanceMeta(instDir);
-                    const QJsonObject ml   = meta.value("modloader").toObject();
-                    const QString kindStr  = ml.value("kind").toString();
-                    const QString loaderVer= ml.value("version").toString();
-
-                    if (!kindStr.isEmpty() && kindStr != "none") {
-                        ModloaderInstaller mli(net, instDir);
-                        LoaderPatch patch;
-
-                        if (kindStr == "fabric")        patch = mli.installFabric(picked->versionId, loaderVer);
-                        else if (kindStr == "quilt")    patch = mli.installQuilt (picked->versionId, loaderVer);
-                        else if (kindStr == "forge")    patch = mli.installForge (picked->versionId, loaderVer);
-                        else if (kindStr == "neoforge") patch = mli.installNeoForge(picked->versionId, loaderVer);
+                    inst.setObserver(&observer);
+                    inst.setCancelToken(cancel);
+                    // объём и время — до начала; нехватку места install() отвергнет по этой же оценке
+                    const Installer::Estimate preflight = inst.estimate(resolved, instDir);
+                    const QString est = CreateInstanceDialog::describeEstimate(preflight);
+                    QMetaObject::invokeMethod(qApp, [=]{
+                        appendLog(this, tr("Оценка: %1").arg(est));
+                        if (sbText_) sbText_->setText(tr("Установка сборки… %1").arg(est.section('\n', 0, 0)));
+                    }, Qt::QueuedConnection);
+                    inst.install(resolved, &preflight);
+                });
 
-                        LoaderPatchIO::save(instDir, patch);
-                        QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Модлоадер установлен: %1").arg(kindStr)); }, Qt::QueuedConnection);
-                    } else {
-                        QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Модлоадер не выбран (ваниль).")); }, Qt::QueuedConnection);
-                    }
-                } catch (const std::exception& e) {
-                    QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Установка модлоадера: %1").arg(QString::fromUtf8(e.what()))); }, Qt::QueuedConnection);
+                if (!kindStr.isEmpty() && kindStr != "none") {
+                    graph.add("loader", {}, [&]{
+                        try {
+                            UiInstallObserver observer(const_cast<MainWindow*>(this));
+                            installModloader(instDir, kindStr, picked->versionId, loaderVer, &observer, cancel);
+                            QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Модлоадер установлен: %1").arg(kindStr)); }, Qt::QueuedConnection);
+                        } catch (const InstallCancelled&) {
+                            throw;
+                        } catch (const std::exception& e) {
+                            const QString err = QString::fromUtf8(e.what());
+                            QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Установка модлоадера: %1").arg(err)); }, Qt::QueuedConnection);
+                        }
+                    });
+                } else {
+                    QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Модлоадер не выбран (ваниль).")); }, Qt::QueuedConnection);
                 }
+                graph.run();
 
                 QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Установка сборки «%1» завершена.").arg(picked->name)); }, Qt::QueuedConnection);
+            } catch (const InstallCancelled&) {
+                QMetaObject::invokeMethod(qApp, [=]{ appendLog(this, tr("Установка сборки «%1» отменена.").arg(picked->name)); }, Qt::QueuedConnection);
             } catch (const std::exception& e) {
                 const QString msg = QString::fromUtf8(e.what());
                 const QString shown = (msg.isEmpty() || msg == QStringLiteral("std::exception"))
@@ -1419,6 +1685,8 @@ MainWindow::MainWindow(QWidget* parent)
         restoreGeometry(s.value("mw/geom").toByteArray());
         restoreState(s.value("mw/state").toByteArray());
         connect(qApp, &QCoreApplication::aboutToQuit, this, [this]{
+            // фоновая установка не держит выход до таймаутов сети
+            cancelInstalls();
             QSettings s;
             s.setValue("mw/geom", saveGeometry());
             s.setValue("mw/state", saveState());
@@ -1459,6 +1727,8 @@ void MainWindow::doPlay() {
     }
 
     const QString instGameDir = store.pathFor(*picked);
+    // один корень кэша на установку и запуск: Launcher ищет natives там, куда их распаковал Installer
+    const QString cacheDir = CachePaths::root();
     appendLog(this, tr("Каталог сборки: %1").arg(QDir::toNativeSeparators(instGameDir)));
 
     const QString java = readJavaPath();
@@ -1471,9 +1741,10 @@ void MainWindow::doPlay() {
     }
 
     beginBusy(tr("Запуск клиента…"));
+    const std::shared_ptr<CancelToken> cancel = beginInstallProgress();
 
     auto fut = QtConcurrent::run([=]() mutable {
-        UiBusyGuard guard{const_cast<MainWindow*>(this)};
+        UiBusyGuard guard{const_cast<MainWindow*>(this), cancel};
         auto uiLog = [this](const QString& txt){
             QMetaObject::invokeMethod(this, [this, txt]{ appendLog(this, txt); }, Qt::QueuedConnection);
         };
@@ -1497,6 +1768,7 @@ void MainWindow::doPlay() {
             }
 
             Net net; MojangAPI api(net);
+            net.setCancelToken(cancel);
 
             // найти ссылку версии
             VersionRef ref;
@@ -1527,39 +1799,90 @@ void MainWindow::doPlay() {
             const QString verDir   = QDir(instGameDir).filePath("versions/" + picked->versionId);
             const QString clientJar= QDir(verDir).filePath(picked->versionId + ".jar");
             const bool haveClient  = QFileInfo::exists(clientJar);
-            const bool needInstall = (!haveClient) || (!markerMatches(mark, picked->versionId, ml));
-
+            // неизменённый инстанс подтверждается stat'ом файлов из манифеста (без хэширования)
+            const InstallManifest manifest = InstallManifest::load(instGameDir);
+            const bool filesIntact = !manifest.isEmpty()
+                                  && mark.value("manifestRoot").toString() == manifest.rootDigest()
+                                  && manifest.changedOnDisk(instGameDir).isEmpty();
+            const bool needInstall = (!haveClient) || (!markerMatches(mark, picked->versionId, ml))
+                                     || InstallJournal::pending(instGameDir) // прерванная установка — доделать
+                                     || !filesIntact;                         // доустановит только изменённое
+
+            const QString kindStr   = ml.value("kind").toString();
+            const QString loaderVer = ml.value("version").toString();
+            const bool wantLoader   = !kindStr.isEmpty() && kindStr != "none";
+            const bool havePatch    = LoaderPatchIO::tryLoad(instGameDir).has_value();
+            QString javaPath = java;
+
+            // Ваниль, модлоадер и рантайм Java ставятся параллельно: профиль и библиотеки лоадера
+            // зависят только от id версии, рантайм — от version.json, и никто не ждёт assets.
+            // Каждая задача — со своим Net (QNetworkAccessManager привязан к потоку)
+            TaskGraph graph;
             if (needInstall) {
                 uiLog(tr("Авто-установка: подготавливаем клиент %1…").arg(picked->versionId));
-                {
-                    Installer inst(api, instGameDir);
-                    inst.install(resolved);
-                }
+                graph.add("vanilla", {}, [&]{
+                    Net vnet; vnet.setCancelToken(cancel);
+                    MojangAPI vapi(vnet);
+                    UiInstallObserver observer(this);
+                    Installer inst(vapi, instGameDir, cacheDir);
+                    inst.setObserver(&observer);
+                    inst.setCancelToken(cancel);
+                    const Installer::Estimate preflight = inst.estimate(resolved, instGameDir);
+                    uiLog(tr("Оценка: %1").arg(CreateInstanceDialog::describeEstimate(preflight)));
+                    inst.install(resolved, &preflight);
+                });
+                if (!wantLoader) uiLog(tr("Авто-установка: ваниль (без модлоадера)."));
+            }
 
-                // Модлоадер (если задан)
-                try {
-                    const QString kindStr   = ml.value("kind").toString();
-                    const QString loaderVer = ml.value("version").toString();
-                    if (!kindStr.isEmpty() && kindStr != "none") {
-                        uiLog(tr("Авто-установка: модлоадер %1…").arg(kindStr));
-                        ModloaderInstaller mli(net, instGameDir);
-                        LoaderPatch patch;
-                        if (kindStr == "fabric")        patch = mli.installFabric(picked->versionId, loaderVer);
-                        else if (kindStr == "quilt")    patch = mli.installQuilt (picked->versionId, loaderVer);
-                        else if (kindStr == "forge")    patch = mli.installForge (picked->versionId, loaderVer);
-                        else if (kindStr == "neoforge") patch = mli.installNeoForge(picked->versionId, loaderVer);
-                        LoaderPatchIO::save(instGameDir, patch);
-                        uiLog(tr("Авто-установка: модлоадер установлен."));
-                    } else {
-                        uiLog(tr("Авто-установка: ваниль (без модлоадера)."));
+            // при авто-установке модлоадер ставится заново; иначе — только если патча ещё нет
+            QString loaderError; // читается после graph.run()
+            if (wantLoader && (needInstall || !havePatch)) {
+                uiLog(tr("Установка модлоадера: %1…").arg(kindStr));
+                graph.add("loader", {}, [&]{
+                    try {
+                        UiInstallObserver observer(this);
+                        installModloader(instGameDir, kindStr, picked->versionId, loaderVer, &observer, cancel);
+                        uiLog(tr("Модлоадер установлен: %1").arg(kindStr));
+                    } catch (const InstallCancelled&) {
+                        throw; // отменённую установку не запускаем
+                    } catch (const std::exception& e) {
+                        // при авто-установке не критично (как и раньше), без патча для запуска — ошибка
+                        if (!needInstall) throw;
+                        loaderError = QString::fromUtf8(e.what());
+                        uiLog(tr("Авто-установка модлоадера: %1").arg(loaderError));
                     }
-                } catch (const std::exception& e) {
-                    uiLog(tr("Авто-установка модлоадера: %1").arg(QString::fromUtf8(e.what())));
-                }
+                });
+            }
+
+            // Своей Java нет — берём рантайм Mojang, указанный в version.json
+            if (!QFileInfo(javaPath).isExecutable() && !resolved.javaComponent.isEmpty()) {
+                uiLog(tr("Java не найдена — ставим рантайм Mojang %1…").arg(resolved.javaComponent));
+                graph.add("jre", {}, [&]{
+                    try {
+                        Net jnet; jnet.setCancelToken(cancel);
+                        MojangAPI japi(jnet);
+                        Installer inst(japi, instGameDir, cacheDir);
+                        inst.setCancelToken(cancel);
+                        const QString rt = inst.installMojangRuntime(resolved);
+                        if (!rt.isEmpty()) {
+                            javaPath = rt; // читается после graph.run()
+                            uiLog(tr("Рантайм Mojang: %1").arg(QDir::toNativeSeparators(rt)));
+                        }
+                    } catch (const InstallCancelled&) {
+                        throw;
+                    } catch (const std::exception& e) {
+                        uiLog(tr("Рантайм Mojang не установлен: %1").arg(QString::fromUtf8(e.what())));
+                    }
+                });
+            }
 
-                saveInstallMarker(instGameDir, picked->versionId, ml);
-                uiLog(tr("Авто-установка завершена."));
+            if (needInstall) {
+                graph.add("marker", {"vanilla", "loader"}, [&]{
+                    saveInstallMarker(instGameDir, picked->versionId, ml);
+                    uiLog(tr("Авто-установка завершена."));
+                });
             }
+            graph.run();
 
             // JVM настройки
             AppSettings app = AppSettings::load();
@@ -1575,31 +1898,15 @@ void MainWindow::doPlay() {
             jvmExtra << "-Dcom.mojang.text2speech.disable=true";
 #endif
 
-            // Патч лоадера (если есть)
+            // Патч лоадера (если есть; только что поставленный — тоже на диске)
             std::unique_ptr<LoaderPatch> maybePatch;
             if (auto disk = LoaderPatchIO::tryLoad(instGameDir); disk.has_value()) {
                 maybePatch = std::make_unique<LoaderPatch>(*disk);
                 uiLog(tr("Применён модлоадер из loader.patch.json"));
+            } else if (!loaderError.isEmpty()) {
+                uiLog(tr("Модлоадер %1 не установлен — запуск ваниллы.").arg(kindStr));
             } else {
-                // meta/ml уже прочитаны выше (и могли быть применены при авто-установке)
-                const QString kindStr  = ml.value("kind").toString();
-                const QString loaderVer= ml.value("version").toString();
-
-                if (!kindStr.isEmpty() && kindStr != "none") {
-                    uiLog(tr("Установка модлоадера для запуска: %1…").arg(kindStr));
-                    ModloaderInstaller mli(net, instGameDir);
-                    LoaderPatch patch;
-                    if (kindStr == "fabric")        patch = mli.installFabric(picked->versionId, loaderVer);
-                    else if (kindStr == "quilt")    patch = mli.installQuilt (picked->versionId, loaderVer);
-                    else if (kindStr == "forge")    patch = mli.installForge (picked->versionId, loaderVer);
-                    else if (kindStr == "neoforge") patch = mli.installNeoForge(picked->versionId, loaderVer);
-
-                    LoaderPatchIO::save(instGameDir, patch);
-                    maybePatch = std::make_unique<LoaderPatch>(patch);
-                    uiLog(tr("Модлоадер установлен и применён: %1").arg(kindStr));
-                } else {
-                    uiLog(tr("Модлоадер не задан — запуск ваниллы."));
-                }
+                uiLog(tr("Модлоадер не задан — запуск ваниллы."));
             }
 
             // Сформировать Minecraft-сессию
@@ -1620,14 +1927,18 @@ void MainWindow::doPlay() {
             // auth.json
             writeAuthJsonForLaunch(instGameDir, session);
 
-            // запуск клиента
-            QMetaObject::invokeMethod(this, [this]{ appendLog(this, tr("Запуск процесса клиента…")); },
-                                      Qt::QueuedConnection);
+            // запуск клиента; установка позади — отменять больше нечего, индикатор снова «крутилка» до выхода клиента
+            QMetaObject::invokeMethod(this, [this, cancel]{
+                appendLog(this, tr("Запуск процесса клиента…"));
+                endInstallProgress(cancel);
+                if (sbProg_) { sbProg_->setRange(0, 0); sbProg_->resetFormat(); }
+                if (sbText_) sbText_->setText(sbBase_);
+            }, Qt::QueuedConnection);
 
             // Launcher expects (gameDir, javaPath). The previous order was swapped,
             // which made the instance directory be treated as the Java executable and
             // the Java path be treated as the game directory (breaking classpath).
-            Launcher launcher(instGameDir, readJavaPath());
+            Launcher launcher(instGameDir, javaPath, cacheDir);
             // Launch: online needs a token, offline uses the legacy path.
             if (session.userType == "legacy") {
                 launcher.launch(resolved,
@@ -1646,6 +1957,8 @@ void MainWindow::doPlay() {
                 appendLog(this, tr("Клиент завершил работу."));
             }, Qt::QueuedConnection);
 
+        } catch (const InstallCancelled&) {
+            uiLog(tr("Установка отменена — клиент не запущен."));
         } catch (const std::exception& e) {
             const QString emsg = QString::fromUtf8(e.what());
             QMetaObject::invokeMethod(this, [this, emsg]{
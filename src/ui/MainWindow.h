@@ -1,8 +1,14 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QMap>
+#include <QVector>
+#include <memory>
+#include "../InstallObserver.h"
 class QLabel;
 class QProgressBar;
+class QToolButton;
+class CancelToken;
 
 class MainWindow : public QMainWindow
 {
@@ -19,6 +25,14 @@ public slots:
     void beginBusy(const QString& msg = QString());
     void endBusy();
 
+    // Ход установки задачи task в статусбаре (вызывать в GUI-потоке; из фоновых задач — через
+    // UiInstallObserver). Параллельные задачи показываются рядом; dropInstallProgress убирает задачу
+    void showInstallProgress(int task, const InstallProgress& p);
+    void dropInstallProgress(int task);
+
+    // Установка задачи закончилась: её токен снимается, «Отмена» прячется, когда установок не осталось
+    void endInstallProgress(const std::shared_ptr<CancelToken>& token);
+
 private slots:
     // Если есть QAction с objectName "actionPlay"
     void on_actionPlay_triggered();
@@ -34,10 +48,23 @@ private:
     // Применить текущее состояние "занято" к UI
     void applyBusyUi();
 
+    // Перерисовать ход установки по installProgress_
+    void renderInstallProgress();
+
+    // Новый токен отмены для одной установки; «Отмена» в статусбаре прерывает все идущие
+    std::shared_ptr<CancelToken> beginInstallProgress();
+
+    // Отменить все идущие установки
+    void cancelInstalls();
+
 private:
     int         busyCount_ = 0;     // поддержка вложенных beginBusy()/endBusy()
     QLabel*     sbText_    = nullptr; // текст в статусбаре
     QProgressBar* sbProg_  = nullptr; // индикатор "крутилка" в статусбаре
+    QToolButton*  sbCancel_ = nullptr; // отмена идущей установки
+    QString       sbBase_;             // текст beginBusy(), к нему дописывается ход установки
+    QVector<std::weak_ptr<CancelToken>> installCancels_; // по токену на идущую установку
+    QMap<int, InstallProgress> installProgress_;         // последний отчёт каждой задачи
     void removeLaunchActiveButtonIfAny();
 
 protected:
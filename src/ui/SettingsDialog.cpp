@@ -1,17 +1,25 @@
 #include "SettingsDialog.h"
 #include "Settings.h"
 #include "JavaUtil.h"
+#include "JavaRegistry.h"
 #include "Installer.h"
 #include "Net.h"
 #include "MojangAPI.h"
+#include "CacheManager.h"
+#include "CachePaths.h"
+#include "CacheServer.h"
+#include "CachePack.h"
 
 #include <QFormLayout>
+#include <QFileDialog>
 #include <QHBoxLayout>
 #include <QDialogButtonBox>
 #include <QStandardPaths>
 #include <QMessageBox>
 #include <QFileInfo>
 #include <QDir>
+#include <QPointer>
+#include <QtConcurrent>
 
 SettingsDialog::SettingsDialog(QWidget* parent)
     : QDialog(parent)
@@ -112,10 +120,181 @@ QWidget* SettingsDialog::buildTabGeneral()
     cbLanguage_->addItem("English", "en");
     f->addRow(tr("Язык интерфейса:"), cbLanguage_);
 
+    // Кэш: бюджет, отчёт о том, что можно освободить, и ручная чистка
+    sbCacheBudget_ = new QSpinBox(w);
+    sbCacheBudget_->setRange(0, 4096);
+    sbCacheBudget_->setSuffix(tr(" GiB"));
+    sbCacheBudget_->setSpecialValueText(tr("без ограничения"));
+    f->addRow(tr("Лимит кэша:"), sbCacheBudget_);
+
+    cbSharedCache_ = new QCheckBox(tr("Общий кэш для всех пользователей (%1)").arg(CachePaths::sharedRoot()), w);
+    cbSharedCache_->setToolTip(tr("Каталог должен существовать и быть доступен на запись группе пользователей "
+                                  "лаунчера (setgid, 2775). Вступает в силу после перезапуска."));
+    f->addRow(QString(), cbSharedCache_);
+
+    cbScrub_ = new QCheckBox(tr("Фоновая проверка целостности кэша и сборок"), w);
+    cbScrub_->setToolTip(tr("Раз в неделю файлы перехэшируются в фоне с низким приоритетом; "
+                            "испорченные удаляются и скачиваются заново при следующей установке или запуске."));
+    f->addRow(QString(), cbScrub_);
+
+    lbCacheReport_ = new QLabel(tr("Подсчёт…"), w);
+    lbCacheReport_->setWordWrap(true);
+    btnCacheClean_ = new QPushButton(tr("Освободить неиспользуемое"), w);
+    auto* hb = new QHBoxLayout();
+    hb->addWidget(lbCacheReport_, 1);
+    hb->addWidget(btnCacheClean_);
+    auto* wrap = new QWidget(w);
+    wrap->setLayout(hb);
+    f->addRow(tr("Кэш:"), wrap);
+
+    // пакет кэша: выгрузить версии в один архив / влить архив в кэш
+    auto* btnExport = new QPushButton(tr("Экспорт пакета…"), w);
+    auto* btnImport = new QPushButton(tr("Импорт пакета…"), w);
+    auto* hbPack = new QHBoxLayout();
+    hbPack->addWidget(btnExport);
+    hbPack->addWidget(btnImport);
+    hbPack->addStretch(1);
+    auto* wrapPack = new QWidget(w);
+    wrapPack->setLayout(hbPack);
+    f->addRow(tr("Офлайн-пакет:"), wrapPack);
+
+    connect(btnCacheClean_, &QPushButton::clicked, this, &SettingsDialog::onCleanCache);
+    connect(btnExport, &QPushButton::clicked, this, &SettingsDialog::onExportPack);
+    connect(btnImport, &QPushButton::clicked, this, &SettingsDialog::onImportPack);
+    refreshCacheReport();
+
     w->setLayout(f);
     return w;
 }
 
+void SettingsDialog::refreshCacheReport()
+{
+    QSettings s;
+    const QString gameDir = s.value("paths/gameDir").toString();
+    if (gameDir.isEmpty()) {
+        // без списка инстансов нельзя понять, что из кэша используется
+        lbCacheReport_->setText(tr("Укажите папку игры, чтобы оценить кэш."));
+        btnCacheClean_->setEnabled(false);
+        return;
+    }
+    QPointer<QLabel> label = lbCacheReport_;
+    auto fut = QtConcurrent::run([gameDir, label] {
+        const CacheManager::Report r = CacheManager(gameDir).scan();
+        const QString text = SettingsDialog::tr("%1 всего, %2 можно освободить (%3 объектов)")
+                                 .arg(CacheManager::formatBytes(r.totalBytes),
+                                      CacheManager::formatBytes(r.reclaimableBytes))
+                                 .arg(r.reclaimableItems);
+        QMetaObject::invokeMethod(qApp, [label, text] { if (label) label->setText(text); }, Qt::QueuedConnection);
+    });
+    Q_UNUSED(fut);
+}
+
+void SettingsDialog::onCleanCache()
+{
+    QSettings s;
+    const QString gameDir = s.value("paths/gameDir").toString();
+    if (gameDir.isEmpty()) return;
+    btnCacheClean_->setEnabled(false);
+    lbCacheReport_->setText(tr("Очистка…"));
+    QPointer<SettingsDialog> self = this;
+    auto fut = QtConcurrent::run([gameDir, self] {
+        // бюджет 1 байт — вытеснить всё неиспользуемое; используемое не трогается никогда
+        const CacheManager::Report r = CacheManager(gameDir).collect(1);
+        QMetaObject::invokeMethod(qApp, [self, r] {
+            if (!self) return;
+            self->btnCacheClean_->setEnabled(true);
+            self->refreshCacheReport();
+            QMessageBox::information(self, self->tr("Кэш"),
+                                     r.busy ? self->tr("Кэш сейчас используется установкой, попробуйте позже.")
+                                            : self->tr("Освобождено: %1").arg(CacheManager::formatBytes(r.evictedBytes)));
+        }, Qt::QueuedConnection);
+    });
+    Q_UNUSED(fut);
+}
+
+void SettingsDialog::onExportPack()
+{
+    QSettings s;
+    const QString gameDir = s.value("paths/gameDir").toString();
+    const QStringList versions = gameDir.isEmpty() ? QStringList() : CachePack::installedVersions(gameDir);
+    if (versions.isEmpty()) {
+        QMessageBox::information(this, tr("Пакет кэша"), tr("Нет установленных версий для экспорта."));
+        return;
+    }
+
+    // выбор версий и Java
+    QDialog dlg(this);
+    dlg.setWindowTitle(tr("Экспорт пакета кэша"));
+    auto* v = new QVBoxLayout(&dlg);
+    auto* list = new QListWidget(&dlg);
+    for (const QString& id : versions) {
+        auto* item = new QListWidgetItem(id, list);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Checked);
+    }
+    auto* cbJava = new QCheckBox(tr("Включить Java для этих версий"), &dlg);
+    cbJava->setChecked(true);
+    auto* bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+    v->addWidget(list);
+    v->addWidget(cbJava);
+    v->addWidget(bb);
+    connect(bb, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(bb, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    QStringList chosen;
+    for (int i = 0; i < list->count(); ++i)
+        if (list->item(i)->checkState() == Qt::Checked) chosen << list->item(i)->text();
+    if (chosen.isEmpty()) return;
+    const bool withJava = cbJava->isChecked();
+
+    const QString out = QFileDialog::getSaveFileName(this, tr("Сохранить пакет кэша"),
+                                                     QDir::home().filePath("tesuto-cache.tar.gz"),
+                                                     tr("Пакет кэша (*.tar.gz)"));
+    if (out.isEmpty()) return;
+
+    QPointer<SettingsDialog> self = this;
+    auto fut = QtConcurrent::run([gameDir, chosen, withJava, out, self] {
+        QString msg;
+        try {
+            const CachePack::Stats st = CachePack().exportPack(gameDir, chosen, withJava, out);
+            msg = tr("Записано файлов: %1 (%2).").arg(st.files).arg(CacheManager::formatBytes(st.bytes));
+        } catch (const std::exception& e) {
+            msg = tr("Ошибка экспорта: %1").arg(QString::fromUtf8(e.what()));
+        }
+        QMetaObject::invokeMethod(qApp, [self, msg] {
+            if (self) QMessageBox::information(self, self->tr("Пакет кэша"), msg);
+        }, Qt::QueuedConnection);
+    });
+    Q_UNUSED(fut);
+}
+
+void SettingsDialog::onImportPack()
+{
+    const QString in = QFileDialog::getOpenFileName(this, tr("Открыть пакет кэша"), QDir::homePath(),
+                                                    tr("Пакет кэша (*.tar.gz)"));
+    if (in.isEmpty()) return;
+
+    QPointer<SettingsDialog> self = this;
+    auto fut = QtConcurrent::run([in, self] {
+        QString msg;
+        try {
+            const CachePack::Stats st = CachePack().importPack(in);
+            msg = tr("Добавлено в кэш: %1 (%2), уже было: %3, отброшено при проверке: %4.")
+                      .arg(st.files).arg(CacheManager::formatBytes(st.bytes))
+                      .arg(st.skipped).arg(st.rejected);
+        } catch (const std::exception& e) {
+            msg = tr("Ошибка импорта: %1").arg(QString::fromUtf8(e.what()));
+        }
+        QMetaObject::invokeMethod(qApp, [self, msg] {
+            if (!self) return;
+            self->refreshCacheReport();
+            QMessageBox::information(self, self->tr("Пакет кэша"), msg);
+        }, Qt::QueuedConnection);
+    });
+    Q_UNUSED(fut);
+}
+
 QWidget* SettingsDialog::buildTabNetwork()
 {
     auto* w = new QWidget(this);
@@ -128,6 +307,24 @@ QWidget* SettingsDialog::buildTabNetwork()
     f->addRow(cbUseSystemProxy_);
     f->addRow(tr("NO_PROXY:"), leNoProxy_);
 
+    // LAN: этот лаунчер как зеркало для соседей и/или соседний лаунчер как наше зеркало
+    cbLanServe_ = new QCheckBox(tr("Раздавать кэш в локальной сети"), w);
+    cbLanServe_->setToolTip(tr("Другие лаунчеры смогут брать assets и библиотеки отсюда. "
+                               "Вступает в силу после перезапуска."));
+    sbLanPort_ = new QSpinBox(w);
+    sbLanPort_->setRange(1024, 65535);
+    leLanMirror_ = new QLineEdit(w);
+    leLanMirror_->setPlaceholderText(tr("напр.: http://192.168.1.10:%1").arg(CacheServer::kDefaultPort));
+
+    f->addRow(cbLanServe_);
+    f->addRow(tr("Порт:"), sbLanPort_);
+    f->addRow(tr("LAN-зеркало:"), leLanMirror_);
+
+    // дельты client.jar: при смене версии качается патч от jar, уже лежащего в кэше
+    leDeltaSource_ = new QLineEdit(w);
+    leDeltaSource_->setPlaceholderText(tr("URL каталога с патчами bsdiff (необязательно)"));
+    f->addRow(tr("Дельты client.jar:"), leDeltaSource_);
+
     w->setLayout(f);
     return w;
 }
@@ -149,9 +346,18 @@ void SettingsDialog::loadSettings()
     if (idx < 0) idx = 0;
     cbLanguage_->setCurrentIndex(idx);
 
+    // кэш
+    sbCacheBudget_->setValue(int(s.value("cache/budgetMiB", 0).toLongLong() / 1024));
+    cbSharedCache_->setChecked(s.value("cache/shared", false).toBool());
+    cbScrub_->setChecked(s.value("scrub/enabled", true).toBool());
+
     // сеть
     cbUseSystemProxy_->setChecked(s.value("network/useSystemProxy", true).toBool());
     leNoProxy_->setText(s.value("network/noProxy").toString());
+    cbLanServe_->setChecked(s.value("lan/serve", false).toBool());
+    sbLanPort_->setValue(s.value("lan/port", CacheServer::kDefaultPort).toInt());
+    leLanMirror_->setText(s.value("lan/mirror").toString());
+    leDeltaSource_->setText(s.value("delta/source").toString());
 }
 
 void SettingsDialog::applyAndClose()
@@ -169,9 +375,18 @@ void SettingsDialog::applyAndClose()
     // язык
     s.setValue("ui/language", cbLanguage_->currentData().toString());
 
+    // кэш
+    s.setValue("cache/budgetMiB", qint64(sbCacheBudget_->value()) * 1024);
+    s.setValue("cache/shared",    cbSharedCache_->isChecked());
+    s.setValue("scrub/enabled",   cbScrub_->isChecked());
+
     // сеть
     s.setValue("network/useSystemProxy", cbUseSystemProxy_->isChecked());
     s.setValue("network/noProxy",        leNoProxy_->text().trimmed());
+    s.setValue("lan/serve",              cbLanServe_->isChecked());
+    s.setValue("lan/port",               sbLanPort_->value());
+    s.setValue("lan/mirror",             leLanMirror_->text().trimmed());
+    s.setValue("delta/source",           leDeltaSource_->text().trimmed());
 
     emit settingsChanged();
     accept();
@@ -194,6 +409,8 @@ void SettingsDialog::populateJavaCandidates()
 
     // 2) кандидаты из JavaUtil
     for (const auto& p : JavaUtil::candidatesFromEnv()) uniqAdd(p);
+    // 2a) всё, что знает реестр (JAVA_HOME, /usr/lib/jvm/*, стор рантаймов и т.д.)
+    for (const auto& j : JavaRegistry::instance().installs()) uniqAdd(j.java);
 
     // 3) локальные инсталляции в <gameDir>/runtime/java-*
     QSettings s;
@@ -251,8 +468,7 @@ void SettingsDialog::onDownloadJavaSelected()
         MojangAPI api(net);
         Installer inst(api, gameDir);
 
-        const QString destBase = QDir(gameDir).filePath("runtime");
-        const QString java = inst.installTemurinJre(major, destBase);
+        const QString java = inst.installTemurinJre(major);
         if (!java.isEmpty()) {
             cbJavaPath_->setEditText(java);
             s.setValue("java/defaultPath", java);
@@ -26,9 +26,20 @@ private:
     // Язык
     QComboBox* cbLanguage_ = nullptr;
 
+    // Кэш
+    QSpinBox*    sbCacheBudget_  = nullptr; // GiB, 0 — без ограничения
+    QLabel*      lbCacheReport_  = nullptr;
+    QPushButton* btnCacheClean_  = nullptr;
+    QCheckBox*   cbSharedCache_  = nullptr; // общий кэш машины (cache/shared)
+    QCheckBox*   cbScrub_        = nullptr; // фоновая проверка целостности (scrub/enabled)
+
     // Сеть
     QCheckBox* cbUseSystemProxy_ = nullptr;
     QLineEdit* leNoProxy_ = nullptr;
+    QCheckBox* cbLanServe_  = nullptr; // раздавать кэш по LAN (lan/serve)
+    QSpinBox*  sbLanPort_   = nullptr;
+    QLineEdit* leLanMirror_ = nullptr; // чужой лаунчер-зеркало (lan/mirror)
+    QLineEdit* leDeltaSource_ = nullptr; // источник дельт client.jar (delta/source)
 
     // Построители вкладок
     QWidget* buildTabCustomization();
@@ -43,8 +54,16 @@ private:
     // Наполнение списка путей к Java
     void populateJavaCandidates();
 
+    // Отчёт о кэше (считается в фоне)
+    void refreshCacheReport();
+
 private slots:
     // Java
     void onDetectJava();
     void onDownloadJavaSelected();
+
+    // Кэш
+    void onCleanCache();
+    void onExportPack(); // пакет кэша для машин без сети
+    void onImportPack();
 };
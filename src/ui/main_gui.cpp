@@ -1,6 +1,8 @@
 #include "i18n.h"
 #include <QApplication>
 #include "SettingsMigration.h"
+#include "CachePaths.h"
+#include "JavaRegistry.h"
 #include <QTranslator>
 #include <QLocale>
 #include <QSettings>
@@ -24,6 +26,9 @@ int main(int argc, char** argv)
     QCoreApplication::setOrganizationName("Tesuto");
     QCoreApplication::setApplicationName("TesutoLauncher");
 
+    // общий кэш: права группы и setgid — до первого файла, созданного в кэше
+    CachePaths::prepareShared();
+
     // Migrate legacy settings (tesuto/launcher -> Tesuto/TesutoLauncher)
     SettingsMigration::migrate();
 
@@ -33,5 +38,8 @@ int main(int argc, char** argv)
 
     MainWindow w;
     w.show();
+
+    // список Java обновляем в фоне: к запуску игры он уже готов
+    JavaRegistry::instance().refreshAsync();
     return app.exec();
 }